@@ -0,0 +1,336 @@
+#include "BenchmarkBaseline.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+//Just enough JSON for the baseline file: objects, arrays, numbers, strings without \u escapes, true/false/null
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const char* key) const {
+        for (const std::pair<std::string, JsonValue>& member : members) {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : m_text(text) {}
+
+    bool parse(JsonValue& value) {
+        if (!parseValue(value))
+            return false;
+        skipSpace();
+        return m_position == m_text.size() || fail("trailing characters");
+    }
+
+    size_t position() const { return m_position; }
+    const std::string& error() const { return m_error; }
+
+private:
+    bool fail(const char* error) {
+        if (m_error.empty())
+            m_error = error;
+        return false;
+    }
+
+    void skipSpace() {
+        while (m_position < m_text.size() && isspace((unsigned char)m_text[m_position]))
+            m_position++;
+    }
+
+    bool take(char c) {
+        skipSpace();
+        if (m_position < m_text.size() && m_text[m_position] == c) {
+            m_position++;
+            return true;
+        }
+        return false;
+    }
+
+    bool takeWord(const char* word) {
+        const size_t length = strlen(word);
+        if (m_text.compare(m_position, length, word) != 0)
+            return false;
+        m_position += length;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!take('"'))
+            return fail("expected a string");
+        while (m_position < m_text.size() && m_text[m_position] != '"') {
+            char c = m_text[m_position++];
+            if (c == '\\' && m_position < m_text.size()) {
+                c = m_text[m_position++];
+                if (c == 'n')
+                    c = '\n';
+                else if (c == 't')
+                    c = '\t';
+            }
+            out += c;
+        }
+        return take('"') || fail("unterminated string");
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipSpace();
+        if (m_position >= m_text.size())
+            return fail("unexpected end");
+
+        const char c = m_text[m_position];
+        if (c == '{') {
+            value.type = JsonValue::Type::Object;
+            m_position++;
+            if (take('}'))
+                return true;
+            do {
+                std::pair<std::string, JsonValue> member;
+                if (!parseString(member.first) || !(take(':') || fail("expected ':'")) || !parseValue(member.second))
+                    return false;
+                value.members.push_back(std::move(member));
+            } while (take(','));
+            return take('}') || fail("expected '}'");
+        }
+        if (c == '[') {
+            value.type = JsonValue::Type::Array;
+            m_position++;
+            if (take(']'))
+                return true;
+            do {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back()))
+                    return false;
+            } while (take(','));
+            return take(']') || fail("expected ']'");
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        }
+        if (takeWord("true") || takeWord("false")) {
+            value.type = JsonValue::Type::Bool;
+            value.number = m_text[m_position - 2] == 'u' ? 1.0 : 0.0;   //tr(u)e or fal(s)e
+            return true;
+        }
+        if (takeWord("null"))
+            return true;
+
+        const char* start = m_text.c_str() + m_position;
+        char* end = nullptr;
+        value.type = JsonValue::Type::Number;
+        value.number = strtod(start, &end);
+        if (end == start)
+            return fail("unexpected character");
+        m_position += end - start;
+        return true;
+    }
+
+    const std::string& m_text;
+    size_t m_position = 0;
+    std::string m_error;
+};
+
+static double numberOf(const JsonValue& object, const char* key, double fallback) {
+    const JsonValue* value = object.find(key);
+    return value && value->type == JsonValue::Type::Number ? value->number : fallback;
+}
+
+bool loadBaseline(const std::string& path, std::vector<SceneMetrics>& scenes, BaselineTolerances& tolerances) {
+    std::ifstream stream(path);
+    if (!stream) {
+        std::cout << "Can't open the baseline " << path << std::endl;
+        return false;
+    }
+    std::stringstream text;
+    text << stream.rdbuf();
+
+    const std::string content = text.str();
+    JsonValue root;
+    JsonParser parser(content);
+    if (!parser.parse(root)) {
+        std::cout << path << ": " << parser.error() << " at offset " << parser.position() << std::endl;
+        return false;
+    }
+    const JsonValue* sceneObjects = root.find("scenes");
+    if (root.type != JsonValue::Type::Object || !sceneObjects || sceneObjects->type != JsonValue::Type::Object) {
+        std::cout << path << ": no \"scenes\" object" << std::endl;
+        return false;
+    }
+
+    if (const JsonValue* limits = root.find("tolerances")) {
+        tolerances.p50 = numberOf(*limits, "p50", tolerances.p50);
+        tolerances.p99 = numberOf(*limits, "p99", tolerances.p99);
+        tolerances.startup = numberOf(*limits, "startup", tolerances.startup);
+        tolerances.frameSlackMilliseconds = numberOf(*limits, "frameSlackMilliseconds", tolerances.frameSlackMilliseconds);
+        tolerances.startupSlackMilliseconds = numberOf(*limits, "startupSlackMilliseconds", tolerances.startupSlackMilliseconds);
+    }
+
+    scenes.clear();
+    for (const std::pair<std::string, JsonValue>& member : sceneObjects->members) {
+        SceneMetrics scene;
+        scene.scene = member.first;
+        scene.frames = (uint32_t)numberOf(member.second, "frames", 0.0);
+        if (const JsonValue* hash = member.second.find("commandStreamHash"))
+            scene.commandStreamHash = hash->string;
+        scene.drawCalls = (uint64_t)numberOf(member.second, "drawCalls", 0.0);
+        scene.uploadBytes = (uint64_t)numberOf(member.second, "uploadBytes", 0.0);
+        scene.p50 = numberOf(member.second, "p50", 0.0);
+        scene.p99 = numberOf(member.second, "p99", 0.0);
+        scene.startupMilliseconds = numberOf(member.second, "startupMilliseconds", 0.0);
+        scenes.push_back(scene);
+    }
+    return true;
+}
+
+bool writeBaseline(const std::string& path, const std::vector<SceneMetrics>& scenes, const BaselineTolerances& tolerances) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Can't write the baseline to " << path << std::endl;
+        return false;
+    }
+
+    out << "{\n  \"tolerances\": {\"p50\": " << tolerances.p50 << ", \"p99\": " << tolerances.p99 << ", \"startup\": " << tolerances.startup
+        << ", \"frameSlackMilliseconds\": " << tolerances.frameSlackMilliseconds << ", \"startupSlackMilliseconds\": " << tolerances.startupSlackMilliseconds
+        << "},\n  \"scenes\": {";
+    for (size_t index = 0; index < scenes.size(); index++) {
+        const SceneMetrics& scene = scenes[index];
+        out << (index ? "," : "") << "\n    \"" << scene.scene << "\": {\"frames\": " << scene.frames << ", \"commandStreamHash\": \""
+            << scene.commandStreamHash << "\", \"drawCalls\": " << scene.drawCalls << ", \"uploadBytes\": " << scene.uploadBytes
+            << ",\n      \"p50\": " << scene.p50 << ", \"p99\": " << scene.p99 << ", \"startupMilliseconds\": " << scene.startupMilliseconds << "}";
+    }
+    out << "\n  }\n}\n";
+    return true;
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+bool medianOfRuns(const std::vector<SceneMetrics>& runs, SceneMetrics& result) {
+    if (runs.empty())
+        return false;
+
+    result = runs.front();
+    std::vector<double> p50, p99, startup;
+    bool deterministic = true;
+    for (const SceneMetrics& run : runs) {
+        deterministic = deterministic && run.commandStreamHash == result.commandStreamHash
+            && run.drawCalls == result.drawCalls && run.uploadBytes == result.uploadBytes;
+        p50.push_back(run.p50);
+        p99.push_back(run.p99);
+        startup.push_back(run.startupMilliseconds);
+    }
+    result.p50 = median(p50);
+    result.p99 = median(p99);
+    result.startupMilliseconds = median(startup);
+    if (!deterministic)
+        std::cout << result.scene << ": runs submitted different commands, the scene isn't deterministic" << std::endl;
+    return deterministic;
+}
+
+struct DiffRow {
+    std::string scene;
+    std::string metric;
+    std::string baseline;
+    std::string current;
+    std::string change;
+    std::string limit;
+    std::string verdict;
+};
+
+static std::string format(double value, int precision = 2) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(precision) << value;
+    return text.str();
+}
+
+static std::string percent(double fraction) {
+    return (fraction >= 0.0 ? "+" : "") + format(fraction * 100.0, 1) + "%";
+}
+
+static bool compareTiming(std::vector<DiffRow>& rows, const std::string& scene, const char* metric, double baseline, double current,
+                          double relative, double slack) {
+    const double limit = baseline * (1.0 + relative) + slack;
+    const bool regressed = current > limit;
+    const bool faster = current < baseline * (1.0 - relative) - slack;
+    rows.push_back({ scene, metric, format(baseline), format(current), baseline > 0.0 ? percent(current / baseline - 1.0) : "",
+                     "+" + format(relative * 100.0, 0) + "%", regressed ? "REGRESSED" : faster ? "faster" : "ok" });
+    return !regressed;
+}
+
+static bool compareExact(std::vector<DiffRow>& rows, const std::string& scene, const char* metric, uint64_t baseline, uint64_t current) {
+    const bool same = baseline == current;
+    rows.push_back({ scene, metric, std::to_string(baseline), std::to_string(current),
+                     baseline > 0 ? percent((double)current / (double)baseline - 1.0) : "", "exact", same ? "ok" : "CHANGED" });
+    return same;
+}
+
+bool compareToBaseline(const std::vector<SceneMetrics>& baseline, const std::vector<SceneMetrics>& current,
+                       const BaselineTolerances& tolerances, std::ostream& out) {
+    std::vector<DiffRow> rows;
+    bool passed = true;
+    for (const SceneMetrics& scene : current) {
+        const SceneMetrics* stored = nullptr;
+        for (const SceneMetrics& candidate : baseline) {
+            if (candidate.scene == scene.scene)
+                stored = &candidate;
+        }
+        if (!stored) {
+            rows.push_back({ scene.scene, "(all)", "-", "", "", "", "no baseline" });
+            continue;
+        }
+        if (stored->frames != scene.frames) {
+            rows.push_back({ scene.scene, "frames", std::to_string(stored->frames), std::to_string(scene.frames), "", "exact", "CHANGED" });
+            passed = false;
+            continue;
+        }
+
+        passed &= compareExact(rows, scene.scene, "drawCalls", stored->drawCalls, scene.drawCalls);
+        passed &= compareExact(rows, scene.scene, "uploadBytes", stored->uploadBytes, scene.uploadBytes);
+        if (stored->commandStreamHash != scene.commandStreamHash) {
+            rows.push_back({ scene.scene, "commandStream", stored->commandStreamHash, scene.commandStreamHash, "", "exact", "CHANGED" });
+            passed = false;
+        }
+        passed &= compareTiming(rows, scene.scene, "p50 ms", stored->p50, scene.p50, tolerances.p50, tolerances.frameSlackMilliseconds);
+        passed &= compareTiming(rows, scene.scene, "p99 ms", stored->p99, scene.p99, tolerances.p99, tolerances.frameSlackMilliseconds);
+        passed &= compareTiming(rows, scene.scene, "startup ms", stored->startupMilliseconds, scene.startupMilliseconds,
+                                tolerances.startup, tolerances.startupSlackMilliseconds);
+    }
+
+    const DiffRow header = { "scene", "metric", "baseline", "current", "change", "limit", "" };
+    size_t widths[6] = {};
+    auto measure = [&](const DiffRow& row) {
+        const std::string* columns[6] = { &row.scene, &row.metric, &row.baseline, &row.current, &row.change, &row.limit };
+        for (int column = 0; column < 6; column++)
+            widths[column] = std::max(widths[column], columns[column]->size());
+    };
+    measure(header);
+    for (const DiffRow& row : rows)
+        measure(row);
+    auto printRow = [&](const DiffRow& row) {
+        out << std::left << std::setw(widths[0] + 2) << row.scene << std::setw(widths[1] + 2) << row.metric << std::right
+            << std::setw(widths[2]) << row.baseline << "  " << std::setw(widths[3]) << row.current << "  "
+            << std::setw(widths[4]) << row.change << "  " << std::setw(widths[5]) << row.limit << "  " << row.verdict << "\n";
+    };
+    printRow(header);
+    for (const DiffRow& row : rows)
+        printRow(row);
+    out << (passed ? "No regressions" : "Regressed, if the change is intended rerun with --write-baseline") << std::endl;
+    return passed;
+}
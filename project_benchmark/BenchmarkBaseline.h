@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//One scene's numbers, from a run (or the median of several) or from the baseline file
+struct SceneMetrics {
+    std::string scene;
+    uint32_t frames = 0;
+    std::string commandStreamHash;
+    //deterministic, over all measured frames, compared exactly
+    uint64_t drawCalls = 0;
+    uint64_t uploadBytes = 0;
+    //timings in milliseconds, compared with a tolerance
+    double p50 = 0.0;           //whole frame
+    double p99 = 0.0;
+    double startupMilliseconds = 0.0;
+};
+
+//a timing regresses past baseline * (1 + relative) + slack, the slack keeps tiny numbers from flagging on noise
+struct BaselineTolerances {
+    double p50 = 0.10;
+    double p99 = 0.20;          //the tail is noisier
+    double startup = 0.25;      //mostly the driver's shader compiler
+    double frameSlackMilliseconds = 0.05;
+    double startupSlackMilliseconds = 2.0;
+};
+
+/*
+Benchmark Baseline
+    Stored per-scene metrics to compare fresh runs against, as JSON:
+
+        {
+          "tolerances": {"p50": 0.1, "p99": 0.2, "startup": 0.25, ...},     optional
+          "scenes": {
+            "default": {"frames": 300, "commandStreamHash": "d3b910e3a3664569", "drawCalls": 2920830,
+                        "uploadBytes": 116857200, "p50": 12.3, "p99": 15.1, "startupMilliseconds": 48.0}
+          }
+        }
+
+    Baselines only mean something on the machine and driver they were written on, so they
+    come from --write-baseline there rather than being checked in.
+*/
+bool loadBaseline(const std::string& path, std::vector<SceneMetrics>& scenes, BaselineTolerances& tolerances);
+bool writeBaseline(const std::string& path, const std::vector<SceneMetrics>& scenes, const BaselineTolerances& tolerances);
+
+//timings are the median over the runs, counters have to agree between them. false if they don't
+bool medianOfRuns(const std::vector<SceneMetrics>& runs, SceneMetrics& median);
+
+//prints a row per scene and metric, true when nothing regressed. A scene without a baseline
+//is reported but passes; a changed command stream or counter fails, the scene itself changed
+bool compareToBaseline(const std::vector<SceneMetrics>& baseline, const std::vector<SceneMetrics>& current,
+                       const BaselineTolerances& tolerances, std::ostream& out);
@@ -0,0 +1,62 @@
+#include "BenchmarkReport.h"
+#include <cmath>
+#include <sstream>
+
+BenchmarkReport::Section& BenchmarkReport::section(const std::string& name) {
+    for (Section& existing : m_sections) {
+        if (existing.name == name)
+            return existing;
+    }
+    m_sections.push_back({ name, {} });
+    return m_sections.back();
+}
+
+void BenchmarkReport::add(const std::string& sectionName, const std::string& key, double value) {
+    std::ostringstream text;
+    //counts stay whole numbers rather than turning into 1e+06, and so do averages that big
+    if ((value == std::floor(value) || std::fabs(value) >= 1e5) && std::fabs(value) < 1e15)
+        text << std::llround(value);
+    else
+        text << value;
+    section(sectionName).values.push_back({ key, text.str(), false });
+}
+
+void BenchmarkReport::add(const std::string& sectionName, const std::string& key, const std::string& value) {
+    section(sectionName).values.push_back({ key, value, true });
+}
+
+double BenchmarkReport::number(const std::string& sectionName, const std::string& key) const {
+    for (const Section& entry : m_sections) {
+        if (entry.name != sectionName)
+            continue;
+        for (const Value& value : entry.values) {
+            if (value.key == key && !value.quoted)
+                return std::stod(value.text);
+        }
+    }
+    return 0.0;
+}
+
+void BenchmarkReport::write(std::ostream& out) const {
+    for (const Section& entry : m_sections) {
+        out << ",\n  \"" << entry.name << "\": {";
+        for (size_t i = 0; i < entry.values.size(); i++) {
+            const Value& value = entry.values[i];
+            out << (i ? ", " : "") << "\"" << value.key << "\": ";
+            if (value.quoted)
+                out << "\"" << value.text << "\"";
+            else
+                out << value.text;
+        }
+        out << "}";
+    }
+}
+
+void BenchmarkReport::print(std::ostream& out) const {
+    for (const Section& entry : m_sections) {
+        out << entry.name << ":";
+        for (size_t i = 0; i < entry.values.size(); i++)
+            out << (i ? ", " : " ") << entry.values[i].key << " " << entry.values[i].text;
+        out << "\n";
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+Benchmark Report
+    Numbers a scene's optional features add to the result, grouped by feature. write() puts
+    them into the result JSON after the frame times, print() on one line per section:
+
+        report.add("uniforms", "mode", "direct");
+        report.add("uniforms", "submitMilliseconds", 4.2);
+
+        "uniforms": {"mode": "direct", "submitMilliseconds": 4.2}
+        uniforms: mode direct, submitMilliseconds 4.2
+*/
+class BenchmarkReport {
+public:
+    void add(const std::string& section, const std::string& key, double value);
+    void add(const std::string& section, const std::string& key, const std::string& value);
+    void add(const std::string& section, const std::string& key, const char* value) { add(section, key, std::string(value)); }
+
+    bool empty() const { return m_sections.empty(); }
+    double number(const std::string& section, const std::string& key) const;  //0 when it wasn't added
+    void write(std::ostream& out) const;    //",\n  \"section\": {...}" per section, to follow another member
+    void print(std::ostream& out) const;
+
+private:
+    struct Value {
+        std::string key;
+        std::string text;
+        bool quoted;
+    };
+    struct Section {
+        std::string name;
+        std::vector<Value> values;
+    };
+
+    Section& section(const std::string& name);
+
+    std::vector<Section> m_sections;    //in the order they were first added to
+};
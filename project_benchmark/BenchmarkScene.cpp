@@ -0,0 +1,577 @@
+#include "BenchmarkScene.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "JobSystem.h"
+#include "Shader.h"
+
+static const float PI = 3.14159265358979f;
+static const char* MESH_NAMES[] = { "cube", "sphere", "quad" };
+static const unsigned int MESH_KINDS = 3;
+
+//xorshift32, the same sequence on every compiler and platform unlike std::rand or the <random> distributions
+struct ScriptRandom {
+    uint32_t state;
+
+    explicit ScriptRandom(uint32_t seed) : state(seed ? seed : 0x9e3779b9u) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    float unit() { return (next() >> 8) * (1.0f / 16777216.0f); }     //[0, 1)
+    float range(float low, float high) { return low + (high - low) * unit(); }
+};
+
+const char* uniformPathName(UniformPath path) {
+    return path == UniformPath::Direct ? "direct" : "ring";
+}
+
+const char* submitPathName(SubmitPath path) {
+    return path == SubmitPath::CommandList ? "commandlist" : "queue";
+}
+
+const char* cullingPathName(CullingPath path) {
+    return path == CullingPath::Bvh ? "bvh" : "flat";
+}
+
+const char* sceneLayoutName(SceneLayout layout) {
+    return layout == SceneLayout::City ? "city" : "random";
+}
+
+const char* occlusionPathName(OcclusionPath path) {
+    switch (path) {
+    case OcclusionPath::Cpu:        return "cpu";
+    case OcclusionPath::Queries:    return "queries";
+    default:                        return "off";
+    }
+}
+
+static bool parseSwitch(const std::string& value, bool& result) {
+    if (value == "on" || value == "1" || value == "true")
+        result = true;
+    else if (value == "off" || value == "0" || value == "false")
+        result = false;
+    else
+        return false;
+    return true;
+}
+
+bool loadBenchmarkScript(const std::string& path, BenchmarkScript& script) {
+    std::ifstream stream(path);
+    if (!stream) {
+        std::cout << "Can't open the benchmark script " << path << std::endl;
+        return false;
+    }
+
+    const size_t slash = path.find_last_of("/\\");
+    script.name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    script.name = script.name.substr(0, script.name.find('.'));
+
+    std::string line;
+    unsigned int number = 0;
+    while (getline(stream, line)) {
+        number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key))
+            continue;
+
+        bool ok = true;
+        if (key == "frames")
+            ok = (bool)(words >> script.frames) && script.frames > 0;
+        else if (key == "warmup")
+            ok = (bool)(words >> script.warmupFrames);
+        else if (key == "resolution")
+            ok = (bool)(words >> script.width >> script.height) && script.width > 0 && script.height > 0;
+        else if (key == "seed")
+            ok = (bool)(words >> script.seed);
+        else if (key == "objects")
+            ok = (bool)(words >> script.objects);
+        else if (key == "mesh") {
+            MeshWeight mesh = { "", 1 };
+            ok = (bool)(words >> mesh.mesh);
+            words >> mesh.weight;   //optional
+            bool known = false;
+            for (const char* name : MESH_NAMES)
+                known = known || mesh.mesh == name;
+            ok = ok && known && mesh.weight > 0;
+            if (ok)
+                script.meshes.push_back(mesh);
+        }
+        else if (key == "shaders")
+            ok = (bool)(words >> script.shaderVariants) && script.shaderVariants > 0;
+        else if (key == "depthprepass") {
+            std::string value;
+            ok = (bool)(words >> value) && parseSwitch(value, script.depthPrePass);
+        }
+        else if (key == "camera")
+            ok = (bool)(words >> script.cameraRadius >> script.cameraHeight >> script.cameraTurns);
+        else if (key == "world")
+            ok = (bool)(words >> script.worldSize) && script.worldSize > 0.0f;
+        else if (key == "shaderdir")
+            ok = (bool)(words >> script.shaderDirectory);
+        else if (key == "uniforms") {
+            std::string value;
+            ok = (bool)(words >> value) && (value == "ring" || value == "direct");
+            script.uniforms = value == "direct" ? UniformPath::Direct : UniformPath::Ring;
+        }
+        else if (key == "submit") {
+            std::string value;
+            ok = (bool)(words >> value) && (value == "queue" || value == "commandlist");
+            script.submit = value == "commandlist" ? SubmitPath::CommandList : SubmitPath::Queue;
+        }
+        else if (key == "draw") {
+            std::string value;
+            ok = (bool)(words >> value) && parseSwitch(value, script.draw);
+        }
+        else if (key == "culling") {
+            std::string value;
+            ok = (bool)(words >> value) && (value == "flat" || value == "bvh");
+            script.culling = value == "bvh" ? CullingPath::Bvh : CullingPath::Flat;
+        }
+        else if (key == "moving")
+            ok = (bool)(words >> script.moving) && script.moving >= 0.0f && script.moving <= 1.0f;
+        else if (key == "layout") {
+            std::string value;
+            ok = (bool)(words >> value) && (value == "random" || value == "city");
+            script.layout = value == "city" ? SceneLayout::City : SceneLayout::Random;
+        }
+        else if (key == "occlusion") {
+            std::string value;
+            ok = (bool)(words >> value) && (value == "off" || value == "cpu" || value == "queries");
+            script.occlusion = value == "cpu" ? OcclusionPath::Cpu : value == "queries" ? OcclusionPath::Queries : OcclusionPath::Off;
+        }
+        else if (key == "debuglines") {
+            ok = (bool)(words >> script.debugLines);
+            words >> script.debugLinesFromJobs;     //optional
+            ok = ok && script.debugLinesFromJobs >= 0.0f && script.debugLinesFromJobs <= 1.0f;
+        }
+        else if (key == "record") {
+            ok = (bool)(words >> script.record) && (script.record == "y4m" || script.record == "qoi" || script.record == "png");
+        }
+        else if (key == "materials") {
+            std::string value;
+            ok = (bool)(words >> script.materials >> value) && (value == "bindless" || value == "array");
+            script.bindlessMaterials = value == "bindless";
+        }
+        else if (key == "text") {
+            ok = (bool)(words >> script.textLabels);
+            words >> script.textChanging;     //optional
+            ok = ok && script.textChanging >= 0.0f && script.textChanging <= 1.0f;
+        }
+        else if (key == "framegraph") {
+            std::string value;
+            ok = (bool)(words >> value) && parseSwitch(value, script.frameGraph);
+        }
+        else if (key == "atlas") {
+            ok = (bool)(words >> script.atlasImages);
+            words >> script.atlasChurn;     //optional
+            ok = ok && script.atlasChurn >= 0.0f && script.atlasChurn <= 1.0f;
+        }
+        else if (key == "capture") {
+            unsigned int frame;
+            while (words >> frame)
+                script.captureFrames.push_back(frame);
+            ok = words.eof();
+        }
+        else
+            ok = false;
+
+        if (!ok) {
+            std::cout << path << ":" << number << ": can't use \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    if (script.meshes.empty())
+        script.meshes.push_back({ "cube", 1 });
+    if (script.uniforms == UniformPath::Direct && script.depthPrePass) {
+        std::cout << path << ": the depth pre-pass needs uniforms ring" << std::endl;
+        return false;
+    }
+    if (script.occlusion == OcclusionPath::Queries && (script.submit != SubmitPath::Queue || script.uniforms != UniformPath::Ring || script.depthPrePass)) {
+        std::cout << path << ": occlusion queries wrap the queue's own draws, they need submit queue, uniforms ring and no depth pre-pass" << std::endl;
+        return false;
+    }
+    if (script.occlusion == OcclusionPath::Cpu && script.layout != SceneLayout::City) {
+        std::cout << path << ": occlusion culling needs layout city, nothing else has occluders" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//column major, result = l * r
+static Std140Mat4 multiply(const Std140Mat4& l, const Std140Mat4& r) {
+    Std140Mat4 result = {};
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++)
+                sum += l.m[k * 4 + row] * r.m[column * 4 + k];
+            result.m[column * 4 + row] = sum;
+        }
+    }
+    return result;
+}
+
+static Std140Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane) {
+    const float f = 1.0f / std::tan(fovY / 2.0f);
+    Std140Mat4 matrix = {};
+    matrix.m[0] = f / aspect;
+    matrix.m[5] = f;
+    matrix.m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+    matrix.m[11] = -1.0f;
+    matrix.m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+    return matrix;
+}
+
+static Vec3 normalize(const Vec3& v) {
+    const float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    return { v.x / length, v.y / length, v.z / length };
+}
+
+static Vec3 cross(const Vec3& l, const Vec3& r) {
+    return { l.y * r.z - l.z * r.y, l.z * r.x - l.x * r.z, l.x * r.y - l.y * r.x };
+}
+
+static float dot(const Vec3& l, const Vec3& r) {
+    return l.x * r.x + l.y * r.y + l.z * r.z;
+}
+
+static Std140Mat4 lookAt(const Vec3& eye, const Vec3& target, const Vec3& up) {
+    const Vec3 forward = normalize({ target.x - eye.x, target.y - eye.y, target.z - eye.z });
+    const Vec3 side = normalize(cross(forward, up));
+    const Vec3 upward = cross(side, forward);
+    Std140Mat4 matrix = {};
+    matrix.m[0] = side.x;      matrix.m[4] = side.y;      matrix.m[8] = side.z;
+    matrix.m[1] = upward.x;    matrix.m[5] = upward.y;    matrix.m[9] = upward.z;
+    matrix.m[2] = -forward.x;  matrix.m[6] = -forward.y;  matrix.m[10] = -forward.z;
+    matrix.m[12] = -dot(side, eye);
+    matrix.m[13] = -dot(upward, eye);
+    matrix.m[14] = dot(forward, eye);
+    matrix.m[15] = 1.0f;
+    return matrix;
+}
+
+//unit size meshes centered on the origin, positions only
+static void buildCube(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    for (int corner = 0; corner < 8; corner++) {
+        vertices.push_back(corner & 1 ? 0.5f : -0.5f);
+        vertices.push_back(corner & 2 ? 0.5f : -0.5f);
+        vertices.push_back(corner & 4 ? 0.5f : -0.5f);
+    }
+    indices = {
+        0, 2, 1, 1, 2, 3,   //-z
+        4, 5, 6, 5, 7, 6,   //+z
+        0, 1, 4, 1, 5, 4,   //-y
+        2, 6, 3, 3, 6, 7,   //+y
+        0, 4, 2, 2, 4, 6,   //-x
+        1, 3, 5, 3, 7, 5    //+x
+    };
+}
+
+static void buildSphere(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int rings = 12, segments = 16;
+    for (unsigned int ring = 0; ring <= rings; ring++) {
+        const float theta = PI * ring / rings;
+        for (unsigned int segment = 0; segment <= segments; segment++) {
+            const float phi = 2.0f * PI * segment / segments;
+            vertices.push_back(0.5f * std::sin(theta) * std::cos(phi));
+            vertices.push_back(0.5f * std::cos(theta));
+            vertices.push_back(0.5f * std::sin(theta) * std::sin(phi));
+        }
+    }
+    for (unsigned int ring = 0; ring < rings; ring++) {
+        for (unsigned int segment = 0; segment < segments; segment++) {
+            const unsigned int a = ring * (segments + 1) + segment;
+            const unsigned int b = a + segments + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+}
+
+static void buildQuad(std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    vertices = { -0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, -0.5f, 0.5f, 0.0f };
+    indices = { 0, 1, 2, 2, 3, 0 };
+}
+
+//materials: a quad per material in a grid over the whole target, positions in clip space like
+//the material shaders expect, then texture coordinates. Drawn by baseVertex, so one index list
+static void buildMaterialQuads(unsigned int count, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)count));
+    const float cell = 2.0f / columns;
+    for (unsigned int i = 0; i < count; i++) {
+        const float x = -1.0f + cell * (i % columns), y = -1.0f + cell * (i / columns);
+        const float size = cell * 0.9f;
+        const float quad[] = { x, y, 0.0f, 0.0f, x + size, y, 1.0f, 0.0f, x + size, y + size, 1.0f, 1.0f, x, y + size, 0.0f, 1.0f };
+        vertices.insert(vertices.end(), quad, quad + 16);
+    }
+    indices = { 0, 1, 2, 2, 3, 0 };
+}
+
+/*
+Benchmark Glyph Source
+    Glyphs 8 to 32 pixels wide and 12 to 32 high standing on the baseline, a border and a pattern
+    of 4x4 blocks inside, all from a hash of the codepoint. Space is blank.
+*/
+class BenchmarkGlyphSource : public GlyphSource {
+public:
+    float lineHeight() const override { return 40.0f; }
+    float ascent() const override { return 32.0f; }
+
+    bool rasterize(uint32_t codepoint, GlyphBitmap& glyph) override {
+        if (codepoint == ' ') {
+            glyph.width = 0;
+            glyph.height = 0;
+            glyph.coverage.clear();
+            glyph.advance = 12.0f;
+            return true;
+        }
+        const uint32_t bits = codepoint * 2654435761u;
+        glyph.width = 8 + (int)((bits >> 8) % 25);
+        glyph.height = 12 + (int)((bits >> 16) % 21);
+        glyph.bearingX = 2;
+        glyph.bearingY = glyph.height;
+        glyph.advance = (float)(glyph.width + 4);
+        glyph.coverage.resize((size_t)glyph.width * glyph.height);
+        for (int y = 0; y < glyph.height; y++) {
+            for (int x = 0; x < glyph.width; x++) {
+                const bool border = x == 0 || y == 0 || x == glyph.width - 1 || y == glyph.height - 1;
+                const bool block = (bits >> ((x / 4 + y / 4 * 3) & 31) & 1) != 0;
+                glyph.coverage[y * glyph.width + x] = border || block ? 255 : 0;
+            }
+        }
+        return true;
+    }
+};
+
+//a variant is Basic.shader with its own #define, so the driver has to compile and keep every one
+static void defineVariant(std::string& source, unsigned int variant) {
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+        return;
+    source.insert(source.find('\n', version) + 1, "#define VARIANT " + std::to_string(variant) + "\n");
+}
+
+static unsigned int linkTimed(ShaderProgramSource source, double& milliseconds) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    unsigned int program = createShader(source.VertexSource, source.FragmentSource);
+    //drivers compile lazily, asking for the status waits for the result
+    int linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (linked == GL_FALSE)
+        std::cout << "Benchmark shader failed to link" << std::endl;
+    return program;
+}
+
+BenchmarkScene::~BenchmarkScene() {
+    for (unsigned int program : m_programs)
+        glDeleteProgram(program);
+    glDeleteProgram(m_depthProgram);
+    glDeleteProgram(m_proxyProgram);
+    glDeleteProgram(m_debugProgram);
+    glDeleteProgram(m_materialProgram);
+    glDeleteProgram(m_textProgram);
+}
+
+bool BenchmarkScene::create(const BenchmarkScript& script) {
+    m_script = script;
+
+    for (unsigned int kind = 0; kind < MESH_KINDS; kind++) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        if (kind == 0)
+            buildCube(vertices, indices);
+        else if (kind == 1)
+            buildSphere(vertices, indices);
+        else
+            buildQuad(vertices, indices);
+        m_meshes.emplace_back(new Mesh());
+        if (!m_meshes.back()->create(vertices.data(), (unsigned int)vertices.size() / 3, { { 0, 3 } }, indices.data(), (unsigned int)indices.size(), false))
+            return false;
+    }
+
+    ShaderProgramSource basic = ParseShader(script.shaderDirectory + "Basic.shader");
+    ShaderProgramSource depth = ParseShader(script.shaderDirectory + "DepthOnly.shader");
+    if (basic.VertexSource.empty() || depth.VertexSource.empty()) {
+        std::cout << "No shaders in " << script.shaderDirectory << ", see shaderdir" << std::endl;
+        return false;
+    }
+    injectUniformBlocks(basic, script.uniforms == UniformPath::Direct);
+    injectUniformBlocks(depth);
+    for (unsigned int variant = 0; variant < script.shaderVariants; variant++) {
+        ShaderProgramSource source = basic;
+        defineVariant(source.VertexSource, variant);
+        defineVariant(source.FragmentSource, variant);
+        m_programs.push_back(linkTimed(source, m_compileMilliseconds));
+        m_modelLocations.push_back(glGetUniformLocation(m_programs.back(), "model"));
+        m_tintLocations.push_back(glGetUniformLocation(m_programs.back(), "tint"));
+    }
+    m_depthProgram = linkTimed(depth, m_compileMilliseconds);
+    if (script.occlusion == OcclusionPath::Queries) {
+        ShaderProgramSource proxy = ParseShader(script.shaderDirectory + "OcclusionProxy.shader");
+        injectUniformBlocks(proxy);
+        m_proxyProgram = linkTimed(proxy, m_compileMilliseconds);
+    }
+    if (script.debugLines > 0)
+        m_debugProgram = linkTimed(ParseShader(script.shaderDirectory + "VertexColor.shader"), m_compileMilliseconds);
+    if (script.materials > 0) {
+        //16x16 checkers, each material its own colour
+        const int SIZE = 16;
+        if (!m_materials.init(SIZE, SIZE, script.materials, script.bindlessMaterials))
+            return false;
+        std::vector<unsigned char> rgba(SIZE * SIZE * 4);
+        for (unsigned int material = 0; material < script.materials; material++) {
+            const uint32_t colour = material * 2654435761u;
+            for (int pixel = 0; pixel < SIZE * SIZE; pixel++) {
+                const bool dark = ((pixel % SIZE) / 4 + (pixel / SIZE) / 4) % 2 != 0;
+                for (int channel = 0; channel < 3; channel++)
+                    rgba[pixel * 4 + channel] = (unsigned char)(((colour >> (8 * channel)) & 0xFF) >> (dark ? 1 : 0));
+                rgba[pixel * 4 + 3] = 255;
+            }
+            if (m_materials.addMaterial(rgba.data(), SIZE, SIZE) == INVALID_MATERIAL)
+                return false;
+        }
+        m_materials.finalize();
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        buildMaterialQuads(script.materials, vertices, indices);
+        m_materialQuads.reset(new Mesh());
+        if (!m_materialQuads->create(vertices.data(), (unsigned int)vertices.size() / 4, { { 0, 2 }, { 1, 2 } }, indices.data(), (unsigned int)indices.size(), false))
+            return false;
+        m_materials.attachMaterialIds(m_materialQuads->vertexArray());
+        m_materialProgram = linkTimed(ParseShader(script.shaderDirectory + m_materials.shaderPath()), m_compileMilliseconds);
+    }
+
+    if (script.textLabels > 0) {
+        m_textProgram = linkTimed(ParseShader(script.shaderDirectory + "SdfText.shader"), m_compileMilliseconds);
+        m_glyphSource.reset(new BenchmarkGlyphSource());
+    }
+
+    unsigned int totalWeight = 0;
+    for (const MeshWeight& mesh : script.meshes)
+        totalWeight += mesh.weight;
+
+    ScriptRandom random(script.seed);
+    const float half = script.worldSize / 2.0f;
+    //layout city: a building on every block the camera's ring road doesn't cross
+    const float BLOCK = 10.0f;
+    const uint32_t blocksPerSide = std::max(1u, (uint32_t)(script.worldSize / BLOCK));
+    std::vector<Vec3> blocks;
+    if (script.layout == SceneLayout::City) {
+        for (uint32_t x = 0; x < blocksPerSide; x++) {
+            for (uint32_t z = 0; z < blocksPerSide; z++) {
+                const Vec3 block = { -half + BLOCK * (x + 0.5f), 0.0f, -half + BLOCK * (z + 0.5f) };
+                if (std::fabs(std::sqrt(block.x * block.x + block.z * block.z) - script.cameraRadius) >= 0.6f * BLOCK)
+                    blocks.push_back(block);
+            }
+        }
+        m_occluders = (uint32_t)std::min<size_t>(blocks.size(), script.objects);
+    }
+
+    m_objects.resize(script.objects);
+    for (uint32_t index = 0; index < script.objects; index++) {
+        BenchmarkObject& object = m_objects[index];
+        unsigned int pick = random.next() % totalWeight;
+        for (const MeshWeight& mesh : script.meshes) {
+            if (pick < mesh.weight) {
+                for (unsigned int kind = 0; kind < MESH_KINDS; kind++) {
+                    if (mesh.mesh == MESH_NAMES[kind])
+                        object.mesh = kind;
+                }
+                break;
+            }
+            pick -= mesh.weight;
+        }
+        object.program = random.next() % script.shaderVariants;
+
+        Vec3 center, scale;
+        if (index < m_occluders) {
+            //a box filling up to 70% of its block, 6 to 18 high
+            object.mesh = 0;
+            scale = { random.range(4.0f, 7.0f), random.range(6.0f, 18.0f), random.range(4.0f, 7.0f) };
+            center = { blocks[index].x, scale.y / 2.0f, blocks[index].z };
+        }
+        else if (script.layout == SceneLayout::City) {
+            //on the ground in the street along a random side of a random block
+            const float size = random.range(0.4f, 1.0f);
+            scale = { size, size, size };
+            const float blockX = -half + BLOCK * (random.next() % blocksPerSide + 0.5f);
+            const float blockZ = -half + BLOCK * (random.next() % blocksPerSide + 0.5f);
+            const float along = random.range(-BLOCK / 2.0f, BLOCK / 2.0f);
+            const float across = random.range(0.36f, 0.48f) * BLOCK * (random.next() % 2 ? 1.0f : -1.0f);
+            const bool alongX = random.next() % 2 != 0;
+            center = { blockX + (alongX ? along : across), size / 2.0f, blockZ + (alongX ? across : along) };
+        }
+        else {
+            center = { random.range(-half, half), random.range(-half, half), random.range(-half, half) };
+            const float size = random.range(0.5f, 1.5f);
+            scale = { size, size, size };
+        }
+        object.model = {};
+        object.model.m[0] = scale.x;
+        object.model.m[5] = scale.y;
+        object.model.m[10] = scale.z;
+        object.model.m[12] = center.x;
+        object.model.m[13] = center.y;
+        object.model.m[14] = center.z;
+        object.model.m[15] = 1.0f;
+        object.home = center;
+        object.tint[0] = random.unit();
+        object.tint[1] = random.unit();
+        object.tint[2] = random.unit();
+        object.tint[3] = 1.0f;
+
+        const Vec3 extent = { scale.x / 2.0f, scale.y / 2.0f, scale.z / 2.0f };
+        m_boxes.push_back({ { center.x - extent.x, center.y - extent.y, center.z - extent.z }, { center.x + extent.x, center.y + extent.y, center.z + extent.z } });
+        m_bounds.add(m_boxes.back());
+    }
+
+    //far enough for the corner of the world opposite the camera
+    const float reach = std::sqrt(script.cameraRadius * script.cameraRadius + script.cameraHeight * script.cameraHeight);
+    m_farPlane = reach + script.worldSize;
+    return true;
+}
+
+Vec3 BenchmarkScene::cameraPosition(int frame) const {
+    const float angle = 2.0f * PI * m_script.cameraTurns * (float)frame / (float)m_script.frames;
+    return { m_script.cameraRadius * std::cos(angle), m_script.cameraHeight, m_script.cameraRadius * std::sin(angle) };
+}
+
+void BenchmarkScene::animate(int frame, JobSystem* jobs) {
+    const uint32_t moving = (uint32_t)(m_script.moving * m_objects.size());
+    const float time = (float)frame / 60.0f;
+    auto move = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t index = begin; index < end; index++) {
+            BenchmarkObject& object = m_objects[index];
+            //every object on its own phase, once around in about 3 seconds
+            const float angle = 2.0f * time + (float)index * 0.618f;
+            const Vec3 center = { object.home.x + 2.0f * std::cos(angle), object.home.y + std::sin(2.0f * angle), object.home.z + 2.0f * std::sin(angle) };
+            object.model.m[12] = center.x;
+            object.model.m[13] = center.y;
+            object.model.m[14] = center.z;
+            const Vec3 extent = { object.model.m[0] / 2.0f, object.model.m[5] / 2.0f, object.model.m[10] / 2.0f };
+            m_boxes[index] = { { center.x - extent.x, center.y - extent.y, center.z - extent.z }, { center.x + extent.x, center.y + extent.y, center.z + extent.z } };
+            m_bounds.set(index, m_boxes[index]);
+        }
+    };
+    if (jobs)
+        jobs->parallelFor(moving, 1024, move);
+    else
+        move(0, moving);
+}
+
+Std140Mat4 BenchmarkScene::viewProjection(int frame) const {
+    const Std140Mat4 projection = perspective(PI / 3.0f, (float)m_script.width / (float)m_script.height, 0.1f, m_farPlane);
+    return multiply(projection, lookAt(cameraPosition(frame), { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }));
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "FrustumCulling.h"
+#include "GlyphSource.h"
+#include "MaterialTextures.h"
+#include "Mesh.h"
+#include "Std140.h"
+
+class JobSystem;
+
+struct MeshWeight {
+    std::string mesh;       //cube, sphere or quad
+    unsigned int weight;
+};
+
+//how a draw gets its PerDraw block
+enum class UniformPath {
+    Ring,       //a UniformRing range, bound with glBindBufferRange
+    Direct      //plain uniforms, set with glUniform* before every draw
+};
+
+const char* uniformPathName(UniformPath path);
+
+//how the sorted queue reaches GL
+enum class SubmitPath {
+    Queue,          //RenderQueue::execute(), GL calls straight from the sorted items
+    CommandList     //recorded into a CommandListSet, a list per thread, then replayed
+};
+
+const char* submitPathName(SubmitPath path);
+
+enum class CullingPath {
+    Flat,       //FrustumCuller over every object's bounds
+    Bvh         //a Bvh built once, refit when objects move, queried per frame
+};
+
+const char* cullingPathName(CullingPath path);
+
+enum class SceneLayout {
+    Random,     //objects anywhere in the world cube
+    City        //a grid of buildings, the occluders, with small objects in the streets between them
+};
+
+const char* sceneLayoutName(SceneLayout layout);
+
+//what hides the objects behind others before they are drawn
+enum class OcclusionPath {
+    Off,
+    Cpu,        //an OcclusionRasterizer with the buildings in view, the rest tested against it
+    Queries     //OcclusionQueries around every draw, the hidden ones drawn behind their box's query
+};
+
+const char* occlusionPathName(OcclusionPath path);
+
+/*
+Benchmark Script
+    A scene as plain text, one "key values" line each, # starts a comment:
+
+        frames 300              measured frames, after warmup frames that aren't
+        warmup 30
+        resolution 1280 720     of the offscreen target, the window is never shown
+        seed 1                  object placement, meshes and shaders come from it alone
+        objects 5000
+        mesh cube 3             mesh mix by weight, as many lines as meshes
+        mesh sphere 1
+        shaders 4               Basic.shader variants, each its own program
+        depthprepass on
+        camera 30 10 1          orbit radius, height and turns over the measured frames
+        world 40                objects fill a cube this wide around the origin
+        shaderdir ../project_opengsl/
+        capture 0 150 299       measured frames checked against golden images, the last one if not given
+        uniforms ring           ring or direct, see UniformPath. direct can't have a depth pre-pass
+        submit queue            queue or commandlist, see SubmitPath
+        draw on                 off only culls, for culling throughput at object counts nothing could draw
+        culling flat            flat or bvh, see CullingPath
+        moving 0.1              fraction of the objects moving every frame, updated as jobs
+        layout city             random or city, see SceneLayout. The city fills the world's
+                                width on the ground, the camera orbits on a ring road kept free of buildings
+        occlusion cpu           off, cpu or queries, see OcclusionPath. cpu needs layout city for the
+                                occluders, queries submit queue and uniforms ring without a depth pre-pass
+        debuglines 100000 0.5   DebugDraw lines a frame and the fraction of them pushed from jobs, drawn
+                                through ImmediateMode after the objects
+        atlas 10000 0.01        images packed into a TextureAtlas before the first frame, and the fraction
+                                of them replaced by new ones every frame, except for the 8 frames a
+                                repack gets to run before the benchmark waits for it
+        framegraph on           a deferred frame's passes at the script's resolution through a FrameGraph
+                                every frame, after the objects. The passes only clear their targets
+        record y4m              every measured frame through FrameCapture, y4m, qoi or png, to <scene>.y4m
+                                or <scene>_00000.qoi and on, and a screenshot in the same format halfway
+        materials 2000 bindless a grid of quads with a texture each, all drawn by one MultiDrawBatch through
+                                MaterialTextures. bindless or array, bindless falls back to the array
+                                where ARB_bindless_texture and NV_gpu_shader5 are missing
+        text 2000 0.05          TextRenderer labels a frame in a grid over the target, and the fraction of
+                                them spelled anew every frame from a moving window of glyphs, which keeps
+                                the glyph page evicting and rasterizing once it is full
+*/
+struct BenchmarkScript {
+    std::string name;       //file name without directory and extension
+    unsigned int frames = 300;
+    unsigned int warmupFrames = 30;
+    unsigned int width = 1280;
+    unsigned int height = 720;
+    uint32_t seed = 1;
+    unsigned int objects = 1000;
+    std::vector<MeshWeight> meshes;
+    unsigned int shaderVariants = 1;
+    bool depthPrePass = false;
+    float cameraRadius = 30.0f;
+    float cameraHeight = 10.0f;
+    float cameraTurns = 1.0f;
+    float worldSize = 40.0f;
+    std::string shaderDirectory = "../project_opengsl/";
+    std::vector<unsigned int> captureFrames;
+    UniformPath uniforms = UniformPath::Ring;
+    SubmitPath submit = SubmitPath::Queue;
+    bool draw = true;
+    CullingPath culling = CullingPath::Flat;
+    float moving = 0.0f;
+    SceneLayout layout = SceneLayout::Random;
+    OcclusionPath occlusion = OcclusionPath::Off;
+    unsigned int debugLines = 0;
+    float debugLinesFromJobs = 0.0f;
+    unsigned int atlasImages = 0;
+    float atlasChurn = 0.0f;
+    bool frameGraph = false;
+    unsigned int materials = 0;
+    bool bindlessMaterials = false;
+    std::string record;     //capture format, empty for none
+    unsigned int textLabels = 0;
+    float textChanging = 0.0f;
+};
+
+//false with the offending line printed
+bool loadBenchmarkScript(const std::string& path, BenchmarkScript& script);
+
+struct BenchmarkObject {
+    unsigned int mesh;
+    unsigned int program;   //variant, see program()
+    Std140Mat4 model;
+    float tint[4];
+    Vec3 home;              //where a moving object circles around
+};
+
+/*
+Benchmark Scene
+    Everything a script describes, built the same way on every run: a xorshift generator
+    seeded from the script places the objects, and the camera is a function of the frame
+    number only, so a script always produces the same GL command stream.
+*/
+class BenchmarkScene {
+public:
+    BenchmarkScene() = default;
+    BenchmarkScene(const BenchmarkScene&) = delete;
+    BenchmarkScene& operator=(const BenchmarkScene&) = delete;
+    ~BenchmarkScene();
+
+    bool create(const BenchmarkScript& script);    //the context must be current
+
+    //frame counts from 0 at the first measured frame, warmup frames are negative
+    Std140Mat4 viewProjection(int frame) const;
+    Vec3 cameraPosition(int frame) const;
+    //moves the script's moving fraction of the objects along small circles, as jobs when there
+    //are any. Like the camera a function of the frame number only
+    void animate(int frame, JobSystem* jobs);
+
+    const std::vector<BenchmarkObject>& objects() const { return m_objects; }
+    uint32_t occluders() const { return m_occluders; }     //layout city: the first objects, the buildings
+    const CullingBounds& bounds() const { return m_bounds; }
+    const std::vector<Aabb>& boxes() const { return m_boxes; }    //the same bounds, for Bvh
+    const Mesh& mesh(unsigned int index) const { return *m_meshes[index]; }
+    unsigned int program(unsigned int index) const { return m_programs[index]; }
+    //uniforms direct: the variant's PerDraw members
+    int modelLocation(unsigned int index) const { return m_modelLocations[index]; }
+    int tintLocation(unsigned int index) const { return m_tintLocations[index]; }
+    unsigned int depthProgram() const { return m_depthProgram; }
+    unsigned int proxyProgram() const { return m_proxyProgram; }    //occlusion queries only
+    unsigned int debugProgram() const { return m_debugProgram; }    //VertexColor.shader, debug lines only
+    //materials only: quad i is vertices 4i..4i+3 of materialQuads() with the indices 0..5
+    const MaterialTextures& materials() const { return m_materials; }
+    const Mesh& materialQuads() const { return *m_materialQuads; }
+    unsigned int materialProgram() const { return m_materialProgram; }
+    //text only: SdfText.shader and made-up glyphs, the same on every machine unlike a system font
+    unsigned int textProgram() const { return m_textProgram; }
+    GlyphSource* glyphSource() const { return m_glyphSource.get(); }
+    double shaderCompileMilliseconds() const { return m_compileMilliseconds; }
+    float farPlane() const { return m_farPlane; }
+
+private:
+    BenchmarkScript m_script;
+    std::vector<std::unique_ptr<Mesh>> m_meshes;
+    std::vector<unsigned int> m_programs;
+    std::vector<int> m_modelLocations;
+    std::vector<int> m_tintLocations;
+    unsigned int m_depthProgram = 0;
+    unsigned int m_proxyProgram = 0;
+    unsigned int m_debugProgram = 0;
+    MaterialTextures m_materials;
+    std::unique_ptr<Mesh> m_materialQuads;
+    unsigned int m_materialProgram = 0;
+    unsigned int m_textProgram = 0;
+    std::unique_ptr<GlyphSource> m_glyphSource;
+    std::vector<BenchmarkObject> m_objects;
+    uint32_t m_occluders = 0;
+    CullingBounds m_bounds;
+    std::vector<Aabb> m_boxes;
+    double m_compileMilliseconds = 0.0;
+    float m_farPlane = 100.0f;
+};
@@ -0,0 +1,88 @@
+#include "GoldenImage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//rgb is top row first, width * height * 3 bytes
+static bool writePpm(const std::string& path, int width, int height, const std::vector<unsigned char>& rgb) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "Can't write " << path << std::endl;
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write((const char*)rgb.data(), rgb.size());
+    return true;
+}
+
+static bool readPpm(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::string magic;
+    int maxValue = 0;
+    in >> magic >> width >> height >> maxValue;
+    in.get();   //the single whitespace before the pixels
+    if (magic != "P6" || width <= 0 || height <= 0 || maxValue != 255) {
+        std::cout << path << " isn't an 8 bit binary PPM" << std::endl;
+        return false;
+    }
+    rgb.resize((size_t)width * height * 3);
+    in.read((char*)rgb.data(), rgb.size());
+    return (size_t)in.gcount() == rgb.size();
+}
+
+//flips to top row first and drops alpha
+static std::vector<unsigned char> toRgb(const ReadbackImage& image) {
+    std::vector<unsigned char> rgb((size_t)image.width * image.height * 3);
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char* source = &image.pixels[(size_t)(image.height - 1 - y) * image.width * 4];
+        unsigned char* target = &rgb[(size_t)y * image.width * 3];
+        for (int x = 0; x < image.width; x++) {
+            target[x * 3 + 0] = source[x * 4 + 0];
+            target[x * 3 + 1] = source[x * 4 + 1];
+            target[x * 3 + 2] = source[x * 4 + 2];
+        }
+    }
+    return rgb;
+}
+
+bool writeGoldenImage(const std::string& path, const ReadbackImage& image) {
+    return writePpm(path, image.width, image.height, toRgb(image));
+}
+
+GoldenResult compareGoldenImage(const std::string& referencePath, const ReadbackImage& image,
+                                const GoldenTolerance& tolerance, const std::string& diffPath) {
+    GoldenResult result;
+    int width = 0, height = 0;
+    std::vector<unsigned char> reference;
+    if (!readPpm(referencePath, width, height, reference)) {
+        result.missing = true;
+        return result;
+    }
+    if (width != image.width || height != image.height) {
+        std::cout << referencePath << " is " << width << "x" << height << ", the frame " << image.width << "x" << image.height << std::endl;
+        return result;
+    }
+
+    std::vector<unsigned char> rendered = toRgb(image);
+    std::vector<unsigned char> diff(rendered.size());
+    for (size_t pixel = 0; pixel < rendered.size() / 3; pixel++) {
+        int difference = 0;
+        for (int channel = 0; channel < 3; channel++)
+            difference = std::max(difference, std::abs(rendered[pixel * 3 + channel] - reference[pixel * 3 + channel]));
+        result.maxDifference = std::max(result.maxDifference, difference);
+        const bool differs = difference > tolerance.channel;
+        if (differs)
+            result.differingPixels++;
+        for (int channel = 0; channel < 3; channel++)
+            diff[pixel * 3 + channel] = differs ? (channel == 0 ? 255 : 0) : rendered[pixel * 3 + channel] / 4;
+    }
+
+    result.matched = result.differingPixels <= tolerance.pixelFraction * (double)(width * height);
+    if (!result.matched)
+        writePpm(diffPath, width, height, diff);
+    return result;
+}
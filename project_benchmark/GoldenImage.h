@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "AsyncReadback.h"
+
+struct GoldenTolerance {
+    int channel = 2;                //per 8 bit channel, drivers round a little differently
+    double pixelFraction = 0.001;   //of the image that may differ by more than that
+};
+
+struct GoldenResult {
+    bool matched = false;
+    bool missing = false;           //no reference image to compare with
+    uint32_t differingPixels = 0;
+    int maxDifference = 0;          //largest channel difference
+};
+
+/*
+Golden Image
+    Reference images as binary PPM (P6), top row first like any image viewer expects. A
+    readback matches its reference when no more than pixelFraction of the pixels differ by
+    more than channel in any of R, G or B. Alpha isn't compared. On a mismatch the diff image
+    shows differing pixels in red over a darkened copy of the rendered frame.
+*/
+bool writeGoldenImage(const std::string& path, const ReadbackImage& image);
+
+GoldenResult compareGoldenImage(const std::string& referencePath, const ReadbackImage& image,
+                                const GoldenTolerance& tolerance, const std::string& diffPath);
@@ -0,0 +1,1286 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchmarkBaseline.h"
+#include "BenchmarkReport.h"
+#include "BenchmarkScene.h"
+#include "Bvh.h"
+#include "CommandList.h"
+#include "DebugDraw.h"
+#include "GoldenImage.h"
+#include "FrameCapture.h"
+#include "FrameGraph.h"
+#include "FrameStats.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+#include "MultiDrawBatch.h"
+#include "OcclusionCulling.h"
+#include "OcclusionQueries.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "TextRenderer.h"
+#include "TextureAtlas.h"
+#include "UniformBlocks.h"
+#include "UniformRing.h"
+
+/*
+Benchmark
+    Runs a scene script (a .scene file, see scenes/) headless: a hidden window for the context, an
+    offscreen target at the script's resolution, no vsync and a glFinish() at the end of
+    each frame, so a frame's time is the work itself. The warmup frames render the same
+    way but aren't measured.
+
+        project_benchmark scenes/default.scene [more scenes] [--out result.json] [--frames N] [--threads N]
+                          [--runs N] [--baseline baseline.json] [--write-baseline baseline.json]
+                          [--thread-sweep 1,2,4,8,16]
+
+    The result JSON has frame time percentiles (cpu, gpu and the whole frame), draw calls,
+    triangles and uniform upload bytes, shader compile and startup time, and commandStreamHash:
+    a hash of every frame's camera and submitted draws. Scene options add a section of their
+    own, see BenchmarkReport.h; "submit" is always there, the time spent issuing the draws, and
+    so is "profiler", what the profiler's scopes and endFrame() cost against the frame.
+    Two runs with the same hash drew the same thing, so their timings can be compared. With
+    several runs <scene>.benchmark.json (or --out, for a single scene) holds the last one.
+
+    --baseline makes it a regression gate: every scene runs --runs times (5 by default), the
+    medians are compared against the stored ones (see BenchmarkBaseline.h) and a regression
+    prints the diff table and exits with 1. --write-baseline stores the medians instead.
+
+    --golden <dir> checks the script's capture frames against <dir>/<scene>_<frame>.ppm in the
+    first run, a mismatch writes <scene>_<frame>.diff.ppm and also exits with 1. The frames come
+    back through AsyncReadback and are only compared after the last frame, so the run's timings
+    hold. --write-golden <dir> stores them as the new references, --pixel-tolerance sets how far
+    a channel may be off.
+
+    --thread-sweep runs every scene --runs times (5 by default) at each of the thread counts, the calling
+    thread included (--threads counts only the workers), and writes <scene>.threads.json: the
+    medians of the frame time and of the culling and moving jobs per count, and the speedup
+    over the first count. scenes/jobs.scene keeps the jobs busy and draws nothing. More threads
+    than cores measure the oversubscription, the hardwareThreads in the result says which is which.
+*/
+
+//FNV-1a 64
+struct CommandStreamHash {
+    uint64_t value = 14695981039346656037ull;
+
+    void add(const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            value ^= bytes[i];
+            value *= 1099511628211ull;
+        }
+    }
+    template <typename T>
+    void add(const T& field) { add(&field, sizeof(T)); }
+};
+
+//text: the codepoints a changing label is spelled from, all below U+0800 so two bytes each
+static const uint32_t TEXT_FIRST_CODEPOINT = 0x100;
+static const uint32_t TEXT_CODEPOINTS = 1024;
+static const uint32_t TEXT_WINDOW = 64;
+
+static void appendUtf8(std::string& text, uint32_t codepoint) {
+    text += (char)(0xC0 | codepoint >> 6);
+    text += (char)(0x80 | (codepoint & 0x3F));
+}
+
+struct GoldenCheck {
+    std::string directory;
+    bool write = false;
+    GoldenTolerance tolerance;
+    uint32_t checked = 0;
+    uint32_t failed = 0;    //including references that don't exist
+};
+
+struct FrameCounts {
+    uint64_t drawCalls = 0;     //including the depth pre-pass
+    uint64_t triangles = 0;
+    uint64_t uploadBytes = 0;
+
+    void add(uint64_t draws, uint64_t tris, uint64_t bytes) {
+        drawCalls += draws;
+        triangles += tris;
+        uploadBytes += bytes;
+    }
+};
+
+static void writeSummary(std::ostream& out, const FrameStats& stats, FrameMetric metric) {
+    const FrameMetricSummary summary = stats.summary(metric);
+    out << "\"" << frameMetricName(metric) << "\": {\"samples\": " << summary.samples << ", \"p50\": " << summary.p50
+        << ", \"p90\": " << summary.p90 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+}
+
+static bool writeResult(const std::string& path, const BenchmarkScript& script, const BenchmarkScene& scene, const FrameStats& stats,
+                        const FrameCounts& totals, const FrameCounts& peak, unsigned int threads, uint64_t hash, double startupMilliseconds,
+                        const BenchmarkReport& report) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Can't write the benchmark result to " << path << std::endl;
+        return false;
+    }
+
+    const double frames = (double)script.frames;
+    out << "{\n  \"scene\": \"" << script.name << "\",\n  \"frames\": " << script.frames << ",\n  \"warmupFrames\": " << script.warmupFrames
+        << ",\n  \"resolution\": [" << script.width << ", " << script.height << "],\n  \"objects\": " << script.objects
+        << ",\n  \"depthPrePass\": " << (script.depthPrePass ? "true" : "false") << ",\n  \"threads\": " << threads
+        << ",\n  \"renderer\": \"" << (const char*)glGetString(GL_RENDERER) << "\",\n  \"version\": \"" << (const char*)glGetString(GL_VERSION)
+        << "\",\n  \"commandStreamHash\": \"" << std::hex << hash << std::dec << "\",\n  \"shaderCompileMilliseconds\": " << scene.shaderCompileMilliseconds()
+        << ",\n  \"startupMilliseconds\": " << startupMilliseconds
+        << ",\n  \"perFrame\": {\"drawCalls\": " << totals.drawCalls / frames << ", \"triangles\": " << totals.triangles / frames
+        << ", \"uploadBytes\": " << totals.uploadBytes / frames << "},\n  \"peak\": {\"drawCalls\": " << peak.drawCalls
+        << ", \"triangles\": " << peak.triangles << ", \"uploadBytes\": " << peak.uploadBytes << "},\n  \"milliseconds\": {\n    ";
+    writeSummary(out, stats, FrameMetric::Cpu);
+    out << ",\n    ";
+    writeSummary(out, stats, FrameMetric::Gpu);
+    out << ",\n    ";
+    writeSummary(out, stats, FrameMetric::Present);
+    out << "\n  }";
+    report.write(out);
+    out << "\n}\n";
+    return true;
+}
+
+//the context is current, every GL object goes out of scope before it does
+static void checkGoldenImage(const BenchmarkScript& script, const ReadbackImage& image, GoldenCheck& golden) {
+    const std::string name = script.name + "_" + std::to_string(image.tag);
+    const std::string path = golden.directory + "/" + name + ".ppm";
+    if (golden.write) {
+        if (writeGoldenImage(path, image))
+            std::cout << "Golden image " << path << " written" << std::endl;
+        return;
+    }
+
+    golden.checked++;
+    const GoldenResult result = compareGoldenImage(path, image, golden.tolerance, name + ".diff.ppm");
+    if (result.missing)
+        std::cout << "No golden image " << path << ", write one with --write-golden" << std::endl;
+    else if (!result.matched)
+        std::cout << "Frame " << image.tag << " differs from " << path << " in " << result.differingPixels << " pixels, by up to "
+            << result.maxDifference << ", see " << name << ".diff.ppm" << std::endl;
+    if (!result.matched)
+        golden.failed++;
+}
+
+//uniforms direct: the queue's draws in sorted order, each with its PerDraw members set by glUniform*
+//from the object it was submitted for. Returns the draw calls
+static unsigned int executeDirect(const RenderQueue& queue, const BenchmarkScene& scene, const std::vector<uint32_t>& submitted) {
+    const unsigned int NONE = 0xFFFFFFFF;
+    unsigned int program = NONE;
+    unsigned int vertexArray = NONE;
+    for (size_t i = 0; i < queue.size(); i++) {
+        const uint32_t submission = queue.sortedIndex(i);
+        const DrawItem& item = queue.item(submission);
+        const BenchmarkObject& object = scene.objects()[submitted[submission]];
+        if (item.program != program) {
+            glUseProgram(item.program);
+            program = item.program;
+        }
+        if (item.vertexArray != vertexArray) {
+            glBindVertexArray(item.vertexArray);
+            vertexArray = item.vertexArray;
+        }
+        glUniformMatrix4fv(scene.modelLocation(object.program), 1, GL_FALSE, object.model.m);
+        glUniform4fv(scene.tintLocation(object.program), 1, object.tint);
+        glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (const void*)(item.firstIndex * sizeof(unsigned int)));
+    }
+    return (unsigned int)queue.size();
+}
+
+//occlusion queries: the queue's draws in sorted order, each inside its object's query or behind its
+//box's. A proxy changes the program and vertex array, so every draw binds its own. Returns the draw calls
+static unsigned int executeQueries(const RenderQueue& queue, const std::vector<uint32_t>& submitted, OcclusionQueries& queries) {
+    for (size_t i = 0; i < queue.size(); i++) {
+        const uint32_t submission = queue.sortedIndex(i);
+        const DrawItem& item = queue.item(submission);
+        queries.draw(submitted[submission], [&item]() {
+            glUseProgram(item.program);
+            glBindVertexArray(item.vertexArray);
+            UniformRing::bind(PerDraw::binding, item.perDraw);
+            glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (const void*)(item.firstIndex * sizeof(unsigned int)));
+        });
+    }
+    return (unsigned int)queue.size();
+}
+
+//framegraph on: a deferred frame into `output`, full resolution G-buffer and lighting, half resolution
+//ambient occlusion and bloom with separable blurs, tonemapping and antialiasing. The passes only clear
+//their targets, the graph is what's measured: the debug view nothing reads is culled, and each blur's
+//second half and the tonemapped image reuse targets that are done with by then
+static void buildDeferredGraph(FrameGraph& graph, FrameGraphResource output, int width, int height) {
+    auto clear = [](const FrameGraph&) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    };
+    auto nothing = [](const FrameGraph&) {};
+    const FrameGraphTextureDesc occlusionDesc = { width / 2, height / 2, GL_R8 };
+    const FrameGraphTextureDesc bloomDesc = { width / 2, height / 2, GL_RGBA16F };
+    FrameGraphResource albedo, normal, depth, lights, occlusion, occlusionBlurred, lit, bloom, bloomBlurred, toneMapped;
+    graph.addPass("gbuffer", [&](FrameGraphBuilder& builder) {
+        albedo = builder.createTexture("albedo", { width, height, GL_RGBA8 });
+        normal = builder.createTexture("normal", { width, height, GL_RGBA16F });
+        depth = builder.createTexture("depth", { width, height, GL_DEPTH24_STENCIL8 });
+    }, clear);
+    graph.addPass("light culling", [&](FrameGraphBuilder& builder) {
+        builder.read(depth);
+        //16x16 pixel tiles of up to 64 light indices
+        lights = builder.createBuffer("light lists", (size_t)(width / 16 + 1) * (height / 16 + 1) * 64 * sizeof(uint32_t));
+    }, nothing);
+    graph.addPass("ssao", [&](FrameGraphBuilder& builder) {
+        builder.read(normal);
+        builder.read(depth);
+        occlusion = builder.createTexture("occlusion", occlusionDesc);
+    }, clear);
+    graph.addPass("ssao blur x", [&](FrameGraphBuilder& builder) {
+        builder.read(occlusion);
+        occlusionBlurred = builder.createTexture("occlusion blurred x", occlusionDesc);
+    }, clear);
+    graph.addPass("ssao blur y", [&](FrameGraphBuilder& builder) {
+        builder.read(occlusionBlurred);
+        occlusion = builder.createTexture("occlusion blurred", occlusionDesc);
+    }, clear);
+    graph.addPass("lighting", [&](FrameGraphBuilder& builder) {
+        builder.read(albedo);
+        builder.read(normal);
+        builder.read(depth);
+        builder.read(lights);
+        builder.read(occlusion);
+        lit = builder.createTexture("lit", { width, height, GL_RGBA16F });
+    }, clear);
+    graph.addPass("debug view", [&](FrameGraphBuilder& builder) {
+        builder.read(normal);
+        builder.createTexture("debug", { width, height, GL_RGBA8 });
+    }, clear);
+    graph.addPass("bloom", [&](FrameGraphBuilder& builder) {
+        builder.read(lit);
+        bloom = builder.createTexture("bloom", bloomDesc);
+    }, clear);
+    graph.addPass("bloom blur x", [&](FrameGraphBuilder& builder) {
+        builder.read(bloom);
+        bloomBlurred = builder.createTexture("bloom blurred x", bloomDesc);
+    }, clear);
+    graph.addPass("bloom blur y", [&](FrameGraphBuilder& builder) {
+        builder.read(bloomBlurred);
+        bloom = builder.createTexture("bloom blurred", bloomDesc);
+    }, clear);
+    graph.addPass("tonemap", [&](FrameGraphBuilder& builder) {
+        builder.read(lit);
+        builder.read(bloom);
+        toneMapped = builder.createTexture("tonemapped", { width, height, GL_RGBA8 });
+    }, clear);
+    graph.addPass("antialias", [&](FrameGraphBuilder& builder) {
+        builder.read(toneMapped);
+        builder.write(output);
+    }, clear);
+    graph.markOutput(output);
+}
+
+//submit commandlist: list `index` of `lists` records its share of the sorted draws, skipping the
+//same redundant state execute() and executeDirect() skip. Runs as a job, so no GL here
+static void recordQueue(const RenderQueue& queue, const BenchmarkScene& scene, const std::vector<uint32_t>& submitted, bool direct,
+                        unsigned int index, unsigned int lists, CommandList& list) {
+    const unsigned int NONE = 0xFFFFFFFF;
+    unsigned int program = NONE;
+    unsigned int vertexArray = NONE;
+    const size_t begin = queue.size() * index / lists;
+    const size_t end = queue.size() * (index + 1) / lists;
+    for (size_t i = begin; i < end; i++) {
+        const uint32_t submission = queue.sortedIndex(i);
+        const DrawItem& item = queue.item(submission);
+        if (item.program != program) {
+            list.bindProgram(item.program);
+            program = item.program;
+        }
+        if (item.vertexArray != vertexArray) {
+            list.bindVertexArray(item.vertexArray);
+            vertexArray = item.vertexArray;
+        }
+        if (direct) {
+            const BenchmarkObject& object = scene.objects()[submitted[submission]];
+            list.setUniformMatrix4f(scene.modelLocation(object.program), object.model.m);
+            list.setUniform4f(scene.tintLocation(object.program), object.tint[0], object.tint[1], object.tint[2], object.tint[3]);
+        }
+        else {
+            list.bindUniformRange(PerDraw::binding, item.perDraw.buffer, item.perDraw.offset, item.perDraw.size);
+        }
+        list.drawElements(item.indexCount, item.firstIndex);
+    }
+}
+
+//the GL objects runBenchmark() creates itself rather than through a class that owns them, deleted
+//on every way out of it, failures included, so a failed scene leaves nothing behind for the next
+//what one PROFILE_SCOPE costs on the calling thread, two clock reads and a push into its ring,
+//drained by endFrame() between batches as a frame's would be. The markers compile out with
+//PROFILER_ENABLED 0, ProfileScope itself doesn't, so this is the same with either
+static double profileScopeNanoseconds() {
+    static const int BATCHES = 16;
+    static const int SCOPES_PER_BATCH = 4096;
+    uint64_t nanoseconds = 0;
+    for (int batch = 0; batch < BATCHES; batch++) {
+        Profiler::get().beginFrame();
+        const uint64_t start = Profiler::now();
+        for (int scope = 0; scope < SCOPES_PER_BATCH; scope++)
+            ProfileScope calibrate("Calibrate");
+        nanoseconds += Profiler::now() - start;
+        Profiler::get().endFrame();
+    }
+    return (double)nanoseconds / (BATCHES * SCOPES_PER_BATCH);
+}
+
+struct BenchmarkTargets {
+    unsigned int framebuffer = 0;
+    unsigned int renderbuffers[2] = {};
+    unsigned int frameGraphOutput = 0;     //framegraph on
+
+    BenchmarkTargets() = default;
+    BenchmarkTargets(const BenchmarkTargets&) = delete;
+    BenchmarkTargets& operator=(const BenchmarkTargets&) = delete;
+    ~BenchmarkTargets() {
+        glDeleteTextures(1, &frameGraphOutput);
+        glDeleteRenderbuffers(2, renderbuffers);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+};
+
+//golden is null when there's nothing to check, report gets the scene options' sections
+static bool runBenchmark(const BenchmarkScript& script, int threads, const std::string& outPath, SceneMetrics& metrics, BenchmarkReport& report,
+                         GoldenCheck* golden) {
+    //startup is everything between having a context and the first frame: targets, meshes, shaders, threads
+    const auto startup = std::chrono::high_resolution_clock::now();
+    BenchmarkTargets targets;
+    unsigned int& framebuffer = targets.framebuffer;
+    unsigned int* renderbuffers = targets.renderbuffers;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, script.width, script.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, script.width, script.height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Can't create a " << script.width << "x" << script.height << " target" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, script.width, script.height);
+    glEnable(GL_DEPTH_TEST);
+
+    BenchmarkScene scene;
+    if (!scene.create(script)) {
+        return false;
+    }
+
+    JobSystem jobs;
+    jobs.init(threads >= 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    FrustumCuller culler;
+    culler.setJobSystem(&jobs);
+    OcclusionRasterizer occlusion;
+    if (script.occlusion == OcclusionPath::Cpu) {
+        occlusion.init();
+        occlusion.setJobSystem(&jobs);
+    }
+    OcclusionQueries queries;
+    if (script.occlusion == OcclusionPath::Queries) {
+        if (!queries.init(scene.proxyProgram()))
+            return false;
+        //one per object, under the object's own index
+        for (const Aabb& box : scene.boxes())
+            queries.addObject(box);
+    }
+    //room for every line in a single thread's buffer, whichever threads the jobs land on
+    DebugDraw debugDraw(std::max(script.debugLines, 1u));
+    ImmediateMode immediate;
+    if (script.debugLines > 0 && !immediate.init(scene.debugProgram(), std::max<size_t>(4 * 1024 * 1024, script.debugLines * 2 * sizeof(ImmediateVertex))))
+        return false;
+    //images 8 to 64 pixels a side, about 3.3 pages worth for 10k of them
+    static const int ATLAS_PAGE_SIZE = 2048;
+    static const unsigned int ATLAS_MAX_PAGES = 8;
+    static const unsigned int ATLAS_REPACK_FRAMES = 8;
+    TextureAtlas atlas;
+    std::vector<AtlasHandle> atlasHandles;
+    std::vector<unsigned char> atlasPixels(64 * 64 * 4);
+    for (size_t i = 0; i < atlasPixels.size(); i++)
+        atlasPixels[i] = (unsigned char)(i * 7);
+    uint32_t atlasState = script.seed;
+    auto atlasRandom = [&atlasState](int low, int high) {
+        atlasState = atlasState * 1664525u + 1013904223u;
+        return low + (int)((atlasState >> 8) % (uint32_t)(high - low + 1));
+    };
+    unsigned int atlasFailed = 0;
+    auto atlasInsert = [&]() {
+        const AtlasHandle handle = atlas.insert(atlasRandom(8, 64), atlasRandom(8, 64), atlasPixels.data());
+        if (handle == INVALID_ATLAS_HANDLE)
+            atlasFailed++;
+        else
+            atlasHandles.push_back(handle);
+    };
+    double atlasFillMilliseconds = 0.0;
+    double atlasFillPackMilliseconds = 0.0;
+    float atlasFillOccupancy = 0.0f;
+    if (script.atlasImages > 0) {
+        if (!atlas.init(ATLAS_PAGE_SIZE, ATLAS_MAX_PAGES))
+            return false;
+        const auto fillStart = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < script.atlasImages; i++)
+            atlasInsert();
+        glFinish();
+        atlasFillMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - fillStart).count();
+        atlasFillPackMilliseconds = atlas.stats().insertMilliseconds;
+        for (float occupancy : atlas.stats().occupancy)
+            atlasFillOccupancy += occupancy / atlas.stats().pages;
+    }
+    MultiDrawBatch materialBatch;
+    FrameCapture capture;
+    if (!script.record.empty() && !capture.init())
+        return false;
+    //text: the labels that never change are spelled once, as an application's would be
+    static const unsigned int TEXT_COLUMNS = 16;
+    static const float TEXT_SIZE = 12.0f;
+    TextRenderer text;
+    std::vector<std::string> textLabels;
+    std::string textChanged;
+    if (script.textLabels > 0) {
+        if (!text.init(scene.textProgram(), scene.glyphSource()))
+            return false;
+        for (unsigned int label = 0; label < script.textLabels; label++)
+            textLabels.push_back("Object " + std::to_string(label));
+    }
+    FrameGraph frameGraph;
+    unsigned int& frameGraphOutput = targets.frameGraphOutput;
+    if (script.frameGraph) {
+        glGenTextures(1, &frameGraphOutput);
+        glBindTexture(GL_TEXTURE_2D, frameGraphOutput);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, script.width, script.height);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    std::vector<uint32_t> visible;
+    Bvh bvh;
+    double bvhBuildMilliseconds = 0.0;
+    if (script.culling == CullingPath::Bvh) {
+        bvh.build(scene.boxes());
+        bvhBuildMilliseconds = bvh.stats().buildMilliseconds;
+    }
+
+    RenderQueue renderQueue;
+    UniformRing uniformRing;
+    //every block on its own offset alignment, 256 at most. Only PerFrame when nothing is drawn
+    if (!uniformRing.init(script.draw ? (script.objects + 1) * 256 + 256 : 256))
+        return false;
+    FrameStats frameStats(script.frames);
+    frameStats.init();
+    AsyncReadback readback;
+    std::vector<unsigned int> captureFrames = script.captureFrames;
+    if (golden) {
+        readback.init();
+        if (captureFrames.empty())
+            captureFrames.push_back(script.frames - 1);
+    }
+    std::vector<ReadbackImage> captured;
+    std::vector<uint32_t> submitted;    //the object behind every queue submission
+    const bool direct = script.uniforms == UniformPath::Direct;
+    std::unique_ptr<CommandListSet> commandLists;
+    if (script.submit == SubmitPath::CommandList)
+        commandLists.reset(new CommandListSet(jobs.threadCount(), &jobs));
+    const double startupMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startup).count();
+    const double scopeNanoseconds = profileScopeNanoseconds();
+
+    std::cout << script.name << ": " << script.objects << " objects, " << script.warmupFrames << " + " << script.frames << " frames at "
+        << script.width << "x" << script.height << " on " << glGetString(GL_RENDERER) << ", " << jobs.threadCount() << " threads" << std::endl;
+
+    CommandStreamHash hash;
+    FrameCounts totals;
+    FrameCounts peak;
+    double submitMilliseconds = 0.0;
+    uint64_t uniformBinds = 0;
+    double recordMilliseconds = 0.0;
+    uint64_t commands = 0;
+    double cullMilliseconds = 0.0;
+    uint64_t culledVisible = 0;
+    double animateMilliseconds = 0.0;
+    double refitMilliseconds = 0.0;
+    uint64_t nodesVisited = 0;
+    OcclusionStats occlusionTotals;
+    OcclusionQueryStats queryTotals;
+    double debugPushMilliseconds = 0.0;
+    double debugFlushMilliseconds = 0.0;
+    double debugUploadMilliseconds = 0.0;
+    uint64_t debugLinesDrawn = 0;
+    uint64_t debugLinesDropped = 0;
+    uint32_t debugThreadBuffers = 0;
+    double atlasChurnMilliseconds = 0.0;
+    double frameGraphCompileMilliseconds = 0.0;
+    double captureIssueMilliseconds = 0.0;
+    double materialMilliseconds = 0.0;
+    uint64_t materialDraws = 0;
+    uint64_t materialDrawCalls = 0;
+    double frameGraphExecuteMilliseconds = 0.0;
+    uint64_t atlasReplaced = 0;
+    double atlasWaitMilliseconds = 0.0;
+    unsigned int atlasRepackFrames = 0;     //left until the running repack is waited for
+    double textSubmitMilliseconds = 0.0;
+    double textFlushMilliseconds = 0.0;
+    TextStats textTotals;
+    uint64_t profileScopes = 0;
+    double profileEndFrameMilliseconds = 0.0;
+    double wholeFrameMilliseconds = 0.0;
+    for (int frame = -(int)script.warmupFrames; frame < (int)script.frames; frame++) {
+        const bool measured = frame >= 0;
+        const auto start = std::chrono::high_resolution_clock::now();
+        Profiler::get().beginFrame();
+        if (measured)
+            frameStats.beginGpu();
+        //only copied out here, comparing waits for the end of the run
+        ReadbackImage image;
+        while (readback.poll(image))
+            captured.push_back(std::move(image));
+
+        uniformRing.beginFrame();
+        //time advances by the frame, never by the clock
+        PerFrame perFrame = { scene.viewProjection(frame), { frame / 60.0f, 0.0f, 0.0f, 0.0f } };
+        const UniformAllocation frameBlock = uniformRing.push(perFrame);
+        if (frameBlock.size == 0) {
+            std::cout << "No room for PerFrame in the uniform ring, frame " << frame << " can't be drawn" << std::endl;
+            return false;
+        }
+        UniformRing::bind(PerFrame::binding, frameBlock);
+        hash.add(frame);
+        hash.add(perFrame);
+
+        if (script.moving > 0.0f) {
+            const auto animateStart = std::chrono::high_resolution_clock::now();
+            scene.animate(frame, &jobs);
+            if (script.occlusion == OcclusionPath::Queries) {
+                for (uint32_t index = 0; index < (uint32_t)(script.moving * script.objects); index++)
+                    queries.setBounds(index, scene.boxes()[index]);
+            }
+            if (measured)
+                animateMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - animateStart).count();
+        }
+
+        const Vec3 eye = scene.cameraPosition(frame);
+        const Vec3 forward = { -eye.x, -eye.y, -eye.z };
+        const float distance = std::sqrt(forward.x * forward.x + forward.y * forward.y + forward.z * forward.z);
+        visible.clear();
+        const Frustum frustum = Frustum::fromMatrix(perFrame.viewProjection.m);
+        if (script.culling == CullingPath::Bvh) {
+            if (script.moving > 0.0f) {
+                bvh.refit(scene.boxes());
+                if (measured)
+                    refitMilliseconds += bvh.stats().refitMilliseconds;
+            }
+            bvh.query(frustum, visible);
+            if (measured) {
+                cullMilliseconds += bvh.stats().queryMilliseconds;
+                nodesVisited += bvh.stats().nodesVisited;
+            }
+        }
+        else {
+            culler.cull(frustum, scene.bounds(), visible);
+            if (measured)
+                cullMilliseconds += culler.stats().milliseconds;
+        }
+        hash.add((uint32_t)visible.size());
+        if (measured)
+            culledVisible += visible.size();
+        if (script.occlusion == OcclusionPath::Cpu) {
+            //the buildings in view occlude and are always drawn, everything else is tested against them
+            occlusion.beginFrame(perFrame.viewProjection.m);
+            for (uint32_t index : visible) {
+                if (index < scene.occluders())
+                    occlusion.addOccluderBox(scene.boxes()[index]);
+            }
+            occlusion.rasterize();
+            size_t kept = 0;
+            for (uint32_t index : visible) {
+                const unsigned int triangles = scene.mesh(scene.objects()[index].mesh).indexCount() / 3;
+                if (index < scene.occluders() || occlusion.isVisible(scene.boxes()[index], triangles))
+                    visible[kept++] = index;
+            }
+            visible.resize(kept);
+            hash.add((uint32_t)visible.size());
+            if (measured) {
+                const OcclusionStats& stats = occlusion.stats();
+                occlusionTotals.occluderTriangles += stats.occluderTriangles;
+                occlusionTotals.rasterizedTriangles += stats.rasterizedTriangles;
+                occlusionTotals.occludeesTested += stats.occludeesTested;
+                occlusionTotals.occludeesCulled += stats.occludeesCulled;
+                occlusionTotals.trianglesTested += stats.trianglesTested;
+                occlusionTotals.trianglesCulled += stats.trianglesCulled;
+                occlusionTotals.rasterMilliseconds += stats.rasterMilliseconds;
+                occlusionTotals.testMilliseconds += stats.testMilliseconds;
+            }
+        }
+        uint64_t triangles = 0;
+        uint64_t uploads = 0;
+        uint64_t draws = 0;
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (script.draw) {
+            submitted.clear();
+            for (uint32_t index : visible) {
+                const BenchmarkObject& object = scene.objects()[index];
+                const Mesh& mesh = scene.mesh(object.mesh);
+                PerDraw perDraw = { object.model, { object.tint[0], object.tint[1], object.tint[2], object.tint[3] } };
+                UniformAllocation allocation = { 0, 0, 0 };
+                if (direct) {
+                    uploads += sizeof(PerDraw);     //what the glUniform* calls will send
+                }
+                else {
+                    allocation = uniformRing.push(perDraw);
+                    if (allocation.size == 0)
+                        continue;
+                }
+                submitted.push_back(index);
+                //view depth along the camera's line of sight, the camera always looks at the origin
+                const float* position = &object.model.m[12];
+                const float depth = ((position[0] - eye.x) * forward.x + (position[1] - eye.y) * forward.y + (position[2] - eye.z) * forward.z) / distance;
+                renderQueue.submit(0, false, std::min(std::max(depth / scene.farPlane(), 0.0f), 1.0f),
+                    { scene.program(object.program), 0, mesh.vertexArray(), mesh.indexCount(), 0, allocation, mesh.positionVertexArray() });
+                triangles += mesh.indexCount() / 3;
+                hash.add(object.program);
+                hash.add(object.mesh);
+                hash.add(perDraw);
+            }
+            uniformRing.flush();
+
+            renderQueue.sort();
+            if (script.depthPrePass)
+                renderQueue.executeDepthOnly(scene.depthProgram());
+            if (commandLists) {
+                commandLists->record([&](unsigned int list, CommandList& commandList) {
+                    recordQueue(renderQueue, scene, submitted, direct, list, commandLists->listCount(), commandList);
+                });
+            }
+            const auto submitStart = std::chrono::high_resolution_clock::now();
+            unsigned int shadingDraws;
+            if (commandLists) {
+                if (script.depthPrePass) {
+                    glDepthFunc(GL_EQUAL);
+                    glDepthMask(GL_FALSE);
+                }
+                commandLists->replay();
+                if (script.depthPrePass) {
+                    glDepthFunc(GL_LESS);
+                    glDepthMask(GL_TRUE);
+                }
+                shadingDraws = (unsigned int)renderQueue.size();
+            }
+            else if (direct) {
+                shadingDraws = executeDirect(renderQueue, scene, submitted);
+            }
+            else if (script.occlusion == OcclusionPath::Queries) {
+                //the last frame's results, whatever has arrived. Proxies aren't counted as draws, how
+                //many there are depends on the GPU's timing and would make the draw count vary
+                queries.beginFrame();
+                shadingDraws = executeQueries(renderQueue, submitted, queries);
+                if (measured) {
+                    const OcclusionQueryStats& stats = queries.stats();
+                    queryTotals.queries += stats.queries;
+                    queryTotals.proxies += stats.proxies;
+                    queryTotals.resultsRead += stats.resultsRead;
+                    queryTotals.stallsAvoided += stats.stallsAvoided;
+                    queryTotals.occluded += stats.occluded;
+                }
+            }
+            else {
+                renderQueue.execute(script.depthPrePass);
+                shadingDraws = renderQueue.stats().drawCalls;
+            }
+            const double submitFrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
+            const RenderQueueStats& queue = renderQueue.stats();
+            draws = shadingDraws + (script.depthPrePass ? queue.depthDrawCalls : 0);
+            if (!direct)
+                uploads = uniformRing.stats().bytes;
+            if (measured) {
+                submitMilliseconds += submitFrameMilliseconds;
+                uniformBinds += queue.uniformBinds;
+                if (commandLists) {
+                    recordMilliseconds += commandLists->stats().recordMilliseconds;
+                    commands += commandLists->stats().commands;
+                }
+            }
+            if (commandLists)
+                commandLists->reset();
+            renderQueue.clear();
+        }
+        if (script.materials > 0) {
+            //every quad its own draw with its own texture, and still one call: the material id comes
+            //from baseInstance, the texture from the material buffer
+            const auto materialStart = std::chrono::high_resolution_clock::now();
+            const MaterialTextures& materials = scene.materials();
+            glUseProgram(scene.materialProgram());
+            glBindVertexArray(scene.materialQuads().vertexArray());
+            materials.bind();
+            for (unsigned int material = 0; material < materials.materialCount(); material++)
+                materialBatch.add(scene.materialQuads().indexCount(), 0, (int)material * 4, material);
+            materialBatch.flush();
+            const MultiDrawStats& stats = materialBatch.stats();
+            draws += stats.drawCalls;
+            triangles += stats.submitted * 2;
+            hash.add(stats.submitted);
+            if (measured) {
+                materialMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - materialStart).count();
+                materialDraws += stats.submitted;
+                materialDrawCalls += stats.drawCalls;
+            }
+        }
+        if (script.debugLines > 0 && !scene.boxes().empty()) {
+            //along the objects' box diagonals, the first fraction of them pushed by the jobs
+            const uint32_t fromJobs = (uint32_t)(script.debugLines * script.debugLinesFromJobs);
+            const std::vector<Aabb>& boxes = scene.boxes();
+            auto pushLines = [&](uint32_t begin, uint32_t end) {
+                for (uint32_t line = begin; line < end; line++) {
+                    const Aabb& box = boxes[line % boxes.size()];
+                    debugDraw.line(box.min, box.max, 0xFF000000u | (line * 2654435761u) >> 8);
+                }
+            };
+            const auto pushStart = std::chrono::high_resolution_clock::now();
+            jobs.parallelFor(fromJobs, 1024, pushLines);
+            pushLines(fromJobs, script.debugLines);
+            const double pushFrameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pushStart).count();
+            debugDraw.flush(immediate, 1.0f / 60.0f);
+            immediate.flush(perFrame.viewProjection.m);
+            draws += immediate.stats().drawCalls;
+            hash.add(debugDraw.stats().lines);
+            if (measured) {
+                debugPushMilliseconds += pushFrameMilliseconds;
+                debugFlushMilliseconds += debugDraw.stats().flushMilliseconds;
+                debugUploadMilliseconds += immediate.stats().uploadMilliseconds;
+                debugLinesDrawn += debugDraw.stats().lines;
+                debugLinesDropped += debugDraw.stats().droppedLines;
+                debugThreadBuffers = debugDraw.stats().threadBuffers;
+            }
+        }
+        if (script.frameGraph) {
+            const auto compileStart = std::chrono::high_resolution_clock::now();
+            const FrameGraphResource output = frameGraph.importTexture("output", frameGraphOutput, { (int)script.width, (int)script.height, GL_RGBA8 });
+            buildDeferredGraph(frameGraph, output, (int)script.width, (int)script.height);
+            frameGraph.compile();
+            const auto executeStart = std::chrono::high_resolution_clock::now();
+            frameGraph.execute();
+            if (measured) {
+                frameGraphCompileMilliseconds += std::chrono::duration<double, std::milli>(executeStart - compileStart).count();
+                frameGraphExecuteMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - executeStart).count();
+            }
+            hash.add(frameGraph.stats().passes - frameGraph.stats().culledPasses);
+            //the stats hold until the next compile(), reset() only forgets the passes
+            frameGraph.reset();
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glViewport(0, 0, script.width, script.height);
+        }
+        if (script.atlasImages > 0) {
+            const auto churnStart = std::chrono::high_resolution_clock::now();
+            //a repack gets ATLAS_REPACK_FRAMES frames without edits to run in the background and is
+            //then waited for, so every run replaces the same images on the same frames
+            unsigned int replace = 0;
+            if (atlasRepackFrames > 0) {
+                if (--atlasRepackFrames == 0) {
+                    const auto waitStart = std::chrono::high_resolution_clock::now();
+                    atlas.finishRepack();
+                    if (measured)
+                        atlasWaitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - waitStart).count();
+                }
+            }
+            else {
+                replace = std::min<unsigned int>((unsigned int)(script.atlasImages * script.atlasChurn), (unsigned int)atlasHandles.size());
+                for (unsigned int i = 0; i < replace; i++) {
+                    const size_t victim = (size_t)atlasRandom(0, (int)atlasHandles.size() - 1);
+                    atlas.remove(atlasHandles[victim]);
+                    atlasHandles[victim] = atlasHandles.back();
+                    atlasHandles.pop_back();
+                }
+                const size_t kept = atlasHandles.size();
+                for (unsigned int i = 0; i < replace; i++)
+                    atlasInsert();
+                for (size_t i = kept; i < atlasHandles.size(); i++) {
+                    AtlasRegion region;
+                    atlas.region(atlasHandles[i], region);
+                    hash.add(atlasHandles[i]);
+                    hash.add(region);
+                }
+                atlas.update();
+                if (atlas.repacking())
+                    atlasRepackFrames = ATLAS_REPACK_FRAMES;
+            }
+            hash.add(replace);
+            hash.add(atlas.version());
+            if (measured) {
+                atlasChurnMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - churnStart).count();
+                atlasReplaced += replace;
+            }
+        }
+        if (script.textLabels > 0) {
+            //the changing labels are new strings every frame, a layout each, and take 8 glyphs each from a
+            //window moving 8 codepoints a frame: new glyphs arrive every frame and the page starts
+            //evicting once it has seen enough of them
+            const unsigned int changing = (unsigned int)(script.textLabels * script.textChanging);
+            const uint32_t window = (uint32_t)(frame + (int)script.warmupFrames) * 8;
+            const float columnWidth = (float)script.width / TEXT_COLUMNS;
+            const auto submitStart = std::chrono::high_resolution_clock::now();
+            for (unsigned int label = 0; label < script.textLabels; label++) {
+                const float x = (label % TEXT_COLUMNS) * columnWidth;
+                const float y = std::fmod((label / TEXT_COLUMNS) * TEXT_SIZE * 1.25f, (float)script.height);
+                if (label < changing) {
+                    textChanged = std::to_string(frame) + ":" + std::to_string(label) + " ";
+                    for (uint32_t glyph = 0; glyph < 8; glyph++)
+                        appendUtf8(textChanged, TEXT_FIRST_CODEPOINT + (window + (label * 3 + glyph) % TEXT_WINDOW) % TEXT_CODEPOINTS);
+                }
+                text.draw(label < changing ? textChanged : textLabels[label], x, y, TEXT_SIZE, 0xFFFFFFFFu);
+            }
+            const auto flushStart = std::chrono::high_resolution_clock::now();
+            text.flush(script.width, script.height);
+            const TextStats& stats = text.stats();
+            draws += stats.drawCalls;
+            triangles += stats.glyphs * 2;
+            hash.add(stats.glyphs);
+            hash.add(stats.rasterized);
+            hash.add(stats.evictions);
+            hash.add(stats.droppedGlyphs);
+            if (measured) {
+                textSubmitMilliseconds += std::chrono::duration<double, std::milli>(flushStart - submitStart).count();
+                textFlushMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - flushStart).count();
+                textTotals.glyphs += stats.glyphs;
+                textTotals.drawCalls += stats.drawCalls;
+                textTotals.layoutMisses += stats.layoutMisses;
+                textTotals.rasterized += stats.rasterized;
+                textTotals.evictions += stats.evictions;
+                textTotals.droppedGlyphs += stats.droppedGlyphs;
+                textTotals.rasterMilliseconds += stats.rasterMilliseconds;
+                textTotals.uploadMilliseconds += stats.uploadMilliseconds;
+                textTotals.layouts = stats.layouts;
+            }
+        }
+        if (!script.record.empty() && measured) {
+            //after everything drawn, as an application would before its swap
+            if (frame == 0) {
+                const CaptureFormat format = script.record == "png" ? CaptureFormat::Png : script.record == "qoi" ? CaptureFormat::Qoi : CaptureFormat::Y4m;
+                capture.startSequence(script.name + "." + script.record, format, 60);
+            }
+            if (frame == (int)script.frames / 2)
+                capture.screenshot(script.name + "_screenshot." + script.record);
+            capture.frame(script.width, script.height);
+            captureIssueMilliseconds += capture.stats().issueMilliseconds;
+        }
+        if (golden && measured && std::find(captureFrames.begin(), captureFrames.end(), (unsigned int)frame) != captureFrames.end())
+            readback.request(0, 0, script.width, script.height, frame);
+        uniformRing.endFrame();
+
+        if (measured)
+            frameStats.endGpu();
+        const double cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        glFinish();
+        Profiler::get().endFrame();
+        if (!measured)
+            continue;
+        frameStats.endFrame(cpuMilliseconds);
+        //the Frame scope endFrame() records itself is only drained next frame, it is counted there
+        profileScopes += Profiler::get().stats().cpuEvents;
+        profileEndFrameMilliseconds += Profiler::get().stats().endFrameMilliseconds;
+        wholeFrameMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        totals.add(draws, triangles, uploads);
+        peak.drawCalls = std::max(peak.drawCalls, draws);
+        peak.triangles = std::max(peak.triangles, triangles);
+        peak.uploadBytes = std::max(peak.uploadBytes, uploads);
+    }
+
+    ReadbackImage image;
+    while (readback.wait(image))
+        captured.push_back(std::move(image));
+    for (const ReadbackImage& capturedImage : captured)
+        checkGoldenImage(script, capturedImage, *golden);
+    if (readback.stats().dropped > 0)
+        std::cout << readback.stats().dropped << " capture frames dropped, they came too close together" << std::endl;
+
+    const double frames = (double)script.frames;
+    report = BenchmarkReport();
+    report.add("culling", "path", cullingPathName(script.culling));
+    if (script.culling == CullingPath::Flat)
+        report.add("culling", "simd", simdLevelName(culler.simdLevel()));
+    report.add("culling", "objects", script.objects);
+    report.add("culling", "visiblePerFrame", culledVisible / frames);
+    report.add("culling", "milliseconds", cullMilliseconds / frames);
+    report.add("culling", "objectsPerMillisecond", cullMilliseconds > 0.0 ? script.objects * frames / cullMilliseconds : 0.0);
+    if (script.moving > 0.0f) {
+        report.add("moving", "objects", (uint32_t)(script.moving * script.objects));
+        report.add("moving", "milliseconds", animateMilliseconds / frames);
+    }
+    if (script.culling == CullingPath::Bvh) {
+        const BvhStats& stats = bvh.stats();
+        report.add("bvh", "nodes", stats.nodes);
+        report.add("bvh", "buildMilliseconds", bvhBuildMilliseconds);
+        report.add("bvh", "refitMilliseconds", refitMilliseconds / frames);
+        report.add("bvh", "queryMilliseconds", cullMilliseconds / frames);
+        report.add("bvh", "nodesVisitedPerFrame", nodesVisited / frames);
+        report.add("bvh", "subtreeRebuilds", stats.subtreeRebuilds);
+        report.add("bvh", "rebuilds", stats.rebuilds);
+        report.add("bvh", "buildCost", stats.buildCost);
+        report.add("bvh", "cost", stats.cost);
+    }
+    if (script.occlusion == OcclusionPath::Cpu) {
+        report.add("occlusion", "path", occlusionPathName(script.occlusion));
+        report.add("occlusion", "occluderTrianglesPerFrame", occlusionTotals.occluderTriangles / frames);
+        report.add("occlusion", "rasterizedTrianglesPerFrame", occlusionTotals.rasterizedTriangles / frames);
+        report.add("occlusion", "testedPerFrame", occlusionTotals.occludeesTested / frames);
+        report.add("occlusion", "culledPerFrame", occlusionTotals.occludeesCulled / frames);
+        report.add("occlusion", "trianglesTestedPerFrame", occlusionTotals.trianglesTested / frames);
+        report.add("occlusion", "trianglesCulledPerFrame", occlusionTotals.trianglesCulled / frames);
+        report.add("occlusion", "rasterMilliseconds", occlusionTotals.rasterMilliseconds / frames);
+        report.add("occlusion", "testMilliseconds", occlusionTotals.testMilliseconds / frames);
+    }
+    if (script.occlusion == OcclusionPath::Queries) {
+        report.add("occlusion", "path", occlusionPathName(script.occlusion));
+        report.add("occlusion", "queriesPerFrame", queryTotals.queries / frames);
+        report.add("occlusion", "proxiesPerFrame", queryTotals.proxies / frames);
+        report.add("occlusion", "resultsReadPerFrame", queryTotals.resultsRead / frames);
+        report.add("occlusion", "stallsAvoidedPerFrame", queryTotals.stallsAvoided / frames);
+        report.add("occlusion", "occludedPerFrame", queryTotals.occluded / frames);
+        report.add("occlusion", "pooledQueries", queries.stats().pooledQueries);
+    }
+    if (!script.record.empty()) {
+        //what the writer hadn't got to by the last frame, then everything written
+        const FrameCaptureStats last = capture.stats();
+        const auto drainStart = std::chrono::high_resolution_clock::now();
+        capture.shutdown();
+        const double drainMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - drainStart).count();
+        const FrameCaptureStats stats = capture.stats();
+        report.add("record", "format", script.record);
+        report.add("record", "requested", stats.requested);
+        report.add("record", "written", stats.written);
+        report.add("record", "dropped", stats.dropped);
+        report.add("record", "queuedAtLastFrame", last.requested - last.written - last.dropped);
+        report.add("record", "drainMilliseconds", drainMilliseconds);
+        report.add("record", "issueMilliseconds", captureIssueMilliseconds / frames);
+        report.add("record", "writerMillisecondsPerFrame", stats.writerMilliseconds / std::max(stats.written, 1u));
+        report.add("record", "writerFramesPerSecond", stats.written / std::max(stats.writerMilliseconds / 1000.0, 1e-9));
+        report.add("record", "writerMegabytesPerSecond", stats.bytesWritten / 1e6 / std::max(stats.writerMilliseconds / 1000.0, 1e-9));
+    }
+    if (script.debugLines > 0) {
+        //pushMilliseconds is every thread's line() calls, flush and upload are the render thread's part
+        report.add("debugdraw", "linesPerFrame", debugLinesDrawn / frames);
+        report.add("debugdraw", "fromJobs", (uint32_t)(script.debugLines * script.debugLinesFromJobs));
+        report.add("debugdraw", "threadBuffers", debugThreadBuffers);
+        report.add("debugdraw", "droppedPerFrame", debugLinesDropped / frames);
+        report.add("debugdraw", "pushMilliseconds", debugPushMilliseconds / frames);
+        report.add("debugdraw", "flushMilliseconds", debugFlushMilliseconds / frames);
+        report.add("debugdraw", "uploadMilliseconds", debugUploadMilliseconds / frames);
+    }
+    {
+        //every thread's scopes at the calibrated cost plus endFrame(), against the whole frame. With
+        //PROFILER_ENABLED 0 only the Frame scope is left, which puts a number on compiling them out
+        const double scopeMilliseconds = profileScopes * scopeNanoseconds / 1e6;
+        const double overheadMilliseconds = (scopeMilliseconds + profileEndFrameMilliseconds) / frames;
+        report.add("profiler", "enabled", PROFILER_ENABLED ? "on" : "off");
+        report.add("profiler", "scopesPerFrame", profileScopes / frames);
+        report.add("profiler", "scopeNanoseconds", scopeNanoseconds);
+        report.add("profiler", "scopeMilliseconds", scopeMilliseconds / frames);
+        report.add("profiler", "endFrameMilliseconds", profileEndFrameMilliseconds / frames);
+        report.add("profiler", "overheadMilliseconds", overheadMilliseconds);
+        report.add("profiler", "overheadPercent", 100.0 * overheadMilliseconds / std::max(wholeFrameMilliseconds / frames, 1e-9));
+    }
+    if (script.textLabels > 0) {
+        //submit is the draw() calls, flush the instance upload and the draw; raster and upload are the
+        //glyphs that had to go into the page, part of whichever of the two asked for them
+        report.add("text", "labels", script.textLabels);
+        report.add("text", "changingLabels", (uint32_t)(script.textLabels * script.textChanging));
+        report.add("text", "glyphsPerFrame", textTotals.glyphs / frames);
+        report.add("text", "drawCallsPerFrame", textTotals.drawCalls / frames);
+        report.add("text", "layoutMissesPerFrame", textTotals.layoutMisses / frames);
+        report.add("text", "layouts", textTotals.layouts);
+        report.add("text", "rasterizedPerFrame", textTotals.rasterized / frames);
+        report.add("text", "evictionsPerFrame", textTotals.evictions / frames);
+        report.add("text", "droppedGlyphsPerFrame", textTotals.droppedGlyphs / frames);
+        report.add("text", "submitMilliseconds", textSubmitMilliseconds / frames);
+        report.add("text", "flushMilliseconds", textFlushMilliseconds / frames);
+        report.add("text", "rasterMilliseconds", textTotals.rasterMilliseconds / frames);
+        report.add("text", "uploadMilliseconds", textTotals.uploadMilliseconds / frames);
+    }
+    if (script.materials > 0) {
+        //draws is what it took before, a draw call and a texture bind per material
+        const bool bindless = scene.materials().mode() == MaterialTextureMode::Bindless;
+        report.add("materials", "mode", bindless ? "bindless" : "array");
+        report.add("materials", "requestedMode", script.bindlessMaterials ? "bindless" : "array");
+        report.add("materials", "materials", scene.materials().materialCount());
+        report.add("materials", "drawsPerFrame", materialDraws / frames);
+        report.add("materials", "drawCallsPerFrame", materialDrawCalls / frames);
+        report.add("materials", "textureBindsPerFrame", bindless ? 0 : 1);
+        report.add("materials", "milliseconds", materialMilliseconds / frames);
+    }
+    if (script.frameGraph) {
+        //the graph is the same every frame, so are these; compile includes building it
+        const FrameGraphStats& stats = frameGraph.stats();
+        report.add("framegraph", "passes", stats.passes);
+        report.add("framegraph", "culledPasses", stats.culledPasses);
+        report.add("framegraph", "invalidations", stats.invalidations);
+        report.add("framegraph", "peakBytes", (double)stats.peakBytes);
+        report.add("framegraph", "aliasedBytes", (double)stats.aliasedBytes);
+        report.add("framegraph", "unaliasedBytes", (double)stats.unaliasedBytes);
+        report.add("framegraph", "pooledBytes", (double)stats.pooledBytes);
+        report.add("framegraph", "compileMilliseconds", frameGraphCompileMilliseconds / frames);
+        report.add("framegraph", "executeMilliseconds", frameGraphExecuteMilliseconds / frames);
+    }
+    if (script.atlasImages > 0) {
+        //the fill is every image inserted one by one before the first frame, pack alone and with the uploads
+        const TextureAtlasStats& stats = atlas.stats();
+        float occupancy = 0.0f;
+        for (float pageOccupancy : stats.occupancy)
+            occupancy += pageOccupancy / stats.pages;
+        report.add("atlas", "images", stats.images);
+        report.add("atlas", "failedInserts", atlasFailed);
+        report.add("atlas", "fillPackMilliseconds", atlasFillPackMilliseconds);
+        report.add("atlas", "fillMilliseconds", atlasFillMilliseconds);
+        report.add("atlas", "imagesPerMillisecond", script.atlasImages / std::max(atlasFillPackMilliseconds, 1e-3));
+        report.add("atlas", "fillOccupancy", atlasFillOccupancy);
+        report.add("atlas", "replacedPerFrame", atlasReplaced / frames);
+        report.add("atlas", "churnMilliseconds", atlasChurnMilliseconds / frames);
+        report.add("atlas", "repacks", stats.repacks);
+        report.add("atlas", "staleRepacks", stats.staleRepacks);
+        report.add("atlas", "repackWaitMilliseconds", atlasWaitMilliseconds / frames);
+        report.add("atlas", "pages", stats.pages);
+        report.add("atlas", "occupancy", occupancy);
+        report.add("atlas", "fragmentation", stats.fragmentation);
+    }
+    if (script.draw) {
+        report.add("submit", "path", submitPathName(script.submit));
+        report.add("submit", "uniforms", uniformPathName(script.uniforms));
+        report.add("submit", "drawsPerFrame", totals.drawCalls / frames);
+        report.add("submit", "milliseconds", submitMilliseconds / frames);
+        report.add("submit", "uniformBytesPerFrame", totals.uploadBytes / frames);
+        if (!direct && !commandLists && script.occlusion != OcclusionPath::Queries)
+            report.add("submit", "uniformBindsPerFrame", uniformBinds / frames);
+        if (commandLists) {
+            //milliseconds above is the replay, the GL thread's part; recording runs on the jobs
+            report.add("submit", "lists", commandLists->listCount());
+            report.add("submit", "commandsPerFrame", commands / frames);
+            report.add("submit", "recordMilliseconds", recordMilliseconds / frames);
+        }
+    }
+
+    const FrameMetricSummary present = frameStats.summary(FrameMetric::Present);
+    std::cout << "frame p50 " << present.p50 << " p99 " << present.p99 << " max " << present.max << " ms, "
+        << totals.drawCalls / script.frames << " draws and " << totals.triangles / script.frames << " triangles a frame, shaders "
+        << scene.shaderCompileMilliseconds() << " ms, startup " << startupMilliseconds << " ms, stream " << std::hex << hash.value << std::dec << std::endl;
+    report.print(std::cout);
+    if (writeResult(outPath, script, scene, frameStats, totals, peak, jobs.threadCount(), hash.value, startupMilliseconds, report))
+        std::cout << "Result written to " << outPath << std::endl;
+
+    std::ostringstream hashText;
+    hashText << std::hex << hash.value;
+    metrics.scene = script.name;
+    metrics.frames = script.frames;
+    metrics.commandStreamHash = hashText.str();
+    metrics.drawCalls = totals.drawCalls;
+    metrics.uploadBytes = totals.uploadBytes;
+    metrics.p50 = present.p50;
+    metrics.p99 = present.p99;
+    metrics.startupMilliseconds = startupMilliseconds;
+
+    Profiler::get().shutdown();
+    return true;
+}
+
+//--thread-sweep: a scene at one thread count, the median of its runs
+struct ThreadSweepRow {
+    unsigned int threads = 0;   //the calling thread included, so workers + 1
+    SceneMetrics metrics;
+    double cullMilliseconds = 0.0;
+    double movingMilliseconds = 0.0;
+};
+
+static double medianOf(std::vector<double> values) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
+
+//speedup is against the first thread count, prints the table too
+static bool writeThreadSweep(const std::string& path, const std::vector<ThreadSweepRow>& rows) {
+    if (rows.empty())
+        return true;
+    const ThreadSweepRow& first = rows.front();
+    std::cout << first.metrics.scene << " thread sweep, median of the runs:\n threads   frame p50   culling    moving   speedup\n";
+    std::ofstream out(path);
+    if (out)
+        out << "{\n  \"scene\": \"" << first.metrics.scene << "\",\n  \"hardwareThreads\": " << std::thread::hardware_concurrency()
+            << ",\n  \"frames\": " << first.metrics.frames << ",\n  \"sweep\": [";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const ThreadSweepRow& row = rows[i];
+        const double speedup = row.metrics.p50 > 0.0 ? first.metrics.p50 / row.metrics.p50 : 0.0;
+        if (row.metrics.commandStreamHash != first.metrics.commandStreamHash)
+            std::cout << "  " << row.threads << " threads submitted different commands, the timings don't compare" << std::endl;
+        std::cout << std::setw(8) << row.threads << std::setw(12) << row.metrics.p50 << std::setw(10) << row.cullMilliseconds
+            << std::setw(10) << row.movingMilliseconds << std::setw(10) << speedup << "\n";
+        if (out)
+            out << (i ? "," : "") << "\n    {\"threads\": " << row.threads << ", \"p50\": " << row.metrics.p50 << ", \"p99\": " << row.metrics.p99
+                << ", \"cullingMilliseconds\": " << row.cullMilliseconds << ", \"movingMilliseconds\": " << row.movingMilliseconds
+                << ", \"speedup\": " << speedup << ", \"commandStreamHash\": \"" << row.metrics.commandStreamHash << "\"}";
+    }
+    if (!out) {
+        std::cout << "Can't write the thread sweep to " << path << std::endl;
+        return false;
+    }
+    out << "\n  ]\n}\n";
+    std::cout << "Thread sweep written to " << path << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> scriptPaths;
+    std::string outPath;
+    std::string baselinePath;
+    std::string writeBaselinePath;
+    GoldenCheck golden;
+    int frames = -1;
+    int threads = -1;
+    int runs = -1;
+    std::vector<unsigned int> threadSweep;
+    for (int arg = 1; arg < argc; arg++) {
+        if (!strcmp(argv[arg], "--out") && arg + 1 < argc)
+            outPath = argv[++arg];
+        else if (!strcmp(argv[arg], "--frames") && arg + 1 < argc)
+            frames = atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "--threads") && arg + 1 < argc)
+            threads = atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "--thread-sweep") && arg + 1 < argc) {
+            std::stringstream list(argv[++arg]);
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                if (atoi(count.c_str()) <= 0) {
+                    std::cout << "--thread-sweep takes a list of thread counts, like 1,2,4,8,16" << std::endl;
+                    return -1;
+                }
+                threadSweep.push_back((unsigned int)atoi(count.c_str()));
+            }
+        }
+        else if (!strcmp(argv[arg], "--runs") && arg + 1 < argc)
+            runs = atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "--baseline") && arg + 1 < argc)
+            baselinePath = argv[++arg];
+        else if (!strcmp(argv[arg], "--write-baseline") && arg + 1 < argc)
+            writeBaselinePath = argv[++arg];
+        else if ((!strcmp(argv[arg], "--golden") || !strcmp(argv[arg], "--write-golden")) && arg + 1 < argc) {
+            golden.write = !strcmp(argv[arg], "--write-golden");
+            golden.directory = argv[++arg];
+        }
+        else if (!strcmp(argv[arg], "--pixel-tolerance") && arg + 1 < argc)
+            golden.tolerance.channel = atoi(argv[++arg]);
+        else if (argv[arg][0] != '-')
+            scriptPaths.push_back(argv[arg]);
+        else {
+            std::cout << "Unknown argument " << argv[arg] << std::endl;
+            return -1;
+        }
+    }
+    if (scriptPaths.empty()) {
+        std::cout << "Usage: project_benchmark <scene script>... [--out result.json] [--frames N] [--threads N] [--runs N]\n"
+            "                         [--baseline baseline.json] [--write-baseline baseline.json]\n"
+            "                         [--golden dir] [--write-golden dir] [--pixel-tolerance N]\n"
+            "                         [--thread-sweep 1,2,4,8,16]" << std::endl;
+        return -1;
+    }
+    if (!threadSweep.empty() && (threads >= 0 || !outPath.empty() || !baselinePath.empty() || !writeBaselinePath.empty() || !golden.directory.empty())) {
+        std::cout << "--thread-sweep sets the threads and writes its own results, it takes no --threads, --out, baselines or golden images" << std::endl;
+        return -1;
+    }
+    if (!outPath.empty() && scriptPaths.size() > 1) {
+        std::cout << "--out takes a single scene" << std::endl;
+        return -1;
+    }
+    if (runs <= 0)
+        runs = baselinePath.empty() && writeBaselinePath.empty() && threadSweep.empty() ? 1 : 5;
+
+    std::vector<BenchmarkScript> scripts(scriptPaths.size());
+    for (size_t index = 0; index < scripts.size(); index++) {
+        if (!loadBenchmarkScript(scriptPaths[index], scripts[index]))
+            return -1;
+        if (frames > 0)
+            scripts[index].frames = frames;
+    }
+    //loaded first, a broken baseline shouldn't cost a whole benchmark run to find out
+    std::vector<SceneMetrics> baseline;
+    BaselineTolerances tolerances;
+    if (!baselinePath.empty() && !loadBaseline(baselinePath, baseline, tolerances))
+        return -1;
+
+    //INIT GLFW, the window only provides the context and is never shown
+    if (!glfwInit())
+        return -1;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (glewInit() != GLEW_OK) {
+        std::cout << "glewInit() Error" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    std::vector<SceneMetrics> medians;
+    bool ok = true;
+    for (const BenchmarkScript& script : scripts) {
+        if (!threadSweep.empty()) {
+            std::vector<ThreadSweepRow> rows;
+            for (unsigned int count : threadSweep) {
+                std::vector<SceneMetrics> sceneRuns(runs);
+                std::vector<double> culling, moving;
+                for (int run = 0; run < runs && ok; run++) {
+                    BenchmarkReport report;
+                    ok = runBenchmark(script, count - 1, script.name + ".benchmark.json", sceneRuns[run], report, nullptr);
+                    culling.push_back(report.number("culling", "milliseconds"));
+                    moving.push_back(report.number("moving", "milliseconds"));
+                }
+                ThreadSweepRow row;
+                ok = ok && medianOfRuns(sceneRuns, row.metrics);
+                if (!ok)
+                    break;
+                row.threads = count;
+                row.cullMilliseconds = medianOf(culling);
+                row.movingMilliseconds = medianOf(moving);
+                rows.push_back(row);
+            }
+            if (!ok || !writeThreadSweep(script.name + ".threads.json", rows))
+                break;
+            continue;
+        }
+
+        std::vector<SceneMetrics> sceneRuns(runs);
+        for (int run = 0; run < runs; run++) {
+            GoldenCheck* check = run == 0 && !golden.directory.empty() ? &golden : nullptr;
+            BenchmarkReport report;
+            ok = ok && runBenchmark(script, threads, outPath.empty() ? script.name + ".benchmark.json" : outPath, sceneRuns[run], report, check);
+        }
+        if (!ok)
+            break;
+        medians.emplace_back();
+        ok = medianOfRuns(sceneRuns, medians.back());
+    }
+    glfwTerminate();
+    if (!ok)
+        return -1;
+
+    if (!writeBaselinePath.empty() && writeBaseline(writeBaselinePath, medians, tolerances))
+        std::cout << "Baseline of " << medians.size() << " scenes, median of " << runs << " runs, written to " << writeBaselinePath << std::endl;
+    bool passed = true;
+    if (!baselinePath.empty())
+        passed = compareToBaseline(baseline, medians, tolerances, std::cout);
+    if (!golden.directory.empty() && !golden.write) {
+        std::cout << golden.checked - golden.failed << " of " << golden.checked << " golden images match" << std::endl;
+        passed = passed && golden.failed == 0;
+    }
+    return passed ? 0 : 1;
+}
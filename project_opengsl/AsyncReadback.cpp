@@ -0,0 +1,99 @@
+#include "AsyncReadback.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+AsyncReadback::~AsyncReadback() {
+    for (Slot& slot : m_slots) {
+        if (slot.fence)
+            glDeleteSync((GLsync)slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool AsyncReadback::init(unsigned int slots) {
+    if (slots == 0) {
+        std::cout << "AsyncReadback needs at least 1 slot" << std::endl;
+        return false;
+    }
+    m_slots.resize(slots);
+    for (Slot& slot : m_slots)
+        glGenBuffers(1, &slot.buffer);
+    return true;
+}
+
+bool AsyncReadback::request(int x, int y, int width, int height, uint64_t tag) {
+    m_stats.requested++;
+    if (m_inFlight == m_slots.size()) {
+        m_stats.dropped++;
+        return false;
+    }
+
+    Slot& slot = m_slots[m_write];
+    const size_t size = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    //with a pack buffer bound the pointer is an offset into it, the call returns straight away
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.tag = tag;
+    slot.width = width;
+    slot.height = height;
+    m_write = (m_write + 1) % m_slots.size();
+    m_inFlight++;
+    return true;
+}
+
+void AsyncReadback::take(Slot& slot, ReadbackImage& image) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const size_t size = (size_t)slot.width * slot.height * 4;
+    image.tag = slot.tag;
+    image.width = slot.width;
+    image.height = slot.height;
+    image.pixels.resize(size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (mapped) {
+        memcpy(image.pixels.data(), mapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        std::cout << "Can't map readback " << slot.tag << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync((GLsync)slot.fence);
+    slot.fence = nullptr;
+    m_read = (m_read + 1) % m_slots.size();
+    m_inFlight--;
+    m_stats.completed++;
+    m_stats.copyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool AsyncReadback::poll(ReadbackImage& image) {
+    if (m_inFlight == 0)
+        return false;
+    Slot& slot = m_slots[m_read];
+    //the flush makes sure the fence gets to the GPU at all, the zero timeout that we don't wait for it
+    if (glClientWaitSync((GLsync)slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        return false;
+    take(slot, image);
+    return true;
+}
+
+bool AsyncReadback::wait(ReadbackImage& image) {
+    if (m_inFlight == 0)
+        return false;
+    Slot& slot = m_slots[m_read];
+    while (glClientWaitSync((GLsync)slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+        ;
+    take(slot, image);
+    return true;
+}
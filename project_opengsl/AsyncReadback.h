@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//RGBA8 pixels of one readback, bottom row first like glReadPixels
+struct ReadbackImage {
+    uint64_t tag = 0;       //whatever request() was given, a frame number in practice
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+struct AsyncReadbackStats {
+    uint32_t requested = 0;
+    uint32_t completed = 0;
+    uint32_t dropped = 0;               //every slot was still in flight
+    double copyMilliseconds = 0.0;      //mapping and copying out, the last completed readback
+};
+
+/*
+Async Readback
+    glReadPixels into a ring of GL_PIXEL_PACK_BUFFERs with a fence behind each, so the read
+    is queued like any other command instead of waiting for the GPU to finish the frame.
+    poll() only maps a buffer once its fence has passed, usually a frame or two later, so
+    neither side ever stalls; with every slot still in flight a request is dropped rather
+    than waited for.
+
+        readback.request(0, 0, width, height, frame);  //after drawing, reads GL_READ_FRAMEBUFFER
+        ReadbackImage image;
+        while (readback.poll(image))
+            use(image);
+*/
+class AsyncReadback {
+public:
+    AsyncReadback() = default;
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+    ~AsyncReadback();
+
+    bool init(unsigned int slots = 3);
+
+    bool request(int x, int y, int width, int height, uint64_t tag);
+
+    //the oldest readback if the GPU is done with it. image's storage is reused when it's big enough
+    bool poll(ReadbackImage& image);
+    //the oldest readback, waiting for it. For draining at shutdown or the end of a test
+    bool wait(ReadbackImage& image);
+
+    unsigned int pending() const { return m_inFlight; }
+    const AsyncReadbackStats& stats() const { return m_stats; }
+
+private:
+    struct Slot {
+        unsigned int buffer = 0;
+        size_t capacity = 0;    //bytes
+        void* fence = nullptr;  //GLsync
+        uint64_t tag = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    void take(Slot& slot, ReadbackImage& image);
+
+    std::vector<Slot> m_slots;
+    unsigned int m_write = 0;
+    unsigned int m_read = 0;
+    unsigned int m_inFlight = 0;
+    AsyncReadbackStats m_stats;
+};
@@ -1,15 +1,16 @@
 #shader vertex
-#version 330 core
+#version 420 core
 
 layout(location = 0) in vec4 position;
+invariant gl_Position; //must match DepthOnly.shader bit for bit, the main pass tests GL_EQUAL after a pre-pass
 void main() {
-   gl_Position = position;
+   gl_Position = viewProjection * model * position;
 };
 
 #shader fragment
-#version 330 core
+#version 420 core
 
 layout(location = 0) out vec4 color;
 void main() {
-   color = vec4(0.0, 1.0, 0.0, 1.0);
+   color = tint;
 };
\ No newline at end of file
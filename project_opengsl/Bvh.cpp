@@ -0,0 +1,409 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+static const uint32_t MAX_LEAF_SIZE = 4;
+static const int BIN_COUNT = 16;
+static const float TRAVERSAL_COST = 1.0f;   //relative to testing one primitive
+static const uint32_t ALL_PLANES = (1u << Frustum::COUNT) - 1;
+
+static Aabb emptyAabb() {
+    const float inf = std::numeric_limits<float>::infinity();
+    return { { inf, inf, inf }, { -inf, -inf, -inf } };
+}
+
+static float component(const Vec3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+static Aabb childBounds(const BvhNode& node, int c) {
+    return { { node.minX[c], node.minY[c], node.minZ[c] }, { node.maxX[c], node.maxY[c], node.maxZ[c] } };
+}
+
+static void setChildBounds(BvhNode& node, int c, const Aabb& box) {
+    node.minX[c] = box.min.x; node.minY[c] = box.min.y; node.minZ[c] = box.min.z;
+    node.maxX[c] = box.max.x; node.maxY[c] = box.max.y; node.maxZ[c] = box.max.z;
+}
+
+//aabbUnion without the NaN handling of fmin/fmax, builds spend most of their time here
+static void grow(Aabb& box, const Aabb& other) {
+    box.min.x = other.min.x < box.min.x ? other.min.x : box.min.x;
+    box.min.y = other.min.y < box.min.y ? other.min.y : box.min.y;
+    box.min.z = other.min.z < box.min.z ? other.min.z : box.min.z;
+    box.max.x = other.max.x > box.max.x ? other.max.x : box.max.x;
+    box.max.y = other.max.y > box.max.y ? other.max.y : box.max.y;
+    box.max.z = other.max.z > box.max.z ? other.max.z : box.max.z;
+}
+
+static float surfaceArea(const Aabb& box) {
+    return box.max.x < box.min.x ? 0.0f : aabbSurfaceArea(box);
+}
+
+//0 = outside, 1 = intersecting, 2 = inside. Planes the box is fully inside of are removed from mask
+static int classify(const Frustum& frustum, float minX, float minY, float minZ, float maxX, float maxY, float maxZ, uint32_t& mask) {
+    for (int p = 0; p < Frustum::COUNT; p++) {
+        if (!(mask & (1u << p)))
+            continue;
+        const Plane& plane = frustum.planes[p];
+        float farX = plane.a >= 0.0f ? maxX : minX, nearX = plane.a >= 0.0f ? minX : maxX;
+        float farY = plane.b >= 0.0f ? maxY : minY, nearY = plane.b >= 0.0f ? minY : maxY;
+        float farZ = plane.c >= 0.0f ? maxZ : minZ, nearZ = plane.c >= 0.0f ? minZ : maxZ;
+        if (plane.a * farX + plane.b * farY + plane.c * farZ + plane.d < 0.0f)
+            return 0;
+        if (plane.a * nearX + plane.b * nearY + plane.c * nearZ + plane.d >= 0.0f)
+            mask &= ~(1u << p);
+    }
+    return mask == 0 ? 2 : 1;
+}
+
+void Bvh::build(const std::vector<Aabb>& primitives) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_primitives = primitives;
+    m_stats.subtreeRebuilds = 0;
+    buildAll();
+    m_stats.buildCost = m_stats.cost;
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.buildMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Bvh::buildAll() {
+    const uint32_t count = (uint32_t)m_primitives.size();
+    m_indices.resize(count);
+    m_centroids.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const Aabb& box = m_primitives[i];
+        m_indices[i] = i;
+        m_centroids[i] = { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+    }
+
+    m_nodes.clear();
+    m_nodes.reserve(count / 2 + 1);
+    m_rootBounds = rangeBounds(0, count);
+    if (count > 0)
+        buildNode(m_nodes, 0, count);
+
+    m_buildArea.assign(m_nodes.size(), 0.0f);
+    m_slotEnd.assign(m_nodes.size(), 0);
+    recordBuildInfo(0, (uint32_t)m_nodes.size());
+    m_rootBuildArea = surfaceArea(m_rootBounds);
+    m_builtNodes = m_nodes.size();
+    m_stats.nodes = (uint32_t)m_nodes.size();
+    m_stats.cost = sahCost();
+}
+
+//appends the subtree of [first, first + count) to nodes depth first, returns its root's index
+uint32_t Bvh::buildNode(NodeArray& nodes, uint32_t first, uint32_t count) {
+    const uint32_t index = (uint32_t)nodes.size();
+    nodes.push_back(BvhNode());
+
+    Aabb bounds[2];
+    const uint32_t leftCount = partition(first, count, bounds);
+    const uint32_t firsts[2] = { first, first + leftCount };
+    const uint32_t counts[2] = { leftCount, count - leftCount };
+    uint32_t children[2];
+    for (int c = 0; c < 2; c++)
+        children[c] = counts[c] > MAX_LEAF_SIZE ? buildNode(nodes, firsts[c], counts[c]) : BVH_LEAF;
+
+    //recursion may have reallocated nodes
+    BvhNode& node = nodes[index];
+    node.first = first;
+    node.leftCount = leftCount;
+    for (int c = 0; c < 2; c++) {
+        node.child[c] = children[c];
+        setChildBounds(node, c, bounds[c]);
+    }
+    return index;
+}
+
+//binned SAH split of [first, first + count), returns how many primitives went left and both sides' bounds
+uint32_t Bvh::partition(uint32_t first, uint32_t count, Aabb bounds[2]) {
+    if (count <= MAX_LEAF_SIZE) {
+        bounds[0] = rangeBounds(first, count);
+        bounds[1] = emptyAabb();
+        return count;
+    }
+
+    Aabb centroidBounds = emptyAabb();
+    for (uint32_t i = first; i < first + count; i++) {
+        const Vec3& c = m_centroids[m_indices[i]];
+        grow(centroidBounds, { c, c });
+    }
+
+    //all three axes binned in one pass over the primitives
+    float low[3], scale[3];
+    Aabb binBounds[3][BIN_COUNT];
+    uint32_t binCount[3][BIN_COUNT] = {};
+    for (int axis = 0; axis < 3; axis++) {
+        low[axis] = component(centroidBounds.min, axis);
+        float extent = component(centroidBounds.max, axis) - low[axis];
+        scale[axis] = extent > 0.0f ? BIN_COUNT / extent : 0.0f;
+        for (int b = 0; b < BIN_COUNT; b++)
+            binBounds[axis][b] = emptyAabb();
+    }
+    for (uint32_t i = first; i < first + count; i++) {
+        const uint32_t id = m_indices[i];
+        for (int axis = 0; axis < 3; axis++) {
+            int b = std::min(BIN_COUNT - 1, (int)((component(m_centroids[id], axis) - low[axis]) * scale[axis]));
+            grow(binBounds[axis][b], m_primitives[id]);
+            binCount[axis][b]++;
+        }
+    }
+
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestAxis = -1;
+    int bestBin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (scale[axis] == 0.0f)
+            continue;
+
+        //right side of every split plane, swept from the end
+        float rightArea[BIN_COUNT];
+        uint32_t rightCount[BIN_COUNT];
+        Aabb right = emptyAabb();
+        uint32_t rightSum = 0;
+        for (int b = BIN_COUNT - 1; b > 0; b--) {
+            grow(right, binBounds[axis][b]);
+            rightSum += binCount[axis][b];
+            rightArea[b] = surfaceArea(right);
+            rightCount[b] = rightSum;
+        }
+
+        Aabb left = emptyAabb();
+        uint32_t leftSum = 0;
+        for (int b = 1; b < BIN_COUNT; b++) {
+            grow(left, binBounds[axis][b - 1]);
+            leftSum += binCount[axis][b - 1];
+            if (leftSum == 0 || rightCount[b] == 0)
+                continue;
+            float cost = leftSum * surfaceArea(left) + rightCount[b] * rightArea[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    //every centroid in the same spot, any half is as good as another
+    if (bestAxis < 0) {
+        bounds[0] = rangeBounds(first, count / 2);
+        bounds[1] = rangeBounds(first + count / 2, count - count / 2);
+        return count / 2;
+    }
+
+    bounds[0] = emptyAabb();
+    bounds[1] = emptyAabb();
+    for (int b = 0; b < BIN_COUNT; b++)
+        grow(bounds[b < bestBin ? 0 : 1], binBounds[bestAxis][b]);
+
+    uint32_t* begin = m_indices.data() + first;
+    uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t id) {
+        return std::min(BIN_COUNT - 1, (int)((component(m_centroids[id], bestAxis) - low[bestAxis]) * scale[bestAxis])) < bestBin;
+    });
+    return (uint32_t)(middle - begin);
+}
+
+bool Bvh::refit(const std::vector<Aabb>& primitives, float rebuildThreshold) {
+    if (primitives.size() != m_primitives.size()) {
+        std::cout << "Bvh::refit got " << primitives.size() << " primitives, the tree was built for " << m_primitives.size() << std::endl;
+        build(primitives);
+        return true;
+    }
+    if (m_nodes.empty())
+        return false;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    m_primitives = primitives;
+    m_rootBounds = refitNode(0, (uint32_t)m_primitives.size());
+    m_stats.cost = sahCost();
+
+    //subtrees whose primitives spread out get rebuilt in place, even when the whole tree still looks fine.
+    //Moving everything the same way grows every node alike, that's not worth a rebuild
+    const uint32_t subtreeRebuilds = m_stats.subtreeRebuilds;
+    float rootGrowth = m_rootBuildArea > 0.0f ? surfaceArea(m_rootBounds) / m_rootBuildArea : 1.0f;
+    rebuildDegraded(0, (uint32_t)m_primitives.size(), rebuildThreshold, rootGrowth);
+    bool rebuilt = m_stats.subtreeRebuilds != subtreeRebuilds;
+    if (rebuilt)
+        m_stats.cost = sahCost();
+    m_stats.nodes = (uint32_t)m_nodes.size();
+
+    //appended subtrees are out of depth-first order and leave dead slots behind
+    const bool fragmented = m_nodes.size() > 2 * m_builtNodes;
+    if (fragmented || m_stats.cost > m_stats.buildCost * rebuildThreshold) {
+        buildAll();
+        m_stats.buildCost = m_stats.cost;
+        m_stats.rebuilds++;
+        rebuilt = true;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.refitMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    return rebuilt;
+}
+
+Aabb Bvh::refitNode(uint32_t index, uint32_t count) {
+    BvhNode& node = m_nodes[index];
+    const uint32_t firsts[2] = { node.first, node.first + node.leftCount };
+    const uint32_t counts[2] = { node.leftCount, count - node.leftCount };
+    for (int c = 0; c < 2; c++) {
+        Aabb box = node.child[c] == BVH_LEAF ? rangeBounds(firsts[c], counts[c]) : refitNode(node.child[c], counts[c]);
+        setChildBounds(node, c, box);
+    }
+    return aabbUnion(childBounds(node, 0), childBounds(node, 1));
+}
+
+void Bvh::rebuildDegraded(uint32_t index, uint32_t count, float threshold, float rootGrowth) {
+    for (int c = 0; c < 2; c++) {
+        //a rebuild may have grown m_nodes, don't hold on to a reference
+        const BvhNode& node = m_nodes[index];
+        const uint32_t child = node.child[c];
+        if (child == BVH_LEAF)
+            continue;
+        const uint32_t first = c == 0 ? node.first : node.first + node.leftCount;
+        const uint32_t childCount = c == 0 ? node.leftCount : count - node.leftCount;
+
+        float buildArea = m_buildArea[child];
+        float growth = buildArea > 0.0f ? surfaceArea(childBounds(node, c)) / buildArea / rootGrowth : 1.0f;
+        if (growth > threshold) {
+            rebuildSubtree(index, c, first, childCount);
+            m_stats.subtreeRebuilds++;
+        }
+        else {
+            rebuildDegraded(child, childCount, threshold, rootGrowth);
+        }
+    }
+}
+
+void Bvh::rebuildSubtree(uint32_t parent, int c, uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; i++) {
+        const Aabb& box = m_primitives[m_indices[i]];
+        m_centroids[m_indices[i]] = { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+    }
+
+    m_scratch.clear();
+    buildNode(m_scratch, first, count);
+
+    //reuse the old subtree's slots when the new one fits, otherwise append it and leave
+    //the old slots unreferenced until the next full build
+    const uint32_t index = m_nodes[parent].child[c];
+    const uint32_t slots = m_slotEnd[index] - index;
+    uint32_t target = index;
+    if (m_scratch.size() > slots) {
+        target = (uint32_t)m_nodes.size();
+        m_nodes.resize(target + m_scratch.size());
+        m_buildArea.resize(m_nodes.size());
+        m_slotEnd.resize(m_nodes.size());
+        m_nodes[parent].child[c] = target;
+    }
+
+    for (size_t i = 0; i < m_scratch.size(); i++) {
+        BvhNode& node = m_nodes[target + i];
+        node = m_scratch[i];
+        for (int n = 0; n < 2; n++) {
+            if (node.child[n] != BVH_LEAF)
+                node.child[n] += target;
+        }
+    }
+    m_buildArea[target] = surfaceArea(childBounds(m_nodes[parent], c));
+    recordBuildInfo(target, target + (uint32_t)m_scratch.size());
+    if (target == index)
+        m_slotEnd[index] = index + slots;
+}
+
+//build areas of every internal child and how far each subtree extends, for nodes in [begin, end)
+void Bvh::recordBuildInfo(uint32_t begin, uint32_t end) {
+    for (uint32_t i = end; i-- > begin;) {
+        const BvhNode& node = m_nodes[i];
+        uint32_t slotEnd = i + 1;
+        for (int c = 0; c < 2; c++) {
+            if (node.child[c] == BVH_LEAF)
+                continue;
+            m_buildArea[node.child[c]] = surfaceArea(childBounds(node, c));
+            slotEnd = std::max(slotEnd, m_slotEnd[node.child[c]]);
+        }
+        m_slotEnd[i] = slotEnd;
+    }
+}
+
+Aabb Bvh::rangeBounds(uint32_t first, uint32_t count) const {
+    Aabb box = emptyAabb();
+    for (uint32_t i = first; i < first + count; i++)
+        grow(box, m_primitives[m_indices[i]]);
+    return box;
+}
+
+//expected cost of a random ray/query: nodes and leaves weighted by area relative to the root
+float Bvh::sahCost() const {
+    const float rootArea = surfaceArea(m_rootBounds);
+    if (m_nodes.empty() || rootArea <= 0.0f)
+        return 0.0f;
+
+    float total = 0.0f;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.push_back(std::make_pair(0u, (uint32_t)m_primitives.size()));
+    while (!stack.empty()) {
+        const BvhNode& node = m_nodes[stack.back().first];
+        const uint32_t count = stack.back().second;
+        stack.pop_back();
+
+        const uint32_t counts[2] = { node.leftCount, count - node.leftCount };
+        total += TRAVERSAL_COST * surfaceArea(aabbUnion(childBounds(node, 0), childBounds(node, 1))) / rootArea;
+        for (int c = 0; c < 2; c++) {
+            if (counts[c] == 0)
+                continue;
+            if (node.child[c] == BVH_LEAF)
+                total += counts[c] * surfaceArea(childBounds(node, c)) / rootArea;
+            else
+                stack.push_back(std::make_pair(node.child[c], counts[c]));
+        }
+    }
+    return total;
+}
+
+void Bvh::query(const Frustum& frustum, std::vector<uint32_t>& visible) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_stats.nodesVisited = 0;
+
+    m_stack.clear();
+    if (!m_nodes.empty())
+        m_stack.push_back({ 0, (uint32_t)m_primitives.size(), ALL_PLANES });
+
+    while (!m_stack.empty()) {
+        QueryEntry entry = m_stack.back();
+        m_stack.pop_back();
+        const BvhNode& node = m_nodes[entry.node];
+        m_stats.nodesVisited++;
+
+        const uint32_t firsts[2] = { node.first, node.first + node.leftCount };
+        const uint32_t counts[2] = { node.leftCount, entry.count - node.leftCount };
+        for (int c = 0; c < 2; c++) {
+            if (counts[c] == 0)
+                continue;
+            uint32_t mask = entry.planeMask;
+            int result = classify(frustum, node.minX[c], node.minY[c], node.minZ[c], node.maxX[c], node.maxY[c], node.maxZ[c], mask);
+            if (result == 0)
+                continue;
+
+            if (result == 2) {
+                //the whole subtree is visible, no need to look inside
+                visible.insert(visible.end(), m_indices.begin() + firsts[c], m_indices.begin() + firsts[c] + counts[c]);
+            }
+            else if (node.child[c] == BVH_LEAF) {
+                for (uint32_t i = firsts[c]; i < firsts[c] + counts[c]; i++) {
+                    const Aabb& box = m_primitives[m_indices[i]];
+                    uint32_t primitiveMask = mask;
+                    if (classify(frustum, box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z, primitiveMask) != 0)
+                        visible.push_back(m_indices[i]);
+                }
+            }
+            else {
+                m_stack.push_back({ node.child[c], counts[c], mask });
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.queryMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
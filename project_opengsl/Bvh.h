@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "Geometry.h"
+
+//std::allocator only honours alignas() above 16 from C++17 on
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) {
+        void* raw = ::operator new(count * sizeof(T) + Alignment + sizeof(void*));
+        uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+        ((void**)aligned)[-1] = raw;
+        return (T*)aligned;
+    }
+    void deallocate(T* memory, size_t) {
+        ::operator delete(((void**)memory)[-1]);
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+/*
+BVH node
+    One cache line holds the bounds of BOTH children, so traversal tests the pair after a
+    single fetch. Nodes are stored depth first: the left child of node i (if it isn't a
+    leaf) is node i + 1. Primitives of a subtree are contiguous in Bvh::indices(), which
+    lets a query accept a fully visible subtree as one range.
+*/
+struct alignas(64) BvhNode {
+    float minX[2], minY[2], minZ[2];
+    float maxX[2], maxY[2], maxZ[2];
+    uint32_t child[2];      //node index, or BVH_LEAF for a leaf
+    uint32_t first;         //first primitive of this node's subtree
+    uint32_t leftCount;     //primitives in the left child's subtree, the right one has the rest
+};
+static_assert(sizeof(BvhNode) == 64, "BvhNode should fill exactly one cache line");
+
+static const uint32_t BVH_LEAF = 0xFFFFFFFF;
+
+struct BvhStats {
+    uint32_t nodes = 0;
+    uint32_t nodesVisited = 0;      //by the last query
+    uint32_t subtreeRebuilds = 0;   //since build()
+    uint32_t rebuilds = 0;          //full rebuilds refit() fell back to
+    float buildCost = 0.0f;         //SAH cost right after the last build
+    float cost = 0.0f;              //SAH cost now, grows as refits loosen the tree
+    double buildMilliseconds = 0.0;
+    double refitMilliseconds = 0.0;
+    double queryMilliseconds = 0.0;
+};
+
+class Bvh {
+public:
+    void build(const std::vector<Aabb>& primitives);
+
+    //moved primitives, same count and order as build(). Subtrees that grew more than rebuildThreshold
+    //times since they were built (relative to the root) are rebuilt in place, and the whole tree when
+    //its SAH cost passed rebuildThreshold * the cost after build(). Returns true if anything was rebuilt
+    bool refit(const std::vector<Aabb>& primitives, float rebuildThreshold = 1.5f);
+
+    //appends the indices of every primitive not completely outside the frustum, in no particular order
+    void query(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+    const std::vector<uint32_t>& indices() const { return m_indices; }
+    const BvhStats& stats() const { return m_stats; }
+
+private:
+    typedef std::vector<BvhNode, AlignedAllocator<BvhNode, 64>> NodeArray;
+
+    struct QueryEntry {
+        uint32_t node;
+        uint32_t count;
+        uint32_t planeMask;     //planes the parent wasn't already fully inside of
+    };
+
+    void buildAll();
+    uint32_t buildNode(NodeArray& nodes, uint32_t first, uint32_t count);
+    uint32_t partition(uint32_t first, uint32_t count, Aabb bounds[2]);
+    void rebuildDegraded(uint32_t node, uint32_t count, float threshold, float rootGrowth);
+    void rebuildSubtree(uint32_t parent, int child, uint32_t first, uint32_t count);
+    void recordBuildInfo(uint32_t begin, uint32_t end);
+    Aabb refitNode(uint32_t node, uint32_t count);
+    Aabb rangeBounds(uint32_t first, uint32_t count) const;
+    float sahCost() const;
+
+    NodeArray m_nodes;
+    NodeArray m_scratch;                //subtree rebuilds land here before being copied into m_nodes
+    std::vector<uint32_t> m_indices;    //primitive ids in subtree order
+    std::vector<Aabb> m_primitives;
+    std::vector<Vec3> m_centroids;
+    std::vector<float> m_buildArea;     //per node, surface area when it was last built
+    std::vector<uint32_t> m_slotEnd;    //per node, one past the last slot its subtree may be rebuilt into
+    size_t m_builtNodes = 0;
+    std::vector<QueryEntry> m_stack;
+    Aabb m_rootBounds;
+    float m_rootBuildArea = 0.0f;
+    BvhStats m_stats;
+};
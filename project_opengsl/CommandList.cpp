@@ -0,0 +1,220 @@
+#include "CommandList.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <cstring>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+struct CommandHeader {
+    CommandOp op;
+    uint16_t size; //header + arguments, in bytes
+};
+
+struct BindTextureArgs { unsigned int unit; unsigned int texture; };
+struct Uniform1iArgs { int location; int value; };
+struct Uniform1fArgs { int location; float value; };
+struct Uniform4fArgs { int location; float value[4]; };
+struct UniformMatrix4fArgs { int location; float value[16]; };
+struct BindUniformRangeArgs { unsigned int binding; unsigned int buffer; uint32_t offset; uint32_t size; }; //4 byte aligned, so no size_t
+struct DrawElementsArgs { unsigned int indexCount; unsigned int firstIndex; };
+
+void* CommandArena::allocate(size_t size) {
+    size = (size + 3) & ~(size_t)3;
+
+    if (m_chunks.empty())
+        m_chunks.emplace_back();
+
+    Chunk* chunk = &m_chunks[m_current];
+    if (chunk->data.empty())
+        chunk->data.resize(CHUNK_SIZE);
+
+    if (chunk->used + size > CHUNK_SIZE) {
+        m_current++;
+        if (m_current == m_chunks.size())
+            m_chunks.emplace_back();
+        chunk = &m_chunks[m_current];
+        if (chunk->data.empty())
+            chunk->data.resize(CHUNK_SIZE);
+    }
+
+    void* memory = chunk->data.data() + chunk->used;
+    chunk->used += size;
+    return memory;
+}
+
+void CommandArena::reset() {
+    for (Chunk& chunk : m_chunks)
+        chunk.used = 0;
+    m_current = 0;
+}
+
+void* CommandList::push(CommandOp op, size_t argumentSize) {
+    size_t size = sizeof(CommandHeader) + argumentSize;
+    CommandHeader* header = (CommandHeader*)m_arena.allocate(size);
+    header->op = op;
+    header->size = (uint16_t)((size + 3) & ~(size_t)3);
+    m_commandCount++;
+    return header + 1;
+}
+
+void CommandList::bindProgram(unsigned int program) {
+    *(unsigned int*)push(CommandOp::BindProgram, sizeof(unsigned int)) = program;
+}
+
+void CommandList::bindTexture(unsigned int unit, unsigned int texture) {
+    BindTextureArgs* args = (BindTextureArgs*)push(CommandOp::BindTexture, sizeof(BindTextureArgs));
+    args->unit = unit;
+    args->texture = texture;
+}
+
+void CommandList::bindVertexArray(unsigned int vertexArray) {
+    *(unsigned int*)push(CommandOp::BindVertexArray, sizeof(unsigned int)) = vertexArray;
+}
+
+void CommandList::setUniform1i(int location, int value) {
+    Uniform1iArgs* args = (Uniform1iArgs*)push(CommandOp::Uniform1i, sizeof(Uniform1iArgs));
+    args->location = location;
+    args->value = value;
+}
+
+void CommandList::setUniform1f(int location, float value) {
+    Uniform1fArgs* args = (Uniform1fArgs*)push(CommandOp::Uniform1f, sizeof(Uniform1fArgs));
+    args->location = location;
+    args->value = value;
+}
+
+void CommandList::setUniform4f(int location, float x, float y, float z, float w) {
+    Uniform4fArgs* args = (Uniform4fArgs*)push(CommandOp::Uniform4f, sizeof(Uniform4fArgs));
+    args->location = location;
+    args->value[0] = x;
+    args->value[1] = y;
+    args->value[2] = z;
+    args->value[3] = w;
+}
+
+void CommandList::setUniformMatrix4f(int location, const float* matrix) {
+    UniformMatrix4fArgs* args = (UniformMatrix4fArgs*)push(CommandOp::UniformMatrix4f, sizeof(UniformMatrix4fArgs));
+    args->location = location;
+    memcpy(args->value, matrix, sizeof(args->value));
+}
+
+void CommandList::bindUniformRange(unsigned int binding, unsigned int buffer, size_t offset, size_t size) {
+    BindUniformRangeArgs* args = (BindUniformRangeArgs*)push(CommandOp::BindUniformRange, sizeof(BindUniformRangeArgs));
+    args->binding = binding;
+    args->buffer = buffer;
+    args->offset = (uint32_t)offset;
+    args->size = (uint32_t)size;
+}
+
+void CommandList::drawElements(unsigned int indexCount, unsigned int firstIndex) {
+    DrawElementsArgs* args = (DrawElementsArgs*)push(CommandOp::DrawElements, sizeof(DrawElementsArgs));
+    args->indexCount = indexCount;
+    args->firstIndex = firstIndex;
+}
+
+void CommandList::replay() const {
+    const std::vector<CommandArena::Chunk>& chunks = m_arena.chunks();
+    const size_t activeChunks = m_arena.activeChunks();
+
+    for (size_t c = 0; c < activeChunks; c++) {
+        const uint8_t* cursor = chunks[c].data.data();
+        const uint8_t* end = cursor + chunks[c].used;
+
+        while (cursor < end) {
+            const CommandHeader* header = (const CommandHeader*)cursor;
+            const void* args = header + 1;
+
+            switch (header->op) {
+            case CommandOp::BindProgram:
+                glUseProgram(*(const unsigned int*)args);
+                break;
+            case CommandOp::BindTexture: {
+                const BindTextureArgs* a = (const BindTextureArgs*)args;
+                glActiveTexture(GL_TEXTURE0 + a->unit);
+                glBindTexture(GL_TEXTURE_2D, a->texture);
+                break;
+            }
+            case CommandOp::BindVertexArray:
+                glBindVertexArray(*(const unsigned int*)args);
+                break;
+            case CommandOp::Uniform1i: {
+                const Uniform1iArgs* a = (const Uniform1iArgs*)args;
+                glUniform1i(a->location, a->value);
+                break;
+            }
+            case CommandOp::Uniform1f: {
+                const Uniform1fArgs* a = (const Uniform1fArgs*)args;
+                glUniform1f(a->location, a->value);
+                break;
+            }
+            case CommandOp::Uniform4f: {
+                const Uniform4fArgs* a = (const Uniform4fArgs*)args;
+                glUniform4fv(a->location, 1, a->value);
+                break;
+            }
+            case CommandOp::UniformMatrix4f: {
+                const UniformMatrix4fArgs* a = (const UniformMatrix4fArgs*)args;
+                glUniformMatrix4fv(a->location, 1, GL_FALSE, a->value);
+                break;
+            }
+            case CommandOp::BindUniformRange: {
+                const BindUniformRangeArgs* a = (const BindUniformRangeArgs*)args;
+                glBindBufferRange(GL_UNIFORM_BUFFER, a->binding, a->buffer, a->offset, a->size);
+                break;
+            }
+            case CommandOp::DrawElements: {
+                const DrawElementsArgs* a = (const DrawElementsArgs*)args;
+                glDrawElements(GL_TRIANGLES, a->indexCount, GL_UNSIGNED_INT, (const void*)(a->firstIndex * sizeof(unsigned int)));
+                break;
+            }
+            }
+
+            cursor += header->size;
+        }
+    }
+}
+
+void CommandList::reset() {
+    m_arena.reset();
+    m_commandCount = 0;
+}
+
+CommandListSet::CommandListSet(unsigned int listCount, JobSystem* jobs)
+    : m_lists(listCount == 0 ? 1 : listCount), m_jobs(jobs) {
+}
+
+void CommandListSet::record(const std::function<void(unsigned int, CommandList&)>& record) {
+    PROFILE_SCOPE("Record command lists");
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto recordRange = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            record(i, m_lists[i]);
+    };
+    if (m_jobs)
+        m_jobs->parallelFor((uint32_t)m_lists.size(), 1, recordRange); //the calling thread records the first lists itself
+    else
+        recordRange(0, (uint32_t)m_lists.size());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.recordMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void CommandListSet::replay() {
+    PROFILE_SCOPE("Replay command lists");
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_stats.commands = 0;
+    for (const CommandList& list : m_lists) {
+        list.replay();
+        m_stats.commands += list.commandCount();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.replayMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void CommandListSet::reset() {
+    for (CommandList& list : m_lists)
+        list.reset();
+}
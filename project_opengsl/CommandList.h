@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class JobSystem;
+
+/*
+Command Lists
+    GL calls have to happen on the thread that owns the context, but deciding WHAT to
+    draw does not. Jobs record into their own CommandList (no locks, no GL), then the GL
+    thread replays every list in a fixed order.
+    A command is a 4 byte header (opcode + size) followed by its arguments, packed into
+    64 KB arena chunks that are kept between frames.
+*/
+
+enum class CommandOp : uint16_t {
+    BindProgram,
+    BindTexture,
+    BindVertexArray,
+    Uniform1i,
+    Uniform1f,
+    Uniform4f,
+    UniformMatrix4f,
+    BindUniformRange,
+    DrawElements
+};
+
+class CommandArena {
+public:
+    CommandArena() = default;
+    CommandArena(const CommandArena&) = delete;
+    CommandArena& operator=(const CommandArena&) = delete;
+    CommandArena(CommandArena&&) = default;
+    CommandArena& operator=(CommandArena&&) = default;
+
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    void* allocate(size_t size); //size must be <= CHUNK_SIZE, returns 4 byte aligned memory
+    void reset();                //keeps the chunks for the next frame
+
+    struct Chunk {
+        std::vector<uint8_t> data;
+        size_t used = 0;
+    };
+    const std::vector<Chunk>& chunks() const { return m_chunks; }
+    size_t activeChunks() const { return m_current + (m_chunks.empty() ? 0 : 1); }
+
+private:
+    std::vector<Chunk> m_chunks;
+    size_t m_current = 0;
+};
+
+class CommandList {
+public:
+    void bindProgram(unsigned int program);
+    void bindTexture(unsigned int unit, unsigned int texture);
+    void bindVertexArray(unsigned int vertexArray);
+    void setUniform1i(int location, int value);
+    void setUniform1f(int location, float value);
+    void setUniform4f(int location, float x, float y, float z, float w);
+    void setUniformMatrix4f(int location, const float* matrix); //16 floats, column major
+    void bindUniformRange(unsigned int binding, unsigned int buffer, size_t offset, size_t size); //glBindBufferRange, GL_UNIFORM_BUFFER
+    void drawElements(unsigned int indexCount, unsigned int firstIndex);
+
+    void replay() const; //GL thread only
+    void reset();
+
+    unsigned int commandCount() const { return m_commandCount; }
+
+private:
+    void* push(CommandOp op, size_t argumentSize);
+
+    CommandArena m_arena;
+    unsigned int m_commandCount = 0;
+};
+
+struct CommandListStats {
+    unsigned int commands = 0;
+    double recordMilliseconds = 0.0;
+    double replayMilliseconds = 0.0;
+};
+
+//One CommandList per recording job
+class CommandListSet {
+public:
+    explicit CommandListSet(unsigned int listCount, JobSystem* jobs = nullptr);
+
+    //calls record(listIndex, list) for every list, as jobs when there is a JobSystem, and waits for all of them
+    void record(const std::function<void(unsigned int, CommandList&)>& record);
+    void replay(); //lists are replayed in index order, so the result is deterministic
+    void reset();
+
+    unsigned int listCount() const { return (unsigned int)m_lists.size(); }
+    const CommandListStats& stats() const { return m_stats; }
+
+private:
+    std::vector<CommandList> m_lists;
+    JobSystem* m_jobs;
+    CommandListStats m_stats;
+};
@@ -0,0 +1,135 @@
+#include "DamageTracker.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+
+#ifdef GLFW_EXPOSE_NATIVE_EGL
+#include <GLFW/glfw3native.h>
+#include <EGL/eglext.h>
+#endif
+
+static DamageRect unite(const DamageRect& a, const DamageRect& b) {
+    DamageRect rect;
+    rect.x = std::min(a.x, b.x);
+    rect.y = std::min(a.y, b.y);
+    rect.width = std::max(a.x + a.width, b.x + b.width) - rect.x;
+    rect.height = std::max(a.y + a.height, b.y + b.height) - rect.y;
+    return rect;
+}
+
+//touching counts, two rects side by side are cheaper scissored as one
+static bool touches(const DamageRect& a, const DamageRect& b) {
+    return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+void DamageTracker::resize(int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_history.clear();
+    addAll();
+}
+
+void DamageTracker::add(const DamageRect& rect) {
+    DamageRect clipped;
+    clipped.x = std::max(rect.x, 0);
+    clipped.y = std::max(rect.y, 0);
+    clipped.width = std::min(rect.x + rect.width, m_width) - clipped.x;
+    clipped.height = std::min(rect.y + rect.height, m_height) - clipped.y;
+    if (clipped.width > 0 && clipped.height > 0)
+        m_current.push_back(clipped);
+}
+
+void DamageTracker::addNdc(float minX, float minY, float maxX, float maxY) {
+    DamageRect rect;
+    rect.x = (int)std::floor((minX * 0.5f + 0.5f) * m_width) - 1;
+    rect.y = (int)std::floor((minY * 0.5f + 0.5f) * m_height) - 1;
+    rect.width = (int)std::ceil((maxX * 0.5f + 0.5f) * m_width) + 1 - rect.x;
+    rect.height = (int)std::ceil((maxY * 0.5f + 0.5f) * m_height) + 1 - rect.y;
+    add(rect);
+}
+
+void DamageTracker::addAll() {
+    m_full = true;
+}
+
+void DamageTracker::merge(std::vector<DamageRect>& rects) const {
+    //until no two touch, a handful of rects so quadratic is fine
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rects.size(); j++) {
+                if (touches(rects[i], rects[j])) {
+                    rects[i] = unite(rects[i], rects[j]);
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    if (rects.size() > MAX_RECTS) {
+        DamageRect all = rects[0];
+        for (const DamageRect& rect : rects)
+            all = unite(all, rect);
+        rects.assign(1, all);
+    }
+}
+
+const std::vector<DamageRect>& DamageTracker::repaint(int bufferAge) {
+    DamageRect screen;
+    screen.width = m_width;
+    screen.height = m_height;
+
+    //the buffer misses this frame's damage and that of the bufferAge - 1 frames before it
+    const bool full = m_full || bufferAge <= 0 || bufferAge > MAX_AGE || bufferAge - 1 > (int)m_history.size();
+    if (full) {
+        m_repaint.assign(1, screen);
+    }
+    else {
+        m_repaint = m_current;
+        for (int age = 1; age < bufferAge; age++)
+            m_repaint.insert(m_repaint.end(), m_history[age - 1].begin(), m_history[age - 1].end());
+        merge(m_repaint);
+    }
+
+    if (m_full)
+        m_history.push_front(std::vector<DamageRect>(1, screen));
+    else
+        m_history.push_front(m_current);
+    if (m_history.size() > MAX_AGE - 1)
+        m_history.pop_back();
+    m_current.clear();
+    m_full = false;
+
+    m_stats.frames++;
+    if (full)
+        m_stats.fullFrames++;
+    m_stats.rects = (uint32_t)m_repaint.size();
+    double area = 0.0;
+    for (const DamageRect& rect : m_repaint)
+        area += (double)rect.width * rect.height;
+    m_stats.repaintedFraction = m_width > 0 && m_height > 0 ? (float)(area / ((double)m_width * m_height)) : 0.0f;
+    return m_repaint;
+}
+
+DamageRect DamageTracker::bounds() const {
+    if (m_repaint.empty())
+        return DamageRect();
+    DamageRect all = m_repaint[0];
+    for (const DamageRect& rect : m_repaint)
+        all = unite(all, rect);
+    return all;
+}
+
+int windowBufferAge(GLFWwindow* window) {
+#if defined(GLFW_EXPOSE_NATIVE_EGL) && defined(EGL_EXT_buffer_age)
+    //fails without the extension, leaving the age unknown
+    EGLint age = 0;
+    if (eglQuerySurface(glfwGetEGLDisplay(), glfwGetEGLSurface(window), EGL_BUFFER_AGE_EXT, &age))
+        return age;
+#else
+    (void)window;
+#endif
+    return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct GLFWwindow;
+
+//pixels, GL's window coordinates: origin at the bottom-left like glScissor
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct DamageStats {
+    uint32_t frames = 0;            //repaint() calls, since the start
+    uint32_t fullFrames = 0;        //of those, the ones that repainted everything
+    uint32_t rects = 0;             //the last repaint()
+    float repaintedFraction = 0.0f; //of the screen, the last repaint()
+};
+
+/*
+Damage Tracker
+    Collects what changed on screen this frame so the frame can redraw only that, scissored to
+    a few rectangles, or be skipped entirely when nothing did. A back buffer still holds what
+    was drawn into it bufferAge frames ago, so repaint() adds the damage of the frames in
+    between; an age of 0 (unknown, or a fresh buffer) repaints everything. Overlapping
+    rectangles are merged, and past MAX_RECTS they collapse into their bounds.
+
+    windowBufferAge() asks EGL_EXT_buffer_age where GLFW runs on EGL. Elsewhere, WGL included,
+    the age is unknown and the caller should draw into a framebuffer it keeps itself, which
+    always has an age of 1, and blit that to the back buffer.
+
+        damage.add(oldBounds);
+        damage.add(newBounds);
+        if (!damage.damaged())
+            skip the frame
+        damage.repaint(windowBufferAge(window));
+        glScissor(damage.bounds()...), clear and draw once
+
+    Scissoring to each repaint() rect instead touches fewer pixels, but costs a pass over the
+    draws per rect.
+*/
+class DamageTracker {
+public:
+    static const unsigned int MAX_RECTS = 4;
+    static const int MAX_AGE = 4;   //older back buffers repaint everything
+
+    void resize(int width, int height);     //damages everything, the old contents are gone
+
+    void add(const DamageRect& rect);       //clipped to the screen
+    //normalized device coordinates, padded by a pixel for rasterization rounding
+    void addNdc(float minX, float minY, float maxX, float maxY);
+    void addAll();
+    bool damaged() const { return m_full || !m_current.empty(); }
+
+    //what to redraw into a back buffer of that age; the frame's damage then moves into history
+    const std::vector<DamageRect>& repaint(int bufferAge);
+    DamageRect bounds() const;  //of the last repaint()
+
+    const DamageStats& stats() const { return m_stats; }
+
+private:
+    void merge(std::vector<DamageRect>& rects) const;
+
+    int m_width = 0;
+    int m_height = 0;
+    bool m_full = false;
+    std::vector<DamageRect> m_current;
+    std::deque<std::vector<DamageRect>> m_history;  //the previous frames' damage, newest first
+    std::vector<DamageRect> m_repaint;
+    DamageStats m_stats;
+};
+
+int windowBufferAge(GLFWwindow* window);
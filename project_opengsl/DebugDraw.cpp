@@ -0,0 +1,217 @@
+#include "DebugDraw.h"
+#include <algorithm>
+#include <chrono>
+
+static const unsigned int MAX_SHAPE_SEGMENTS = 256;
+
+//corner i has max.x if (i & 1), max.y if (i & 2), max.z if (i & 4)
+static const int BOX_EDGES[12][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+static std::atomic<uint64_t> s_nextId{ 1 };
+
+static Vec3 cross(const Vec3& l, const Vec3& r) {
+    return { l.y * r.z - l.z * r.y, l.z * r.x - l.x * r.z, l.x * r.y - l.y * r.x };
+}
+
+static float dot(const Vec3& l, const Vec3& r) {
+    return l.x * r.x + l.y * r.y + l.z * r.z;
+}
+
+static Vec3 normalize(const Vec3& v) {
+    float length = std::sqrt(dot(v, v));
+    return length > 0.0f ? Vec3{ v.x / length, v.y / length, v.z / length } : v;
+}
+
+//where three planes meet
+static Vec3 intersect(const Plane& p1, const Plane& p2, const Plane& p3) {
+    const Vec3 n1 = { p1.a, p1.b, p1.c };
+    const Vec3 n2 = { p2.a, p2.b, p2.c };
+    const Vec3 n3 = { p3.a, p3.b, p3.c };
+    const Vec3 c23 = cross(n2, n3);
+    const Vec3 c31 = cross(n3, n1);
+    const Vec3 c12 = cross(n1, n2);
+    const float denominator = dot(n1, c23);
+    if (std::fabs(denominator) < 1e-12f)
+        return { 0.0f, 0.0f, 0.0f };
+    const float s = -1.0f / denominator;
+    return {
+        s * (p1.d * c23.x + p2.d * c31.x + p3.d * c12.x),
+        s * (p1.d * c23.y + p2.d * c31.y + p3.d * c12.y),
+        s * (p1.d * c23.z + p2.d * c31.z + p3.d * c12.z)
+    };
+}
+
+DebugDraw::DebugDraw(uint32_t ringCapacity)
+    : m_id(s_nextId++), m_ringCapacity(ringCapacity) {
+}
+
+DebugDraw::ThreadRing& DebugDraw::threadRing() {
+    struct CachedRing {
+        uint64_t owner;
+        ThreadRing* ring;
+    };
+    thread_local CachedRing cached = { 0, nullptr };
+    if (cached.owner == m_id)
+        return *cached.ring;
+
+    //first call from this thread, or it last drew into another DebugDraw
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    const std::thread::id self = std::this_thread::get_id();
+    ThreadRing* ring = nullptr;
+    for (const std::unique_ptr<ThreadRing>& existing : m_rings) {
+        if (existing->owner == self)
+            ring = existing.get();
+    }
+    if (!ring) {
+        m_rings.emplace_back(new ThreadRing(m_ringCapacity));
+        ring = m_rings.back().get();
+        ring->owner = self;
+    }
+    cached = { m_id, ring };
+    return *ring;
+}
+
+void DebugDraw::push(const ImmediateVertex* vertices, uint32_t count, float lifetime, bool depthTest) {
+    ThreadRing& ring = threadRing();
+    bool pushed;
+    if (lifetime > 0.0f) {
+        PersistentLine lines[MAX_SHAPE_SEGMENTS];
+        for (uint32_t i = 0; i < count / 2; i++)
+            lines[i] = { vertices[2 * i], vertices[2 * i + 1], lifetime, depthTest };
+        pushed = ring.persistent.push(lines, count / 2);
+    }
+    else {
+        pushed = (depthTest ? ring.depthTested : ring.overlay).push(vertices, count);
+    }
+
+    //a shape is all or nothing
+    if (!pushed)
+        ring.dropped.fetch_add(count / 2, std::memory_order_relaxed);
+}
+
+void DebugDraw::line(const Vec3& a, const Vec3& b, uint32_t color, float lifetime, bool depthTest) {
+    const ImmediateVertex vertices[2] = { { a.x, a.y, a.z, color }, { b.x, b.y, b.z, color } };
+    push(vertices, 2, lifetime, depthTest);
+}
+
+void DebugDraw::box(const Aabb& box, uint32_t color, float lifetime, bool depthTest) {
+    ImmediateVertex corners[8];
+    for (int i = 0; i < 8; i++) {
+        corners[i] = {
+            (i & 1) ? box.max.x : box.min.x,
+            (i & 2) ? box.max.y : box.min.y,
+            (i & 4) ? box.max.z : box.min.z,
+            color
+        };
+    }
+    ImmediateVertex vertices[24];
+    for (int e = 0; e < 12; e++) {
+        vertices[2 * e] = corners[BOX_EDGES[e][0]];
+        vertices[2 * e + 1] = corners[BOX_EDGES[e][1]];
+    }
+    push(vertices, 24, lifetime, depthTest);
+}
+
+void DebugDraw::circle(const Vec3& center, const Vec3& normal, float radius, uint32_t color, float lifetime, bool depthTest, unsigned int segmentCount) {
+    segmentCount = std::min(std::max(segmentCount, 3u), MAX_SHAPE_SEGMENTS);
+
+    //u and v span the circle's plane, u is built from the axis least aligned with the normal
+    const Vec3 n = normalize(normal);
+    const float ax = std::fabs(n.x), ay = std::fabs(n.y), az = std::fabs(n.z);
+    const Vec3 axis = (ax <= ay && ax <= az) ? Vec3{ 1, 0, 0 } : (ay <= az ? Vec3{ 0, 1, 0 } : Vec3{ 0, 0, 1 });
+    const Vec3 u = normalize(cross(n, axis));
+    const Vec3 v = cross(n, u);
+
+    auto point = [&](unsigned int i) {
+        const float angle = 6.28318530718f * (float)i / (float)segmentCount;
+        const float c = std::cos(angle) * radius;
+        const float s = std::sin(angle) * radius;
+        return ImmediateVertex{ center.x + u.x * c + v.x * s, center.y + u.y * c + v.y * s, center.z + u.z * c + v.z * s, color };
+    };
+
+    ImmediateVertex vertices[MAX_SHAPE_SEGMENTS * 2];
+    vertices[0] = point(0);
+    for (unsigned int i = 1; i < segmentCount; i++) {
+        vertices[2 * i - 1] = point(i);
+        vertices[2 * i] = vertices[2 * i - 1];
+    }
+    vertices[2 * segmentCount - 1] = vertices[0];
+    push(vertices, 2 * segmentCount, lifetime, depthTest);
+}
+
+void DebugDraw::sphere(const Vec3& center, float radius, uint32_t color, float lifetime, bool depthTest) {
+    circle(center, { 1, 0, 0 }, radius, color, lifetime, depthTest);
+    circle(center, { 0, 1, 0 }, radius, color, lifetime, depthTest);
+    circle(center, { 0, 0, 1 }, radius, color, lifetime, depthTest);
+}
+
+void DebugDraw::frustum(const Frustum& frustum, uint32_t color, float lifetime, bool depthTest) {
+    //corner i is on the right plane if (i & 1), top if (i & 2), far if (i & 4), the same layout as box()
+    ImmediateVertex corners[8];
+    for (int i = 0; i < 8; i++) {
+        const Vec3 corner = intersect(
+            frustum.planes[(i & 1) ? Frustum::RIGHT : Frustum::LEFT],
+            frustum.planes[(i & 2) ? Frustum::TOP : Frustum::BOTTOM],
+            frustum.planes[(i & 4) ? Frustum::FAR_PLANE : Frustum::NEAR_PLANE]);
+        corners[i] = { corner.x, corner.y, corner.z, color };
+    }
+    ImmediateVertex vertices[24];
+    for (int e = 0; e < 12; e++) {
+        vertices[2 * e] = corners[BOX_EDGES[e][0]];
+        vertices[2 * e + 1] = corners[BOX_EDGES[e][1]];
+    }
+    push(vertices, 24, lifetime, depthTest);
+}
+
+void DebugDraw::flush(ImmediateMode& immediate, float deltaSeconds) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_stats = DebugDrawStats();
+    const bool depthTest = immediate.depthTest();
+
+    //one-frame lines are copied straight into the batches, the rest wait in m_persistent
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (const std::unique_ptr<ThreadRing>& ring : m_rings) {
+            auto toImmediate = [&](const ImmediateVertex* vertices, uint32_t count) {
+                immediate.lines(vertices, count);
+            };
+            immediate.setDepthTest(true);
+            m_stats.lines += ring->depthTested.consume(toImmediate) / 2;
+            immediate.setDepthTest(false);
+            m_stats.lines += ring->overlay.consume(toImmediate) / 2;
+            ring->persistent.consume([&](const PersistentLine* lines, uint32_t count) {
+                m_persistent.insert(m_persistent.end(), lines, lines + count);
+            });
+            m_stats.droppedLines += ring->dropped.exchange(0, std::memory_order_relaxed);
+        }
+        m_stats.threadBuffers = (uint32_t)m_rings.size();
+    }
+
+    m_persistentVertices[0].clear();
+    m_persistentVertices[1].clear();
+    size_t alive = 0;
+    for (PersistentLine& line : m_persistent) {
+        std::vector<ImmediateVertex>& vertices = m_persistentVertices[line.depthTest ? 0 : 1];
+        vertices.push_back(line.a);
+        vertices.push_back(line.b);
+        line.lifetime -= deltaSeconds;
+        if (line.lifetime > 0.0f)
+            m_persistent[alive++] = line;
+    }
+    m_stats.lines += (uint32_t)m_persistent.size();
+    m_stats.persistentLinesDrawn = (uint32_t)m_persistent.size();
+    m_persistent.resize(alive);
+    for (int overlay = 0; overlay < 2; overlay++) {
+        immediate.setDepthTest(overlay == 0);
+        immediate.lines(m_persistentVertices[overlay].data(), m_persistentVertices[overlay].size());
+    }
+    immediate.setDepthTest(depthTest);
+
+    m_stats.persistentLines = (uint32_t)m_persistent.size();
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.flushMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Geometry.h"
+#include "ImmediateMode.h"
+#include "SpscQueue.h"
+
+struct DebugDrawStats {
+    uint32_t lines = 0;             //drawn by the last flush(), persistent ones included
+    uint32_t persistentLines = 0;   //still alive after the last flush()
+    uint32_t persistentLinesDrawn = 0;  //by the last flush(), the ones it expired included
+    uint32_t droppedLines = 0;      //a thread's buffer was full, since the last flush()
+    uint32_t threadBuffers = 0;
+    double flushMilliseconds = 0.0;
+};
+
+/*
+Debug Draw
+    Lines, wire boxes, spheres, circles and frustums from any thread. Shapes are expanded into
+    segments by the calling thread and pushed into that thread's own single producer, single
+    consumer queues, so adding never takes a lock (only a thread's first call does, to register
+    them). flush() drains every queue on the render thread and hands the segments to
+    ImmediateMode as one line list per depth test state.
+
+    A lifetime of 0 draws the item once, anything longer keeps it for that many seconds of
+    flush(deltaSeconds), so time without flushes doesn't count: a caller that stops drawing
+    while persistentLinesDrawn isn't 0 leaves them on screen. depthTest = false draws it on
+    top of everything.
+*/
+class DebugDraw {
+public:
+    //each thread gets room for ringCapacity segments per depth test state (a power of 2) and an eighth of that
+    //for segments with a lifetime, shapes that don't fit are dropped
+    explicit DebugDraw(uint32_t ringCapacity = 64 * 1024);
+    DebugDraw(const DebugDraw&) = delete;
+    DebugDraw& operator=(const DebugDraw&) = delete;
+
+    void line(const Vec3& a, const Vec3& b, uint32_t color, float lifetime = 0.0f, bool depthTest = true);
+    void box(const Aabb& box, uint32_t color, float lifetime = 0.0f, bool depthTest = true);
+    void circle(const Vec3& center, const Vec3& normal, float radius, uint32_t color, float lifetime = 0.0f, bool depthTest = true, unsigned int segments = 32);
+    void sphere(const Vec3& center, float radius, uint32_t color, float lifetime = 0.0f, bool depthTest = true);
+    void frustum(const Frustum& frustum, uint32_t color, float lifetime = 0.0f, bool depthTest = true);
+
+    //render thread only. the segments are drawn at immediate's next flush()
+    void flush(ImmediateMode& immediate, float deltaSeconds);
+
+    const DebugDrawStats& stats() const { return m_stats; }
+
+private:
+    struct PersistentLine {
+        ImmediateVertex a, b;
+        float lifetime;
+        bool depthTest;
+    };
+
+    //one-frame lines are kept as ready-made line lists so flush() copies them to ImmediateMode wholesale
+    struct ThreadRing {
+        explicit ThreadRing(uint32_t capacity)
+            : depthTested(capacity * 2), overlay(capacity * 2), persistent(capacity / 8 + 1) {
+        }
+
+        SpscQueue<ImmediateVertex> depthTested;
+        SpscQueue<ImmediateVertex> overlay;
+        SpscQueue<PersistentLine> persistent;
+        std::atomic<uint32_t> dropped{ 0 };
+        std::thread::id owner;
+    };
+
+    ThreadRing& threadRing();
+    //vertices is a line list
+    void push(const ImmediateVertex* vertices, uint32_t count, float lifetime, bool depthTest);
+
+    const uint64_t m_id;        //tells this instance's rings apart in the thread_local cache
+    const uint32_t m_ringCapacity;
+    std::mutex m_ringsMutex;    //guards m_rings, producers only take it to register
+    std::vector<std::unique_ptr<ThreadRing>> m_rings;
+
+    std::vector<PersistentLine> m_persistent;
+    std::vector<ImmediateVertex> m_persistentVertices[2];
+    DebugDrawStats m_stats;
+};
@@ -0,0 +1,14 @@
+#shader vertex
+#version 420 core
+
+layout(location = 0) in vec4 position;
+invariant gl_Position; //same expression as Basic.shader, so GL_EQUAL holds in the main pass
+void main() {
+   gl_Position = viewProjection * model * position;
+};
+
+#shader fragment
+#version 420 core
+
+void main() {
+};
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(double stepSeconds, unsigned int maxCatchUpSteps)
+    : m_step(stepSeconds), m_maxCatchUpSteps(maxCatchUpSteps) {
+}
+
+unsigned int FixedTimestep::advance(double nowSeconds) {
+    //the first frame only starts the clock
+    if (m_lastTime < 0.0)
+        m_lastTime = nowSeconds;
+    m_accumulator += nowSeconds - m_lastTime;
+    m_lastTime = nowSeconds;
+
+    unsigned int steps = (unsigned int)(m_accumulator / m_step);
+    if (steps > m_maxCatchUpSteps) {
+        m_stats.droppedSteps += steps - m_maxCatchUpSteps;
+        m_accumulator -= (steps - m_maxCatchUpSteps) * m_step;
+        steps = m_maxCatchUpSteps;
+    }
+    m_accumulator -= steps * m_step;
+    m_simulationTime += steps * m_step;
+
+    m_stats.steps = steps;
+    m_stats.alpha = alpha();
+    return steps;
+}
+
+void FixedTimestep::beginUpdate() {
+    m_updateStart = std::chrono::high_resolution_clock::now();
+}
+
+void FixedTimestep::endUpdate() {
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(end - m_updateStart).count();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+
+struct FixedTimestepStats {
+    unsigned int steps = 0;             //update steps taken by the last advance()
+    unsigned int droppedSteps = 0;      //steps given up to the catch-up cap, since the start
+    double updateMilliseconds = 0.0;    //the last beginUpdate() to endUpdate()
+    float alpha = 0.0f;
+};
+
+/*
+Fixed Timestep
+    Simulation advances in steps of exactly step() seconds no matter how fast frames come. Real
+    time goes into an accumulator and every whole step in it is run, so a slow frame is made up
+    with extra steps and a fast one may run none. After a hitch the catch-up is capped, the time
+    beyond the cap is dropped and the simulation falls behind the clock rather than spiralling.
+
+    The leftover in the accumulator is what alpha() reports: render state interpolated between
+    the previous and the current simulation state by alpha is always one step behind, but moves
+    smoothly at any frame rate.
+
+        unsigned int steps = timestep.advance(glfwGetTime());
+        for (unsigned int i = 0; i < steps; i++) {
+            previous = current;
+            current = simulate(current, timestep.step());
+        }
+        draw(interpolate(previous, current, timestep.alpha()));
+*/
+class FixedTimestep {
+public:
+    explicit FixedTimestep(double stepSeconds = 1.0 / 60.0, unsigned int maxCatchUpSteps = 5);
+
+    //once per frame with the current time, returns how many steps to simulate
+    unsigned int advance(double nowSeconds);
+    //forgets the time since the last advance(), after a pause that shouldn't be caught up
+    void reset() { m_lastTime = -1.0; }
+
+    double step() const { return m_step; }
+    float alpha() const { return (float)(m_accumulator / m_step); }
+    double simulationTime() const { return m_simulationTime; }  //seconds simulated so far
+
+    void beginUpdate();
+    void endUpdate();
+
+    const FixedTimestepStats& stats() const { return m_stats; }
+
+private:
+    double m_step;
+    unsigned int m_maxCatchUpSteps;
+    double m_accumulator = 0.0;
+    double m_lastTime = -1.0;
+    double m_simulationTime = 0.0;
+    std::chrono::high_resolution_clock::time_point m_updateStart;
+    FixedTimestepStats m_stats;
+};
@@ -0,0 +1,412 @@
+#include "FrameCapture.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const char* captureFormatName(CaptureFormat format) {
+    switch (format) {
+    case CaptureFormat::Qoi:    return "qoi";
+    case CaptureFormat::Png:    return "png";
+    default:                    return "y4m";
+    }
+}
+
+static CaptureFormat formatOf(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    if (extension == "png")
+        return CaptureFormat::Png;
+    if (extension == "y4m")
+        return CaptureFormat::Y4m;
+    return CaptureFormat::Qoi;
+}
+
+//readbacks are bottom row first, every format here wants the top row first
+static const unsigned char* rowOf(const ReadbackImage& image, int y) {
+    return &image.pixels[(size_t)(image.height - 1 - y) * image.width * 4];
+}
+
+static void put32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+//https://qoiformat.org/qoi-specification.pdf, 3 channels: the back buffer's alpha means nothing
+static void encodeQoi(const ReadbackImage& image, std::vector<unsigned char>& out) {
+    out.clear();
+    out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+    put32(out, image.width);
+    put32(out, image.height);
+    out.push_back(3);   //RGB
+    out.push_back(0);   //sRGB with linear alpha
+
+    unsigned char seen[64][4] = {};
+    unsigned char previous[4] = { 0, 0, 0, 255 };
+    unsigned int run = 0;
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char* row = rowOf(image, y);
+        for (int x = 0; x < image.width; x++) {
+            const unsigned char pixel[4] = { row[x * 4], row[x * 4 + 1], row[x * 4 + 2], 255 };
+            if (memcmp(pixel, previous, 4) == 0) {
+                if (++run == 62) {
+                    out.push_back((unsigned char)(0xc0 | (run - 1)));   //QOI_OP_RUN
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.push_back((unsigned char)(0xc0 | (run - 1)));
+                run = 0;
+            }
+
+            const unsigned int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+            if (memcmp(seen[hash], pixel, 4) == 0) {
+                out.push_back((unsigned char)hash);     //QOI_OP_INDEX
+            }
+            else {
+                memcpy(seen[hash], pixel, 4);
+                const int dr = (signed char)(pixel[0] - previous[0]);
+                const int dg = (signed char)(pixel[1] - previous[1]);
+                const int db = (signed char)(pixel[2] - previous[2]);
+                const int drg = dr - dg, dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));   //QOI_OP_DIFF
+                }
+                else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out.push_back((unsigned char)(0x80 | (dg + 32)));                                  //QOI_OP_LUMA
+                    out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+                }
+                else {
+                    out.insert(out.end(), { 0xfe, pixel[0], pixel[1], pixel[2] });                   //QOI_OP_RGB
+                }
+            }
+            memcpy(previous, pixel, 4);
+        }
+    }
+    if (run > 0)
+        out.push_back((unsigned char)(0xc0 | (run - 1)));
+    out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+}
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool built = false;  //only ever the writer thread
+    if (!built) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        built = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void pngChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+    put32(out, (uint32_t)size);
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    put32(out, crc32(&out[start], size + 4));
+}
+
+//RGB, no filtering, deflate's stored blocks: a valid PNG any viewer opens, just not a small one
+static void encodePng(const ReadbackImage& image, std::vector<unsigned char>& out) {
+    std::vector<unsigned char> raw;
+    raw.reserve((size_t)(image.width * 3 + 1) * image.height);
+    for (int y = 0; y < image.height; y++) {
+        raw.push_back(0);   //filter: none
+        const unsigned char* row = rowOf(image, y);
+        for (int x = 0; x < image.width; x++)
+            raw.insert(raw.end(), { row[x * 4], row[x * 4 + 1], row[x * 4 + 2] });
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+        const size_t size = std::min<size_t>(65535, raw.size() - offset);
+        zlib.push_back(offset + size == raw.size() ? 1 : 0);   //last block?
+        zlib.insert(zlib.end(), { (unsigned char)size, (unsigned char)(size >> 8), (unsigned char)~size, (unsigned char)(~size >> 8) });
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; i++) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    put32(zlib, b << 16 | a);
+
+    out.clear();
+    out.insert(out.end(), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' });
+    std::vector<unsigned char> header;
+    put32(header, image.width);
+    put32(header, image.height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });   //8 bit RGB
+    pngChunk(out, "IHDR", header.data(), header.size());
+    pngChunk(out, "IDAT", zlib.data(), zlib.size());
+    pngChunk(out, "IEND", nullptr, 0);
+}
+
+static void writeY4mHeader(std::ostream& out, const ReadbackImage& image, unsigned int fps) {
+    out << "YUV4MPEG2 W" << image.width << " H" << image.height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+}
+
+//full range BT.601 as C420jpeg says, chroma averaged over 2x2 pixels. 16.16 fixed point
+static void encodeY4mFrame(const ReadbackImage& image, std::vector<unsigned char>& out) {
+    const int width = image.width, height = image.height;
+    const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    out.resize(6 + (size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    memcpy(out.data(), "FRAME\n", 6);
+    unsigned char* luma = &out[6];
+    unsigned char* cb = luma + (size_t)width * height;
+    unsigned char* cr = cb + (size_t)chromaWidth * chromaHeight;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rowOf(image, y);
+        for (int x = 0; x < width; x++)
+            luma[y * width + x] = (unsigned char)((19595 * row[x * 4] + 38470 * row[x * 4 + 1] + 7471 * row[x * 4 + 2] + 32768) >> 16);
+    }
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        const unsigned char* rows[2] = { rowOf(image, cy * 2), rowOf(image, std::min(cy * 2 + 1, height - 1)) };
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0;
+            const int x0 = cx * 2 * 4, x1 = std::min(cx * 2 + 1, width - 1) * 4;
+            for (const unsigned char* row : rows) {
+                r += row[x0] + row[x1];
+                g += row[x0 + 1] + row[x1 + 1];
+                b += row[x0 + 2] + row[x1 + 2];
+            }
+            //sums of 4, the >> 18 divides by them too
+            cb[cy * chromaWidth + cx] = (unsigned char)((-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18);
+            cr[cy * chromaWidth + cx] = (unsigned char)((32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18);
+        }
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    if (m_writer.joinable()) {
+        m_running = false;
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_one();
+        m_writer.join();
+    }
+}
+
+bool FrameCapture::init(unsigned int bufferedFrames) {
+    if (bufferedFrames == 0 || !m_readback.init(3))
+        return false;
+    //room for every image plus the markers that only close a file
+    m_toWriter.reset(new SpscQueue<WriterItem>(bufferedFrames * 2 + 4));
+    m_free.reset(new SpscQueue<ReadbackImage*>(bufferedFrames));
+    for (unsigned int i = 0; i < bufferedFrames; i++) {
+        m_images.emplace_back(new ReadbackImage());
+        m_free->push(m_images.back().get());
+    }
+    m_running = true;
+    m_writer = std::thread(&FrameCapture::writerLoop, this);
+    return true;
+}
+
+void FrameCapture::shutdown() {
+    if (!m_running)
+        return;
+    stopSequence();
+    //the readbacks still in flight, waiting for the GPU and for buffers is fine now
+    while (m_readback.pending() > 0) {
+        while (!m_held && !m_free->pop(m_held))
+            std::this_thread::yield();
+        m_readback.wait(*m_held);
+        send(m_held, m_requests.front());
+        m_requests.pop_front();
+        m_held = nullptr;
+    }
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+    m_writer.join();
+}
+
+void FrameCapture::screenshot(const std::string& path) {
+    m_pendingScreenshot = path;
+}
+
+void FrameCapture::startSequence(const std::string& path, CaptureFormat format, unsigned int fps) {
+    stopSequence();
+    m_sequencePath = path;
+    m_sequenceFormat = format;
+    m_sequenceFps = fps;
+    m_sequenceFrame = 0;
+}
+
+void FrameCapture::stopSequence() {
+    if (m_sequencePath.empty())
+        return;
+    if (m_sequenceFormat == CaptureFormat::Y4m) {
+        Request close = { m_sequencePath, CaptureFormat::Y4m, m_sequenceFps, true, false };
+        if (!m_requests.empty() && !m_requests.back().screenshot && m_requests.back().path == m_sequencePath)
+            m_requests.back().closes = true;
+        else
+            send(nullptr, close);
+    }
+    m_sequencePath.clear();
+}
+
+void FrameCapture::send(ReadbackImage* image, const Request& request) {
+    WriterItem item;
+    item.image = image;
+    item.request = request;
+    m_toWriter->push(item);     //can't fail, it has room for every image
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+void FrameCapture::collect() {
+    for (;;) {
+        if (!m_held)
+            m_free->pop(m_held);
+        ReadbackImage* image = m_held ? m_held : &m_scratch;
+        if (!m_readback.poll(*image))
+            return;
+        const Request request = m_requests.front();
+        m_requests.pop_front();
+        if (image == &m_scratch) {
+            m_stats.dropped++;
+            if (request.closes && request.format == CaptureFormat::Y4m && !request.screenshot)
+                send(nullptr, request);
+            continue;
+        }
+        m_held = nullptr;
+        send(image, request);
+    }
+}
+
+void FrameCapture::frame(int width, int height) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (!m_running)
+        return;
+    collect();
+
+    std::vector<Request> requests;
+    if (!m_pendingScreenshot.empty()) {
+        requests.push_back({ m_pendingScreenshot, formatOf(m_pendingScreenshot), 60, true, true });
+        m_pendingScreenshot.clear();
+    }
+    if (!m_sequencePath.empty()) {
+        Request request = { m_sequencePath, m_sequenceFormat, m_sequenceFps, false, false };
+        if (m_sequenceFormat != CaptureFormat::Y4m) {
+            char number[16];
+            snprintf(number, sizeof(number), "_%05u.", m_sequenceFrame);
+            const size_t dot = m_sequencePath.find_last_of('.');
+            request.path = m_sequencePath.substr(0, dot) + number + captureFormatName(m_sequenceFormat);
+        }
+        m_sequenceFrame++;
+        requests.push_back(request);
+    }
+    for (const Request& request : requests) {
+        m_stats.requested++;
+        if (m_readback.request(0, 0, width, height, m_stats.requested))
+            m_requests.push_back(request);
+        else
+            m_stats.dropped++;
+    }
+    m_stats.issueMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+FrameCaptureStats FrameCapture::stats() const {
+    FrameCaptureStats stats = m_stats;
+    stats.written = m_written.load(std::memory_order_relaxed);
+    stats.encodeMilliseconds = m_encodeNanoseconds.load(std::memory_order_relaxed) / 1e6;
+    stats.writerMilliseconds = m_writerNanoseconds.load(std::memory_order_relaxed) / 1e6;
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FrameCapture::writerLoop() {
+    for (;;) {
+        WriterItem item;
+        if (m_toWriter->pop(item)) {
+            write(item);
+            continue;
+        }
+        if (!m_running.load())
+            break;
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() { return !m_running.load() || !m_toWriter->empty(); });
+    }
+    //everything sent before shutdown() is written by now
+    m_stream.close();
+}
+
+void FrameCapture::write(const WriterItem& item) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    const Request& request = item.request;
+    const bool sequence = request.format == CaptureFormat::Y4m && !request.screenshot;
+    if (sequence && m_streamPath != request.path) {
+        m_stream.close();
+        m_streamPath.clear();
+    }
+
+    if (item.image) {
+        const ReadbackImage& image = *item.image;
+        thread_local std::vector<unsigned char> encoded;
+        encoded.clear();
+        if (sequence) {
+            if (!m_stream.is_open()) {
+                m_stream.open(request.path, std::ios::binary);
+                writeY4mHeader(m_stream, image, request.fps);
+                m_streamPath = request.path;
+                m_streamWidth = image.width;
+                m_streamHeight = image.height;
+            }
+            //a Y4M file has one size, frames after a resize are left out
+            if (image.width == m_streamWidth && image.height == m_streamHeight) {
+                encodeY4mFrame(image, encoded);
+                m_stream.write((const char*)encoded.data(), encoded.size());
+            }
+        }
+        else {
+            std::ofstream out(request.path, std::ios::binary);
+            if (request.format == CaptureFormat::Y4m) {
+                //a one frame sequence, a recording's stream stays open meanwhile
+                writeY4mHeader(out, image, request.fps);
+                encodeY4mFrame(image, encoded);
+            }
+            else if (request.format == CaptureFormat::Png) {
+                encodePng(image, encoded);
+            }
+            else {
+                encodeQoi(image, encoded);
+            }
+            out.write((const char*)encoded.data(), encoded.size());
+            if (!out)
+                std::cout << "Can't write " << request.path << std::endl;
+        }
+        const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        m_written.fetch_add(1, std::memory_order_relaxed);
+        m_encodeNanoseconds.store(nanoseconds, std::memory_order_relaxed);
+        m_writerNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        m_bytesWritten.fetch_add(encoded.size(), std::memory_order_relaxed);
+        m_free->push(item.image);
+    }
+
+    if (request.closes && sequence) {
+        if (!m_stream)
+            std::cout << "Can't write " << request.path << std::endl;
+        m_stream.close();
+        m_streamPath.clear();
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AsyncReadback.h"
+#include "SpscQueue.h"
+
+enum class CaptureFormat {
+    Qoi,    //lossless and fast to encode, one file per frame
+    Png,    //stored without compression (no zlib here), one file per frame
+    Y4m     //raw YUV 4:2:0, a whole sequence in one file, what ffmpeg and most players read
+};
+
+const char* captureFormatName(CaptureFormat format);
+
+struct FrameCaptureStats {
+    uint32_t requested = 0;
+    uint32_t written = 0;
+    uint32_t dropped = 0;               //readback ring or every buffer full, the writer can't keep up
+    double issueMilliseconds = 0.0;     //the last frame(), all the GL thread pays
+    double encodeMilliseconds = 0.0;    //the writer's last frame, encoding and writing
+    double writerMilliseconds = 0.0;    //every frame so far, encoding and writing
+    uint64_t bytesWritten = 0;
+};
+
+/*
+Frame Capture
+    Screenshots and recordings that never stall the GL thread: frame() queues a readback of the
+    back buffer through AsyncReadback and hands finished ones, 2 or 3 frames later, to a writer
+    thread that encodes and writes them. Between the two sit bufferedFrames images that go back
+    and forth through a pair of lock-free queues, so nothing is allocated per frame. When the
+    writer falls that far behind, frames are dropped and counted rather than waited for.
+
+    At 1080p a frame is 8 MB to copy out and about 3 MB of Y4M to write, which one writer thread
+    keeps up with at 60 fps; QOI and PNG cost more per frame and suit screenshots.
+
+        capture.init();
+        capture.screenshot("shot.png");             //the next frame
+        capture.startSequence("run.y4m", CaptureFormat::Y4m, 60);
+        ...every frame, after drawing and before the swap:
+        capture.frame(width, height);
+        ...
+        capture.shutdown();                         //context current, writes whatever is pending
+*/
+class FrameCapture {
+public:
+    FrameCapture() = default;
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+    ~FrameCapture();
+
+    bool init(unsigned int bufferedFrames = 8);
+    void shutdown();
+
+    //GL thread
+    void screenshot(const std::string& path);   //.qoi, .png or .y4m
+    //Y4M goes to path, QOI and PNG to path_00000.qoi and on
+    void startSequence(const std::string& path, CaptureFormat format, unsigned int fps = 60);
+    void stopSequence();
+    bool recording() const { return !m_sequencePath.empty(); }
+    bool wantsFrame() const { return recording() || !m_pendingScreenshot.empty(); }
+    void frame(int width, int height);
+
+    FrameCaptureStats stats() const;
+
+private:
+    struct Request {
+        std::string path;
+        CaptureFormat format;
+        unsigned int fps;
+        bool closes;            //the last frame of its file
+        bool screenshot;        //a file of its own even as Y4M, never the recording's stream
+    };
+
+    struct WriterItem {
+        ReadbackImage* image = nullptr;     //null only closes the open file
+        Request request;
+    };
+
+    void collect();
+    void send(ReadbackImage* image, const Request& request);
+    void writerLoop();
+    void write(const WriterItem& item);
+
+    AsyncReadback m_readback;
+    std::deque<Request> m_requests;     //in readback order
+    std::vector<std::unique_ptr<ReadbackImage>> m_images;
+    std::unique_ptr<SpscQueue<WriterItem>> m_toWriter;
+    std::unique_ptr<SpscQueue<ReadbackImage*>> m_free;
+    ReadbackImage* m_held = nullptr;    //taken from m_free, not filled yet
+    ReadbackImage m_scratch;            //a readback no buffer was free for
+
+    std::string m_pendingScreenshot;
+    std::string m_sequencePath;
+    CaptureFormat m_sequenceFormat = CaptureFormat::Y4m;
+    unsigned int m_sequenceFps = 60;
+    unsigned int m_sequenceFrame = 0;
+
+    std::thread m_writer;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running{ false };
+    std::ofstream m_stream;             //writer thread, the open Y4M file
+    std::string m_streamPath;
+    int m_streamWidth = 0;
+    int m_streamHeight = 0;
+
+    FrameCaptureStats m_stats;
+    std::atomic<uint32_t> m_written{ 0 };
+    std::atomic<uint64_t> m_encodeNanoseconds{ 0 };
+    std::atomic<uint64_t> m_writerNanoseconds{ 0 };
+    std::atomic<uint64_t> m_bytesWritten{ 0 };
+};
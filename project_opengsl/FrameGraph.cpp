@@ -0,0 +1,450 @@
+#include "FrameGraph.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <iostream>
+
+static const unsigned int MAX_IDLE_FRAMES = 8; //pooled objects unused for this long are deleted
+
+static bool isDepthFormat(unsigned int format) {
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 ||
+        format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool hasStencil(unsigned int format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t bytesPerPixel(unsigned int format) {
+    switch (format) {
+    case GL_R8:                 return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:  return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:  return 8;
+    case GL_RGBA32F:            return 16;
+    default:                    return 4; //RGBA8, RGB10_A2, R11F_G11F_B10F, R32F, DEPTH24_STENCIL8, ...
+    }
+}
+
+FrameGraphResource FrameGraphBuilder::createTexture(const char* name, const FrameGraphTextureDesc& desc) {
+    FrameGraph::Resource resource = {};
+    resource.name = name;
+    resource.type = FrameGraph::ResourceType::Texture;
+    resource.texture = desc;
+    return write(m_graph.addResource(resource));
+}
+
+FrameGraphResource FrameGraphBuilder::createBuffer(const char* name, size_t size) {
+    FrameGraph::Resource resource = {};
+    resource.name = name;
+    resource.type = FrameGraph::ResourceType::Buffer;
+    resource.bufferSize = size;
+    return write(m_graph.addResource(resource));
+}
+
+FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource) {
+    m_graph.m_passes[m_pass].reads.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::write(FrameGraphResource resource) {
+    m_graph.m_passes[m_pass].writes.push_back(resource);
+    m_graph.m_resources[resource].writers.push_back(m_pass);
+    return resource;
+}
+
+FrameGraph::~FrameGraph() {
+    for (const PhysicalResource& physical : m_pool) {
+        if (physical.type == ResourceType::Texture)
+            glDeleteTextures(1, &physical.glName);
+        else
+            glDeleteBuffers(1, &physical.glName);
+    }
+    for (const auto& entry : m_framebuffers)
+        glDeleteFramebuffers(1, &entry.second);
+}
+
+FrameGraphResource FrameGraph::addResource(const Resource& resource) {
+    m_resources.push_back(resource);
+    Resource& added = m_resources.back();
+    added.physical = -1;
+    added.firstPass = -1;
+    added.lastPass = -1;
+    return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+FrameGraphResource FrameGraph::importTexture(const char* name, unsigned int texture, const FrameGraphTextureDesc& desc) {
+    Resource resource = {};
+    resource.name = name;
+    resource.type = ResourceType::Texture;
+    resource.texture = desc;
+    resource.imported = true;
+    resource.glName = texture;
+    return addResource(resource);
+}
+
+FrameGraphResource FrameGraph::importBackbuffer(int width, int height) {
+    FrameGraphResource resource = importTexture("backbuffer", 0, { width, height, GL_RGBA8 });
+    m_resources[resource].backbuffer = true;
+    return resource;
+}
+
+void FrameGraph::addPass(const char* name,
+    const std::function<void(FrameGraphBuilder&)>& setup,
+    const std::function<void(const FrameGraph&)>& execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = execute;
+    pass.refCount = 0;
+    pass.culled = false;
+    m_passes.push_back(pass);
+
+    FrameGraphBuilder builder(*this, (unsigned int)(m_passes.size() - 1));
+    setup(builder);
+}
+
+void FrameGraph::markOutput(FrameGraphResource resource) {
+    m_resources[resource].output = true;
+}
+
+size_t FrameGraph::resourceBytes(const Resource& resource) const {
+    if (resource.type == ResourceType::Buffer)
+        return resource.bufferSize;
+    return (size_t)resource.texture.width * resource.texture.height * bytesPerPixel(resource.texture.format);
+}
+
+size_t FrameGraph::physicalBytes(const PhysicalResource& physical) {
+    if (physical.type == ResourceType::Buffer)
+        return physical.bufferSize;
+    return (size_t)physical.texture.width * physical.texture.height * bytesPerPixel(physical.texture.format);
+}
+
+unsigned int FrameGraph::acquirePhysical(const Resource& resource) {
+    for (size_t i = 0; i < m_pool.size(); i++) {
+        PhysicalResource& physical = m_pool[i];
+        if (physical.busy || physical.type != resource.type)
+            continue;
+
+        bool compatible;
+        if (resource.type == ResourceType::Texture) {
+            compatible = physical.texture.width == resource.texture.width &&
+                physical.texture.height == resource.texture.height &&
+                physical.texture.format == resource.texture.format;
+        }
+        else {
+            //don't let a tiny buffer pin a huge one
+            compatible = physical.bufferSize >= resource.bufferSize && physical.bufferSize <= resource.bufferSize * 2;
+        }
+
+        if (compatible) {
+            physical.busy = true;
+            physical.usedThisFrame = true;
+            return (unsigned int)i;
+        }
+    }
+
+    PhysicalResource physical = {};
+    physical.type = resource.type;
+    physical.busy = true;
+    physical.usedThisFrame = true;
+
+    if (resource.type == ResourceType::Texture) {
+        physical.texture = resource.texture;
+        glGenTextures(1, &physical.glName);
+        glBindTexture(GL_TEXTURE_2D, physical.glName);
+        glTexStorage2D(GL_TEXTURE_2D, 1, resource.texture.format, resource.texture.width, resource.texture.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    else {
+        physical.bufferSize = resource.bufferSize;
+        glGenBuffers(1, &physical.glName);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, physical.glName);
+        glBufferData(GL_COPY_WRITE_BUFFER, resource.bufferSize, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    m_pool.push_back(physical);
+    return (unsigned int)(m_pool.size() - 1);
+}
+
+void FrameGraph::compile() {
+    m_stats = FrameGraphStats();
+    m_stats.passes = (unsigned int)m_passes.size();
+
+    //reference counts: passes count their outputs, resources count their readers
+    for (Pass& pass : m_passes) {
+        pass.refCount = (unsigned int)pass.writes.size();
+        pass.culled = false;
+        for (FrameGraphResource resource : pass.reads)
+            m_resources[resource].refCount++;
+    }
+
+    //walk back from every unread resource, culling writers that end up with no readers
+    std::vector<FrameGraphResource> unreferenced;
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        if (m_resources[i].output)
+            m_resources[i].refCount++;
+        if (m_resources[i].refCount == 0)
+            unreferenced.push_back((FrameGraphResource)i);
+    }
+    while (!unreferenced.empty()) {
+        Resource& resource = m_resources[unreferenced.back()];
+        unreferenced.pop_back();
+
+        for (unsigned int writer : resource.writers) {
+            Pass& pass = m_passes[writer];
+            if (pass.culled || --pass.refCount > 0)
+                continue;
+
+            pass.culled = true;
+            m_stats.culledPasses++;
+            for (FrameGraphResource read : pass.reads) {
+                if (--m_resources[read].refCount == 0)
+                    unreferenced.push_back(read);
+            }
+        }
+    }
+    for (Pass& pass : m_passes) {
+        if (pass.refCount == 0 && !pass.culled) { //passes that write nothing at all
+            pass.culled = true;
+            m_stats.culledPasses++;
+        }
+    }
+
+    //lifetimes, in pass indices
+    for (size_t p = 0; p < m_passes.size(); p++) {
+        const Pass& pass = m_passes[p];
+        if (pass.culled)
+            continue;
+        for (int list = 0; list < 2; list++) {
+            for (FrameGraphResource id : (list == 0 ? pass.reads : pass.writes)) {
+                Resource& resource = m_resources[id];
+                if (resource.firstPass < 0)
+                    resource.firstPass = (int)p;
+                resource.lastPass = (int)p;
+            }
+        }
+    }
+
+    //alias: a physical object is free again once the resource using it is past its last pass
+    for (PhysicalResource& physical : m_pool) {
+        physical.busy = false;
+        physical.usedThisFrame = false;
+    }
+    for (size_t p = 0; p < m_passes.size(); p++) {
+        if (m_passes[p].culled)
+            continue;
+
+        for (Resource& resource : m_resources) {
+            if (resource.imported || resource.firstPass != (int)p)
+                continue;
+            resource.physical = (int)acquirePhysical(resource);
+            resource.glName = m_pool[resource.physical].glName;
+            m_stats.unaliasedBytes += resourceBytes(resource);
+        }
+
+        //everything acquired and not yet released is alive during this pass
+        size_t liveBytes = 0;
+        for (const PhysicalResource& physical : m_pool) {
+            if (physical.busy)
+                liveBytes += physicalBytes(physical);
+        }
+        m_stats.peakBytes = std::max(m_stats.peakBytes, liveBytes);
+
+        for (Resource& resource : m_resources) {
+            if (resource.physical >= 0 && resource.lastPass == (int)p)
+                m_pool[resource.physical].busy = false;
+        }
+    }
+
+    for (const PhysicalResource& physical : m_pool) {
+        const size_t bytes = physicalBytes(physical);
+        m_stats.pooledBytes += bytes;
+        if (physical.usedThisFrame)
+            m_stats.aliasedBytes += bytes;
+    }
+}
+
+unsigned int FrameGraph::framebufferFor(const std::vector<unsigned int>& attachments) {
+    auto found = m_framebuffers.find(attachments);
+    if (found != m_framebuffers.end())
+        return found->second;
+
+    unsigned int fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    std::vector<GLenum> drawBuffers;
+    for (unsigned int texture : attachments) {
+        unsigned int format = 0;
+        for (const PhysicalResource& physical : m_pool) {
+            if (physical.type == ResourceType::Texture && physical.glName == texture)
+                format = physical.texture.format;
+        }
+        for (const Resource& resource : m_resources) {
+            if (resource.imported && resource.type == ResourceType::Texture && resource.glName == texture)
+                format = resource.texture.format;
+        }
+
+        GLenum attachment;
+        if (isDepthFormat(format)) {
+            attachment = hasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        }
+        else {
+            attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+            drawBuffers.push_back(attachment);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    }
+
+    if (drawBuffers.empty())
+        glDrawBuffer(GL_NONE);
+    else
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Frame graph framebuffer incomplete!" << std::endl;
+
+    m_framebuffers[attachments] = fbo;
+    return fbo;
+}
+
+void FrameGraph::execute() {
+    const bool canInvalidate = GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata;
+    std::vector<unsigned int> attachments;
+    std::vector<GLenum> invalidate;
+
+    for (size_t p = 0; p < m_passes.size(); p++) {
+        const Pass& pass = m_passes[p];
+        if (pass.culled)
+            continue;
+
+        //textures written by this pass become its render targets
+        attachments.clear();
+        bool toBackbuffer = false;
+        int width = 0, height = 0;
+        for (FrameGraphResource id : pass.writes) {
+            const Resource& resource = m_resources[id];
+            if (resource.type != ResourceType::Texture)
+                continue;
+            if (resource.backbuffer)
+                toBackbuffer = true;
+            else
+                attachments.push_back(resource.glName);
+            width = resource.texture.width;
+            height = resource.texture.height;
+        }
+
+        //attachment points in the same order framebufferFor() assigned them
+        auto attachmentPoints = [&](bool dying) {
+            invalidate.clear();
+            GLenum color = GL_COLOR_ATTACHMENT0;
+            for (FrameGraphResource id : pass.writes) {
+                const Resource& resource = m_resources[id];
+                if (resource.type != ResourceType::Texture || resource.backbuffer)
+                    continue;
+                GLenum point = isDepthFormat(resource.texture.format)
+                    ? (hasStencil(resource.texture.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT)
+                    : color++;
+                if (resource.imported)
+                    continue;
+                //first use: whatever the aliased object held before is garbage
+                //last use: nobody reads what we just wrote
+                bool matches = dying ? (resource.lastPass == (int)p && !resource.output) : resource.firstPass == (int)p;
+                if (matches)
+                    invalidate.push_back(point);
+            }
+        };
+
+        if (toBackbuffer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+        }
+        else if (!attachments.empty()) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebufferFor(attachments));
+            glViewport(0, 0, width, height);
+
+            attachmentPoints(false);
+            if (canInvalidate && !invalidate.empty()) {
+                glInvalidateFramebuffer(GL_FRAMEBUFFER, (GLsizei)invalidate.size(), invalidate.data());
+                m_stats.invalidations += (unsigned int)invalidate.size();
+            }
+        }
+
+        pass.execute(*this);
+
+        if (canInvalidate && !toBackbuffer && !attachments.empty()) {
+            attachmentPoints(true);
+            if (!invalidate.empty()) {
+                glInvalidateFramebuffer(GL_FRAMEBUFFER, (GLsizei)invalidate.size(), invalidate.data());
+                m_stats.invalidations += (unsigned int)invalidate.size();
+            }
+        }
+
+        //resources this pass only samples or reads, like the G-buffer in lighting, are never attached
+        //here; once their last reader is done they are dropped through the object itself
+        if (canInvalidate) {
+            for (FrameGraphResource id : pass.reads) {
+                const Resource& resource = m_resources[id];
+                if (resource.imported || resource.output || resource.lastPass != (int)p
+                    || std::find(pass.writes.begin(), pass.writes.end(), id) != pass.writes.end())
+                    continue;
+                if (resource.type == ResourceType::Texture)
+                    glInvalidateTexImage(resource.glName, 0);
+                else
+                    glInvalidateBufferData(resource.glName);
+                m_stats.invalidations++;
+            }
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameGraph::reset() {
+    m_passes.clear();
+    m_resources.clear();
+
+    //age the pool, dropping objects (and the framebuffers using them) nobody asked for in a while
+    for (size_t i = 0; i < m_pool.size();) {
+        PhysicalResource& physical = m_pool[i];
+        physical.idleFrames = physical.usedThisFrame ? 0 : physical.idleFrames + 1;
+        physical.usedThisFrame = false;
+
+        if (physical.idleFrames <= MAX_IDLE_FRAMES) {
+            i++;
+            continue;
+        }
+
+        if (physical.type == ResourceType::Texture) {
+            for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+                if (std::find(it->first.begin(), it->first.end(), physical.glName) != it->first.end()) {
+                    glDeleteFramebuffers(1, &it->second);
+                    it = m_framebuffers.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+            glDeleteTextures(1, &physical.glName);
+        }
+        else {
+            glDeleteBuffers(1, &physical.glName);
+        }
+        m_pool.erase(m_pool.begin() + i);
+    }
+}
+
+unsigned int FrameGraph::texture(FrameGraphResource resource) const {
+    return m_resources[resource].glName;
+}
+
+unsigned int FrameGraph::buffer(FrameGraphResource resource) const {
+    return m_resources[resource].glName;
+}
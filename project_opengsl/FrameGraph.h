@@ -0,0 +1,151 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+Frame Graph
+    Every frame, passes declare which textures/buffers they create, read and write.
+    compile() then
+     - culls passes whose results nothing marked as output ever reads
+     - works out the first and last pass that touches each transient resource
+     - gives transient resources whose lifetimes don't overlap the same GL object
+    and execute() binds a framebuffer per pass, calls the pass, and invalidates
+    attachments whose contents nobody will read (glInvalidateFramebuffer), so tilers
+    and drivers can skip loads/stores. Resources whose last use is a read, never
+    attached by that pass, go after it through glInvalidateTexImage and
+    glInvalidateBufferData instead. Without GL 4.3 or ARB_invalidate_subdata the
+    invalidation is skipped, it's only a hint.
+    GL objects are pooled across frames, so a stable graph allocates nothing per frame.
+
+    FrameGraph graph;
+    FrameGraphResource backbuffer = graph.importBackbuffer(640, 480);
+    FrameGraphResource scene;
+    graph.addPass("scene",
+        [&](FrameGraphBuilder& builder) { scene = builder.createTexture("scene", { 640, 480, GL_RGBA8 }); },
+        [&](const FrameGraph& fg) { ...draw... });
+    graph.addPass("present",
+        [&](FrameGraphBuilder& builder) { builder.read(scene); builder.write(backbuffer); },
+        [&](const FrameGraph& fg) { glBindTexture(GL_TEXTURE_2D, fg.texture(scene)); ... });
+    graph.markOutput(backbuffer);
+    graph.compile();
+    graph.execute();
+    graph.reset();
+*/
+
+typedef unsigned int FrameGraphResource;
+
+struct FrameGraphTextureDesc {
+    int width;
+    int height;
+    unsigned int format; //sized internal format, e.g. GL_RGBA8, GL_DEPTH24_STENCIL8
+};
+
+struct FrameGraphStats {
+    unsigned int passes = 0;
+    unsigned int culledPasses = 0;
+    unsigned int invalidations = 0;
+    size_t peakBytes = 0;       //the most transient memory live at once during any one pass, after aliasing
+    size_t aliasedBytes = 0;    //every pooled object used this frame, after aliasing
+    size_t unaliasedBytes = 0;  //what it would have been with one allocation per resource
+    size_t pooledBytes = 0;     //everything the pool currently holds, including idle objects
+};
+
+class FrameGraph;
+
+class FrameGraphBuilder {
+public:
+    FrameGraphResource createTexture(const char* name, const FrameGraphTextureDesc& desc); //implies write
+    FrameGraphResource createBuffer(const char* name, size_t size);                        //implies write
+    FrameGraphResource read(FrameGraphResource resource);
+    FrameGraphResource write(FrameGraphResource resource);
+
+private:
+    friend class FrameGraph;
+    FrameGraphBuilder(FrameGraph& graph, unsigned int pass) : m_graph(graph), m_pass(pass) {}
+
+    FrameGraph& m_graph;
+    unsigned int m_pass;
+};
+
+class FrameGraph {
+public:
+    FrameGraph() = default;
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+    ~FrameGraph();
+
+    FrameGraphResource importTexture(const char* name, unsigned int texture, const FrameGraphTextureDesc& desc);
+    FrameGraphResource importBackbuffer(int width, int height);
+
+    void addPass(const char* name,
+        const std::function<void(FrameGraphBuilder&)>& setup,
+        const std::function<void(const FrameGraph&)>& execute);
+
+    void markOutput(FrameGraphResource resource); //keeps every pass contributing to it alive
+
+    void compile();
+    void execute();
+    void reset(); //forget this frame's passes and resources, keep the GL object pool
+
+    //valid inside a pass's execute callback
+    unsigned int texture(FrameGraphResource resource) const;
+    unsigned int buffer(FrameGraphResource resource) const;
+
+    const FrameGraphStats& stats() const { return m_stats; }
+
+private:
+    friend class FrameGraphBuilder;
+
+    enum class ResourceType { Texture, Buffer };
+
+    struct Resource {
+        std::string name;
+        ResourceType type;
+        FrameGraphTextureDesc texture;
+        size_t bufferSize;
+        bool imported;
+        bool backbuffer;
+        bool output;
+        unsigned int glName;        //imported objects, or the physical object after compile()
+        int physical;               //index into m_pool, -1 for imported resources
+        std::vector<unsigned int> writers;
+        unsigned int refCount;
+        int firstPass;
+        int lastPass;
+    };
+
+    struct Pass {
+        std::string name;
+        std::function<void(const FrameGraph&)> execute;
+        std::vector<FrameGraphResource> reads;
+        std::vector<FrameGraphResource> writes;
+        unsigned int refCount;
+        bool culled;
+    };
+
+    struct PhysicalResource {
+        ResourceType type;
+        FrameGraphTextureDesc texture;
+        size_t bufferSize;
+        unsigned int glName;
+        bool busy;          //assigned to a resource whose lifetime is still open during compile()
+        bool usedThisFrame;
+        unsigned int idleFrames;
+    };
+
+    FrameGraphResource addResource(const Resource& resource);
+    unsigned int acquirePhysical(const Resource& resource);
+    unsigned int framebufferFor(const std::vector<unsigned int>& attachments);
+    size_t resourceBytes(const Resource& resource) const;
+    static size_t physicalBytes(const PhysicalResource& physical);
+
+    std::vector<Pass> m_passes;
+    std::vector<Resource> m_resources;
+    std::vector<PhysicalResource> m_pool;
+    std::map<std::vector<unsigned int>, unsigned int> m_framebuffers; //attachment textures -> FBO
+    FrameGraphStats m_stats;
+};
@@ -0,0 +1,144 @@
+#include "FramePacer.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+const char* swapModeName(SwapMode mode) {
+    switch (mode) {
+    case SwapMode::Off:         return "off";
+    case SwapMode::Adaptive:    return "adaptive";
+    default:                    return "vsync";
+    }
+}
+
+static double milliseconds(std::chrono::high_resolution_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+FramePacer::~FramePacer() {
+    for (const FrameFence& fence : m_fences)
+        glDeleteSync((GLsync)fence.sync);
+#ifdef _WIN32
+    if (m_timerResolutionRaised)
+        timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::init(unsigned int maxFramesInFlight, SwapMode mode, double targetFrameRate) {
+#ifdef _WIN32
+    //Sleep() rounds up to the 15.6 ms system tick otherwise
+    m_timerResolutionRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+    //monitors may only be queried on the main thread, the pacer itself can move to a render thread
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* videoMode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    m_refreshRate = videoMode ? videoMode->refreshRate : 0;
+    setMaxFramesInFlight(maxFramesInFlight);
+    setSwapMode(mode);
+    setTargetFrameRate(targetFrameRate);
+}
+
+void FramePacer::setMaxFramesInFlight(unsigned int frames) {
+    m_maxFramesInFlight = std::min(std::max(frames, 1u), 3u);
+}
+
+void FramePacer::setSwapMode(SwapMode mode) {
+    if (mode == SwapMode::Adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        std::cout << "Adaptive vsync isn't supported, using vsync" << std::endl;
+        mode = SwapMode::VSync;
+    }
+    m_swapMode = mode;
+    glfwSwapInterval(mode == SwapMode::Off ? 0 : mode == SwapMode::VSync ? 1 : -1);
+    updateDeadline();
+}
+
+void FramePacer::setTargetFrameRate(double framesPerSecond) {
+    m_targetInterval = framesPerSecond > 0.0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+        : Clock::duration::zero();
+    m_nextFrame = Clock::now();
+    updateDeadline();
+}
+
+void FramePacer::updateDeadline() {
+    //without a target rate, a synced swap still promises one frame per refresh
+    m_deadline = m_targetInterval;
+    if (m_deadline == Clock::duration::zero() && m_swapMode != SwapMode::Off && m_refreshRate > 0)
+        m_deadline = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_refreshRate));
+}
+
+void FramePacer::retireFinishedFences() {
+    while (!m_fences.empty()) {
+        const FrameFence& oldest = m_fences.front();
+        if (glClientWaitSync((GLsync)oldest.sync, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        m_stats.gpuLatencyMilliseconds = milliseconds(Clock::now() - oldest.submitted);
+        glDeleteSync((GLsync)oldest.sync);
+        m_fences.pop_front();
+    }
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline) {
+    //sleep_for may wake up late, so leave it out of the last stretch and spin through that instead
+    const Clock::time_point sleepUntil = deadline - m_sleepOvershoot;
+    Clock::time_point now = Clock::now();
+    if (now < sleepUntil) {
+        std::this_thread::sleep_for(sleepUntil - now);
+        const Clock::duration overshoot = Clock::now() - sleepUntil;
+        //jump up to a bigger overshoot at once, come down slowly
+        m_sleepOvershoot = std::max(overshoot, m_sleepOvershoot - (m_sleepOvershoot - overshoot) / 16);
+    }
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+void FramePacer::beginFrame() {
+    const Clock::time_point start = Clock::now();
+    if (m_started) {
+        m_stats.frameMilliseconds = milliseconds(start - m_frameStart);
+        if (m_deadline > Clock::duration::zero() && start - m_frameStart > m_deadline + m_deadline / 20)
+            m_stats.missedDeadlines++;
+    }
+    else {
+        m_nextFrame = start - m_targetInterval; //the first frame is due right away
+    }
+    m_frameStart = start;
+    m_started = true;
+
+    //block until the frame maxFramesInFlight back has finished on the GPU
+    retireFinishedFences();
+    while (m_fences.size() >= m_maxFramesInFlight) {
+        const FrameFence& oldest = m_fences.front();
+        glClientWaitSync((GLsync)oldest.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        retireFinishedFences();
+    }
+    const Clock::time_point fencesDone = Clock::now();
+    m_stats.fenceWaitMilliseconds = milliseconds(fencesDone - start);
+    m_stats.framesInFlight = (unsigned int)m_fences.size();
+
+    if (m_targetInterval > Clock::duration::zero()) {
+        //a frame that ran long starts the schedule again instead of rushing the next ones
+        m_nextFrame += m_targetInterval;
+        if (m_nextFrame < fencesDone)
+            m_nextFrame = fencesDone;
+        waitUntil(m_nextFrame);
+    }
+    m_workStart = Clock::now();
+    m_stats.sleepMilliseconds = milliseconds(m_workStart - fencesDone);
+}
+
+void FramePacer::endFrame(GLFWwindow* window) {
+    glfwSwapBuffers(window);
+    m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), Clock::now() });
+    m_stats.cpuMilliseconds = milliseconds(m_fences.back().submitted - m_workStart);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <chrono>
+#include <deque>
+
+struct GLFWwindow;
+
+enum class SwapMode {
+    Off,
+    VSync,
+    Adaptive    //vsync, but a late frame tears instead of waiting a whole refresh; VSync without the extension
+};
+
+const char* swapModeName(SwapMode mode);
+
+struct FramePacerStats {
+    double frameMilliseconds = 0.0;         //beginFrame() to beginFrame()
+    double cpuMilliseconds = 0.0;           //end of pacing to endFrame(), the frame's own work
+    double fenceWaitMilliseconds = 0.0;     //blocked on the GPU for the frames in flight limit
+    double sleepMilliseconds = 0.0;         //waiting for the target frame rate, sleeping and spinning
+    double gpuLatencyMilliseconds = 0.0;    //endFrame() to its fence being seen signaled, the newest one retired
+    unsigned int framesInFlight = 0;        //submitted but not finished, after beginFrame()
+    unsigned int missedDeadlines = 0;       //frames longer than the target interval or the refresh interval, since init()
+};
+
+/*
+Frame Pacer
+    Keeps the driver from queueing frames ahead of the GPU. endFrame() swaps and drops a fence
+    behind the frame, beginFrame() blocks until no more than maxFramesInFlight - 1 frames are
+    still unfinished, then sleeps until the next frame is due at the target rate. Input should
+    be polled right after beginFrame() returns, so it is as fresh as possible when the frame is
+    submitted; with 1 frame in flight the latency is about one frame of CPU plus one of GPU.
+
+    The wait is a hybrid: std::this_thread::sleep_for for the bulk, then a spin for the last
+    stretch, as long as sleeps have been seen to overshoot. On Windows the timer resolution is
+    raised to 1 ms while a pacer is alive.
+*/
+class FramePacer {
+public:
+    FramePacer() = default;
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+    ~FramePacer();
+
+    //targetFrameRate 0 leaves the rate to the swap interval. the context must be current, and
+    //init() on the main thread; the rest may be called from whichever thread renders
+    void init(unsigned int maxFramesInFlight = 2, SwapMode mode = SwapMode::VSync, double targetFrameRate = 0.0);
+
+    void setMaxFramesInFlight(unsigned int frames);     //1 to 3
+    void setSwapMode(SwapMode mode);
+    void setTargetFrameRate(double framesPerSecond);    //0 for no limit
+
+    void beginFrame();
+    void endFrame(GLFWwindow* window);
+    //after a beginFrame() whose frame was skipped for having nothing to draw: the gap until
+    //the next one is idling, not a missed deadline
+    void idle() { m_started = false; }
+
+    SwapMode swapMode() const { return m_swapMode; }
+    const FramePacerStats& stats() const { return m_stats; }
+
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct FrameFence {
+        void* sync;     //GLsync
+        Clock::time_point submitted;
+    };
+
+    void updateDeadline();
+    void retireFinishedFences();
+    void waitUntil(Clock::time_point deadline);
+
+    unsigned int m_maxFramesInFlight = 2;
+    int m_refreshRate = 0;  //of the primary monitor at init()
+    SwapMode m_swapMode = SwapMode::VSync;
+    Clock::duration m_targetInterval = Clock::duration::zero();
+    Clock::duration m_deadline = Clock::duration::zero();              //longest frame that isn't a miss
+    Clock::duration m_sleepOvershoot = std::chrono::milliseconds(1);    //how late sleep_for has woken up lately
+    Clock::time_point m_nextFrame;
+    Clock::time_point m_frameStart;
+    Clock::time_point m_workStart;
+    bool m_started = false;
+    bool m_timerResolutionRaised = false;
+    std::deque<FrameFence> m_fences;
+    FramePacerStats m_stats;
+};
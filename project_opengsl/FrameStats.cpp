@@ -0,0 +1,232 @@
+#include "FrameStats.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+static const double BIN_MIN = 0.01;     //milliseconds, the lower edge of bin 1, bin 0 takes everything below
+static const double BIN_RATIO = 1.05;
+
+const char* frameMetricName(FrameMetric metric) {
+    switch (metric) {
+    case FrameMetric::Cpu:  return "cpu";
+    case FrameMetric::Gpu:  return "gpu";
+    default:                return "present";
+    }
+}
+
+FrameStats::FrameStats(uint32_t window)
+    : m_ring(window == 0 ? 1 : window) {
+}
+
+FrameStats::~FrameStats() {
+    if (!m_gpuSupported)
+        return;
+    for (GpuSlot& slot : m_gpuSlots)
+        glDeleteQueries(2, slot.queries);
+}
+
+bool FrameStats::init() {
+    m_gpuSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if (!m_gpuSupported) {
+        std::cout << "Timer queries aren't supported, no GPU frame times" << std::endl;
+        return false;
+    }
+    for (GpuSlot& slot : m_gpuSlots)
+        glGenQueries(2, slot.queries);
+    return true;
+}
+
+double FrameStats::binMilliseconds(unsigned int bin) {
+    return bin == 0 ? 0.0 : BIN_MIN * std::pow(BIN_RATIO, (double)(bin - 1));
+}
+
+unsigned int FrameStats::binOf(float milliseconds) {
+    if (milliseconds < BIN_MIN)
+        return 0;
+    const unsigned int bin = 1 + (unsigned int)(std::log(milliseconds / BIN_MIN) / std::log(BIN_RATIO));
+    return std::min(bin, BINS - 1);
+}
+
+void FrameStats::add(FrameMetric metric, uint64_t frame, float value) {
+    const int index = (int)metric;
+    m_histograms[index][binOf(value)]++;
+    m_samples[index]++;
+
+    //anything older and no bigger can never be the max again
+    std::deque<MaxEntry>& max = m_max[index];
+    while (!max.empty() && max.back().value <= value)
+        max.pop_back();
+    max.push_back({ frame, value });
+}
+
+void FrameStats::remove(const FrameRecord& record) {
+    for (int index = 0; index < (int)FrameMetric::Count; index++) {
+        if (record.values[index] < 0.0f)
+            continue;
+        m_histograms[index][binOf(record.values[index])]--;
+        m_samples[index]--;
+        std::deque<MaxEntry>& max = m_max[index];
+        while (!max.empty() && max.front().frame <= record.frame)
+            max.pop_front();
+    }
+}
+
+void FrameStats::beginGpu() {
+    if (!m_gpuSupported)
+        return;
+
+    GpuSlot& slot = m_gpuSlots[m_gpuWrite];
+    if (slot.pending) {
+        //the GPU is GPU_SLOTS frames behind, drop that frame rather than wait for it
+        m_skippedGpu++;
+        slot.pending = false;
+        m_gpuRead = (m_gpuWrite + 1) % GPU_SLOTS;
+    }
+    glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+    m_gpuActive = true;
+}
+
+void FrameStats::endGpu() {
+    if (!m_gpuActive)
+        return;
+
+    GpuSlot& slot = m_gpuSlots[m_gpuWrite];
+    glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+    slot.frame = m_frame;
+    slot.pending = true;
+    m_gpuWrite = (m_gpuWrite + 1) % GPU_SLOTS;
+    m_gpuActive = false;
+}
+
+void FrameStats::readGpu() {
+    while (m_gpuSlots[m_gpuRead].pending) {
+        GpuSlot& slot = m_gpuSlots[m_gpuRead];
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end);
+        slot.pending = false;
+        m_gpuRead = (m_gpuRead + 1) % GPU_SLOTS;
+
+        //too late if the frame has already left the window
+        FrameRecord& record = m_ring[slot.frame % m_ring.size()];
+        if (record.frame == slot.frame && end >= start) {
+            record.values[(int)FrameMetric::Gpu] = (float)((end - start) / 1e6);
+            add(FrameMetric::Gpu, slot.frame, record.values[(int)FrameMetric::Gpu]);
+        }
+    }
+}
+
+void FrameStats::endFrame(double cpuMilliseconds) {
+    const double now = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    const float present = m_lastPresent < 0.0 ? -1.0f : (float)((now - m_lastPresent) * 1000.0);
+    m_lastPresent = now;
+
+    FrameRecord& record = m_ring[m_frame % m_ring.size()];
+    if (m_frame >= m_ring.size())
+        remove(record);
+    record = FrameRecord();
+    record.frame = m_frame;
+
+    record.values[(int)FrameMetric::Cpu] = (float)cpuMilliseconds;
+    add(FrameMetric::Cpu, m_frame, record.values[(int)FrameMetric::Cpu]);
+    if (present >= 0.0f) {
+        //judged against the median before this frame joins it, a few samples in
+        if (m_samples[(int)FrameMetric::Present] >= 16 && present > 2.0 * percentile(FrameMetric::Present, 0.5))
+            m_stutters++;
+        record.values[(int)FrameMetric::Present] = present;
+        add(FrameMetric::Present, m_frame, present);
+    }
+
+    if (m_gpuSupported)
+        readGpu();
+    m_frame++;
+}
+
+double FrameStats::percentile(FrameMetric metric, double fraction) const {
+    const int index = (int)metric;
+    const uint32_t samples = m_samples[index];
+    if (samples == 0)
+        return 0.0;
+
+    const uint32_t target = std::max(1u, (uint32_t)std::ceil(fraction * samples));
+    uint32_t seen = 0;
+    for (unsigned int bin = 0; bin < BINS; bin++) {
+        seen += m_histograms[index][bin];
+        if (seen >= target) {
+            //the middle of the bin, but never past the real max
+            const double middle = bin == 0 ? BIN_MIN / 2.0 : binMilliseconds(bin) * std::sqrt(BIN_RATIO);
+            return std::min(middle, (double)m_max[index].front().value);
+        }
+    }
+    return m_max[index].front().value;
+}
+
+FrameMetricSummary FrameStats::summary(FrameMetric metric) const {
+    FrameMetricSummary summary;
+    summary.samples = m_samples[(int)metric];
+    if (summary.samples == 0)
+        return summary;
+    summary.p50 = percentile(metric, 0.5);
+    summary.p90 = percentile(metric, 0.9);
+    summary.p99 = percentile(metric, 0.99);
+    summary.max = m_max[(int)metric].front().value;
+    return summary;
+}
+
+bool FrameStats::writeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Can't write frame stats to " << path << std::endl;
+        return false;
+    }
+
+    out << "frame,cpu_ms,gpu_ms,present_ms\n";
+    const uint64_t count = std::min<uint64_t>(m_frame, m_ring.size());
+    for (uint64_t frame = m_frame - count; frame < m_frame; frame++) {
+        const FrameRecord& record = m_ring[frame % m_ring.size()];
+        out << record.frame;
+        for (float value : record.values) {
+            out << ',';
+            if (value >= 0.0f)
+                out << value;   //unknown stays empty
+        }
+        out << '\n';
+    }
+    return true;
+}
+
+bool FrameStats::writeJson(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Can't write frame stats to " << path << std::endl;
+        return false;
+    }
+
+    out << "{\n  \"frames\": " << m_frame << ",\n  \"window\": " << m_ring.size()
+        << ",\n  \"stutters\": " << m_stutters << ",\n  \"skippedGpuFrames\": " << m_skippedGpu << ",\n  \"metrics\": {";
+    for (int index = 0; index < (int)FrameMetric::Count; index++) {
+        const FrameMetricSummary metric = summary((FrameMetric)index);
+        out << (index ? "," : "") << "\n    \"" << frameMetricName((FrameMetric)index) << "\": {"
+            << "\"samples\": " << metric.samples << ", \"p50\": " << metric.p50 << ", \"p90\": " << metric.p90
+            << ", \"p99\": " << metric.p99 << ", \"max\": " << metric.max << ",\n      \"histogram\": [";
+        //non-empty bins only, as [lower edge in ms, count]
+        bool first = true;
+        for (unsigned int bin = 0; bin < BINS; bin++) {
+            if (m_histograms[index][bin] == 0)
+                continue;
+            out << (first ? "" : ", ") << "[" << binMilliseconds(bin) << ", " << m_histograms[index][bin] << "]";
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+enum class FrameMetric {
+    Cpu,        //the frame's own work, as the caller measured it
+    Gpu,        //GL_TIMESTAMP pair around the frame's commands, arrives a few frames late
+    Present,    //endFrame() to endFrame(), what the player sees
+    Count
+};
+
+const char* frameMetricName(FrameMetric metric);
+
+struct FrameMetricSummary {
+    uint32_t samples = 0;   //in the window
+    double p50 = 0.0;       //milliseconds
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;       //exact, the percentiles are histogram bins
+};
+
+/*
+Frame Stats
+    The last window frames' CPU, GPU and present times in a ring, with rolling percentiles
+    that are kept up incrementally instead of sorting every frame: each metric has a
+    histogram of the window with log spaced bins, 5% apart from 10 us to 1 s, that a new
+    frame adds to and the frame falling out of the window takes from. A percentile is a
+    walk over the bins, the max a monotonic queue.
+
+    A stutter is a present interval over twice the window's median at the time, counted
+    since the start. Everything can be dumped as CSV (one row per frame in the window) or
+    JSON (summary and histograms) for comparing runs.
+*/
+class FrameStats {
+public:
+    static const unsigned int BINS = 240;
+
+    explicit FrameStats(uint32_t window = 1024);
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+    ~FrameStats();
+
+    bool init();    //false without timer queries, the GPU metric then stays empty
+
+    //GL thread. beginGpu()/endGpu() around the frame's commands, endFrame() right after the swap
+    void beginGpu();
+    void endGpu();
+    void endFrame(double cpuMilliseconds);
+    //frames skipped on purpose, the gap until the next endFrame() is neither a present time nor a stutter
+    void idle() { m_lastPresent = -1.0; }
+
+    FrameMetricSummary summary(FrameMetric metric) const;
+    double percentile(FrameMetric metric, double fraction) const;  //fraction 0 to 1
+    const uint32_t* histogram(FrameMetric metric) const { return m_histograms[(int)metric]; }
+    static double binMilliseconds(unsigned int bin);    //lower edge
+
+    uint64_t frames() const { return m_frame; }
+    uint32_t stutters() const { return m_stutters; }
+    uint32_t skippedGpuFrames() const { return m_skippedGpu; }
+
+    bool writeCsv(const std::string& path) const;
+    bool writeJson(const std::string& path) const;
+
+private:
+    static const unsigned int GPU_SLOTS = 4;
+
+    struct FrameRecord {
+        uint64_t frame = 0;
+        float values[(int)FrameMetric::Count] = { -1.0f, -1.0f, -1.0f };  //-1 for not known (yet)
+    };
+
+    struct MaxEntry {
+        uint64_t frame;
+        float value;
+    };
+
+    struct GpuSlot {
+        unsigned int queries[2] = {};   //timestamps before and after
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    static unsigned int binOf(float milliseconds);
+    void add(FrameMetric metric, uint64_t frame, float value);
+    void remove(const FrameRecord& record);
+    void readGpu();
+
+    std::vector<FrameRecord> m_ring;
+    uint32_t m_histograms[(int)FrameMetric::Count][BINS] = {};
+    uint32_t m_samples[(int)FrameMetric::Count] = {};
+    std::deque<MaxEntry> m_max[(int)FrameMetric::Count];    //decreasing values, oldest first
+
+    uint64_t m_frame = 0;
+    double m_lastPresent = -1.0;    //seconds
+    uint32_t m_stutters = 0;
+
+    GpuSlot m_gpuSlots[GPU_SLOTS];
+    unsigned int m_gpuWrite = 0;
+    unsigned int m_gpuRead = 0;
+    bool m_gpuSupported = false;
+    bool m_gpuActive = false;
+    uint32_t m_skippedGpu = 0;
+};
@@ -0,0 +1,293 @@
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <chrono>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define CULL_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define CULL_TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define CULL_X86 0
+#endif
+
+static const uint32_t SIMD_WIDTH = 8; //arrays are padded to this, enough for every kernel
+
+uint32_t CullingBounds::add(const Aabb& box) {
+    uint32_t index = m_count++;
+    if (centerX.size() < m_count) {
+        size_t padded = (m_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+        for (std::vector<float>* array : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius })
+            array->resize(padded, 0.0f);
+    }
+    set(index, box);
+    return index;
+}
+
+void CullingBounds::set(uint32_t index, const Aabb& box) {
+    centerX[index] = (box.min.x + box.max.x) * 0.5f;
+    centerY[index] = (box.min.y + box.max.y) * 0.5f;
+    centerZ[index] = (box.min.z + box.max.z) * 0.5f;
+    extentX[index] = (box.max.x - box.min.x) * 0.5f;
+    extentY[index] = (box.max.y - box.min.y) * 0.5f;
+    extentZ[index] = (box.max.z - box.min.z) * 0.5f;
+    radius[index] = std::sqrt(extentX[index] * extentX[index] + extentY[index] * extentY[index] + extentZ[index] * extentZ[index]);
+}
+
+void CullingBounds::setSphere(uint32_t index, const Vec3& center, float r) {
+    set(index, { { center.x - r, center.y - r, center.z - r }, { center.x + r, center.y + r, center.z + r } });
+    radius[index] = r;
+}
+
+void CullingBounds::clear() {
+    m_count = 0;
+    for (std::vector<float>* array : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius })
+        array->clear();
+}
+
+Aabb CullingBounds::box(uint32_t index) const {
+    return {
+        { centerX[index] - extentX[index], centerY[index] - extentY[index], centerZ[index] - extentZ[index] },
+        { centerX[index] + extentX[index], centerY[index] + extentY[index], centerZ[index] + extentZ[index] }
+    };
+}
+
+#if CULL_X86
+static void cpuid(int info[4], int leaf, int subleaf) {
+#ifdef _MSC_VER
+    __cpuidex(info, leaf, subleaf);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+#endif
+}
+
+static uint64_t xgetbv0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static int lowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+SimdLevel detectSimdLevel() {
+#if CULL_X86
+    int info[4];
+    cpuid(info, 0, 0);
+    const int maxLeaf = info[0];
+
+    cpuid(info, 1, 0);
+    const bool sse2 = (info[3] >> 26) & 1;
+    const bool osxsave = (info[2] >> 27) & 1;
+    const bool avx = (info[2] >> 28) & 1;
+
+    bool avx2 = false;
+    //the OS also has to save the YMM registers on context switches
+    if (osxsave && avx && (xgetbv0() & 6) == 6 && maxLeaf >= 7) {
+        cpuid(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+
+    if (avx2)
+        return SimdLevel::AVX2;
+    if (sse2)
+        return SimdLevel::SSE;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2:   return "AVX2";
+    case SimdLevel::SSE:    return "SSE";
+    default:                return "scalar";
+    }
+}
+
+typedef void (*CullKernel)(const Frustum&, const CullingBounds&, uint32_t, uint32_t, bool, std::vector<uint32_t>&);
+
+//[begin, end) must be multiples of SIMD_WIDTH inside the padded arrays
+static void cullScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, bool spheres, std::vector<uint32_t>& visible) {
+    end = std::min(end, bounds.size());
+    for (uint32_t i = begin; i < end; i++) {
+        bool outside = false;
+        for (const Plane& plane : frustum.planes) {
+            float distance = plane.a * bounds.centerX[i] + plane.b * bounds.centerY[i] + plane.c * bounds.centerZ[i] + plane.d;
+            float r = spheres ? bounds.radius[i]
+                : std::fabs(plane.a) * bounds.extentX[i] + std::fabs(plane.b) * bounds.extentY[i] + std::fabs(plane.c) * bounds.extentZ[i];
+            outside |= distance + r < 0.0f;
+        }
+        if (!outside)
+            visible.push_back(i);
+    }
+}
+
+#if CULL_X86
+static void cullSse(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, bool spheres, std::vector<uint32_t>& visible) {
+    __m128 a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+    for (int p = 0; p < 6; p++) {
+        const Plane& plane = frustum.planes[p];
+        a[p] = _mm_set1_ps(plane.a);
+        b[p] = _mm_set1_ps(plane.b);
+        c[p] = _mm_set1_ps(plane.c);
+        d[p] = _mm_set1_ps(plane.d);
+        absA[p] = _mm_set1_ps(std::fabs(plane.a));
+        absB[p] = _mm_set1_ps(std::fabs(plane.b));
+        absC[p] = _mm_set1_ps(std::fabs(plane.c));
+    }
+    const __m128 zero = _mm_setzero_ps();
+    const uint32_t count = bounds.size();
+
+    for (uint32_t i = begin; i < end; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+        const __m128 radius = _mm_loadu_ps(&bounds.radius[i]);
+
+        __m128 outside = zero;
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[p], cx), _mm_mul_ps(b[p], cy)), _mm_add_ps(_mm_mul_ps(c[p], cz), d[p]));
+            __m128 r = spheres ? radius
+                : _mm_add_ps(_mm_add_ps(_mm_mul_ps(absA[p], ex), _mm_mul_ps(absB[p], ey)), _mm_mul_ps(absC[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), zero));
+        }
+
+        unsigned int mask = ~(unsigned int)_mm_movemask_ps(outside) & 0xF;
+        while (mask) {
+            uint32_t index = i + lowestBit(mask);
+            if (index < count)
+                visible.push_back(index);
+            mask &= mask - 1;
+        }
+    }
+}
+
+CULL_TARGET_AVX2
+static void cullAvx2(const Frustum& frustum, const CullingBounds& bounds, uint32_t begin, uint32_t end, bool spheres, std::vector<uint32_t>& visible) {
+    __m256 a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+    for (int p = 0; p < 6; p++) {
+        const Plane& plane = frustum.planes[p];
+        a[p] = _mm256_set1_ps(plane.a);
+        b[p] = _mm256_set1_ps(plane.b);
+        c[p] = _mm256_set1_ps(plane.c);
+        d[p] = _mm256_set1_ps(plane.d);
+        absA[p] = _mm256_set1_ps(std::fabs(plane.a));
+        absB[p] = _mm256_set1_ps(std::fabs(plane.b));
+        absC[p] = _mm256_set1_ps(std::fabs(plane.c));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    const uint32_t count = bounds.size();
+
+    for (uint32_t i = begin; i < end; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+        const __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+        const __m256 radius = _mm256_loadu_ps(&bounds.radius[i]);
+
+        __m256 outside = zero;
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[p], cx), _mm256_mul_ps(b[p], cy)), _mm256_add_ps(_mm256_mul_ps(c[p], cz), d[p]));
+            __m256 r = spheres ? radius
+                : _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absA[p], ex), _mm256_mul_ps(absB[p], ey)), _mm256_mul_ps(absC[p], ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_LT_OQ));
+        }
+
+        unsigned int mask = ~(unsigned int)_mm256_movemask_ps(outside) & 0xFF;
+        while (mask) {
+            uint32_t index = i + lowestBit(mask);
+            if (index < count)
+                visible.push_back(index);
+            mask &= mask - 1;
+        }
+    }
+}
+#endif
+
+FrustumCuller::FrustumCuller()
+    : m_supported(detectSimdLevel()), m_level(m_supported) {
+}
+
+void FrustumCuller::setSimdLevel(SimdLevel level) {
+    m_level = (int)level <= (int)m_supported ? level : m_supported;
+}
+
+void FrustumCuller::setJobSystem(JobSystem* jobs) {
+    m_jobs = jobs;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullShape shape) {
+    PROFILE_SCOPE("Frustum cull");
+    auto start = std::chrono::high_resolution_clock::now();
+
+    CullKernel kernel = cullScalar;
+#if CULL_X86
+    if (m_level == SimdLevel::AVX2)
+        kernel = cullAvx2;
+    else if (m_level == SimdLevel::SSE)
+        kernel = cullSse;
+#endif
+
+    const uint32_t count = bounds.size();
+    const uint32_t padded = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    const bool spheres = shape == CullShape::Sphere;
+    const size_t firstVisible = visible.size();
+
+    //chunks of at least 4096 objects, so small scenes don't pay for jobs. chunks are counted in
+    //SIMD_WIDTH blocks so every chunk starts on a block the kernels can load whole
+    const uint32_t blocks = padded / SIMD_WIDTH;
+    const uint32_t grain = 4096 / SIMD_WIDTH;
+    const uint32_t chunk = m_jobs ? m_jobs->chunkSize(blocks, grain) : std::max(blocks, 1u);
+    const uint32_t chunks = (blocks + chunk - 1) / chunk;
+
+    if (chunks <= 1) {
+        kernel(frustum, bounds, 0, padded, spheres, visible);
+    }
+    else {
+        m_chunkVisible.resize(chunks);
+        m_jobs->parallelFor(blocks, grain, [&](uint32_t begin, uint32_t end) {
+            //the first chunk appends straight to visible, the rest wait in order behind it
+            const uint32_t index = begin / chunk;
+            std::vector<uint32_t>& out = index == 0 ? visible : m_chunkVisible[index];
+            if (index != 0)
+                out.clear();
+            kernel(frustum, bounds, begin * SIMD_WIDTH, end * SIMD_WIDTH, spheres, out);
+        });
+
+        //chunks are appended in order, so the result doesn't depend on the thread count
+        for (uint32_t index = 1; index < chunks; index++)
+            visible.insert(visible.end(), m_chunkVisible[index].begin(), m_chunkVisible[index].end());
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.objects = count;
+    m_stats.visible = (uint32_t)(visible.size() - firstVisible);
+    m_stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    m_stats.objectsPerMillisecond = m_stats.milliseconds > 0.0 ? count / m_stats.milliseconds : 0.0;
+}
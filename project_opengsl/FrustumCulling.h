@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Geometry.h"
+
+class JobSystem;
+
+/*
+Culling Bounds
+    World-space bounds in structure-of-arrays form, so the SIMD kernels load 4 or 8
+    objects' centers (or extents, or radii) with one instruction. Every array is padded
+    to a multiple of 8 with empty entries the kernels never report.
+*/
+class CullingBounds {
+public:
+    uint32_t add(const Aabb& box);          //the sphere is the box's circumscribed sphere
+    void set(uint32_t index, const Aabb& box);
+    void setSphere(uint32_t index, const Vec3& center, float radius);
+    void clear();
+
+    uint32_t size() const { return m_count; }
+    Aabb box(uint32_t index) const;
+
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;   //half size
+    std::vector<float> radius;
+
+private:
+    uint32_t m_count = 0;
+};
+
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+enum class CullShape {
+    Box,
+    Sphere
+};
+
+struct CullStats {
+    uint32_t objects = 0;
+    uint32_t visible = 0;
+    double milliseconds = 0.0;
+    double objectsPerMillisecond = 0.0;
+};
+
+class FrustumCuller {
+public:
+    FrustumCuller();
+
+    void setSimdLevel(SimdLevel level);     //clamped to what the CPU supports
+    void setJobSystem(JobSystem* jobs);     //nullptr culls on the calling thread only
+    SimdLevel simdLevel() const { return m_level; }
+
+    //appends the indices of every object not completely outside the frustum, in index order
+    void cull(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullShape shape = CullShape::Box);
+
+    const CullStats& stats() const { return m_stats; }
+
+private:
+    SimdLevel m_supported;
+    SimdLevel m_level;
+    JobSystem* m_jobs = nullptr;
+    std::vector<std::vector<uint32_t>> m_chunkVisible;
+    CullStats m_stats;
+};
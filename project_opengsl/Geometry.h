@@ -0,0 +1,88 @@
+#pragma once
+#include <cmath>
+
+struct Vec3 {
+    float x, y, z;
+};
+
+struct Aabb {
+    Vec3 min;
+    Vec3 max;
+};
+
+//a*x + b*y + c*z + d >= 0 on the inside
+struct Plane {
+    float a, b, c, d;
+};
+
+inline Aabb aabbUnion(const Aabb& l, const Aabb& r) {
+    return {
+        { std::fmin(l.min.x, r.min.x), std::fmin(l.min.y, r.min.y), std::fmin(l.min.z, r.min.z) },
+        { std::fmax(l.max.x, r.max.x), std::fmax(l.max.y, r.max.y), std::fmax(l.max.z, r.max.z) }
+    };
+}
+
+inline float aabbSurfaceArea(const Aabb& box) {
+    float x = box.max.x - box.min.x;
+    float y = box.max.y - box.min.y;
+    float z = box.max.z - box.min.z;
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+/*
+Frustum
+    The 6 planes of a view-projection matrix (Gribb/Hartmann), pointing inwards.
+    The matrix is column major, like Std140Mat4 and glUniformMatrix4fv(..., GL_FALSE, ...).
+*/
+struct Frustum {
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, COUNT };
+    Plane planes[COUNT];
+
+    static Frustum fromMatrix(const float* m) {
+        //plane = row 3 +/- row 0 (left/right), 1 (bottom/top), 2 (near/far)
+        Frustum frustum;
+        const float r3[4] = { m[3], m[7], m[11], m[15] };
+        for (int p = 0; p < COUNT; p++) {
+            int axis = p / 2;
+            float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+            Plane& plane = frustum.planes[p];
+            plane.a = r3[0] + sign * m[axis + 0];
+            plane.b = r3[1] + sign * m[axis + 4];
+            plane.c = r3[2] + sign * m[axis + 8];
+            plane.d = r3[3] + sign * m[axis + 12];
+
+            float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+            if (length > 0.0f) {
+                plane.a /= length;
+                plane.b /= length;
+                plane.c /= length;
+                plane.d /= length;
+            }
+        }
+        return frustum;
+    }
+
+    //false only when the box is completely outside one of the planes
+    bool intersects(const Aabb& box) const {
+        for (const Plane& plane : planes) {
+            //the corner furthest along the plane normal
+            float x = plane.a >= 0.0f ? box.max.x : box.min.x;
+            float y = plane.b >= 0.0f ? box.max.y : box.min.y;
+            float z = plane.c >= 0.0f ? box.max.z : box.min.z;
+            if (plane.a * x + plane.b * y + plane.c * z + plane.d < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    bool contains(const Aabb& box) const {
+        for (const Plane& plane : planes) {
+            float x = plane.a >= 0.0f ? box.min.x : box.max.x;
+            float y = plane.b >= 0.0f ? box.min.y : box.max.y;
+            float z = plane.c >= 0.0f ? box.min.z : box.max.z;
+            if (plane.a * x + plane.b * y + plane.c * z + plane.d < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,100 @@
+#include "GlyphSource.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+/*
+GDI Glyph Source
+    GetGlyphOutline with GGO_GRAY8_BITMAP, which hands back 65 levels of coverage with
+    rows padded to 4 bytes.
+*/
+class GdiGlyphSource : public GlyphSource {
+public:
+    ~GdiGlyphSource() override {
+        if (m_dc) {
+            SelectObject(m_dc, m_previousFont);
+            DeleteDC(m_dc);
+        }
+        if (m_font)
+            DeleteObject(m_font);
+    }
+
+    bool open(const char* face, int pixelHeight) {
+        m_dc = CreateCompatibleDC(nullptr);
+        //a negative height asks for the character height rather than the cell height
+        m_font = CreateFontA(-pixelHeight, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+            OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, face);
+        if (!m_dc || !m_font) {
+            std::cout << "Failed to open font " << face << std::endl;
+            return false;
+        }
+        m_previousFont = SelectObject(m_dc, m_font);
+
+        TEXTMETRICA metrics;
+        GetTextMetricsA(m_dc, &metrics);
+        m_ascent = (float)metrics.tmAscent;
+        m_lineHeight = (float)(metrics.tmHeight + metrics.tmExternalLeading);
+        return true;
+    }
+
+    float lineHeight() const override { return m_lineHeight; }
+    float ascent() const override { return m_ascent; }
+
+    bool rasterize(uint32_t codepoint, GlyphBitmap& glyph) override {
+        const MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+        GLYPHMETRICS metrics;
+        DWORD size = GetGlyphOutlineW(m_dc, codepoint, GGO_GRAY8_BITMAP, &metrics, 0, nullptr, &identity);
+        if (size == GDI_ERROR)
+            return false;
+
+        glyph.advance = (float)metrics.gmCellIncX;
+        glyph.bearingX = metrics.gmptGlyphOrigin.x;
+        glyph.bearingY = metrics.gmptGlyphOrigin.y;
+        if (size == 0) { //blank, but GDI still reports a 1x1 black box
+            glyph.width = 0;
+            glyph.height = 0;
+            glyph.coverage.clear();
+            return true;
+        }
+
+        m_buffer.resize(size);
+        GetGlyphOutlineW(m_dc, codepoint, GGO_GRAY8_BITMAP, &metrics, size, m_buffer.data(), &identity);
+        glyph.width = (int)metrics.gmBlackBoxX;
+        glyph.height = (int)metrics.gmBlackBoxY;
+        glyph.coverage.resize((size_t)glyph.width * glyph.height);
+        const int pitch = (glyph.width + 3) & ~3;
+        for (int y = 0; y < glyph.height; y++) {
+            for (int x = 0; x < glyph.width; x++)
+                glyph.coverage[y * glyph.width + x] = (unsigned char)(m_buffer[y * pitch + x] * 255 / 64);
+        }
+        return true;
+    }
+
+private:
+    HDC m_dc = nullptr;
+    HFONT m_font = nullptr;
+    HGDIOBJ m_previousFont = nullptr;
+    float m_lineHeight = 0.0f;
+    float m_ascent = 0.0f;
+    std::vector<unsigned char> m_buffer;
+};
+
+std::unique_ptr<GlyphSource> createSystemGlyphSource(const char* face, int pixelHeight) {
+    std::unique_ptr<GdiGlyphSource> source(new GdiGlyphSource());
+    if (!source->open(face, pixelHeight))
+        return nullptr;
+    return std::move(source);
+}
+
+#else
+
+std::unique_ptr<GlyphSource> createSystemGlyphSource(const char* face, int pixelHeight) {
+    (void)pixelHeight;
+    std::cout << "No system font rasterizer on this platform, can't open " << face << std::endl;
+    return nullptr;
+}
+
+#endif
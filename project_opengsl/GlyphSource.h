@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct GlyphBitmap {
+    int width = 0;              //0 for blank glyphs like space
+    int height = 0;
+    int bearingX = 0;           //pen position to the bitmap's left edge
+    int bearingY = 0;           //baseline up to the bitmap's top edge
+    float advance = 0.0f;
+    std::vector<unsigned char> coverage;    //width * height, 0-255, top row first
+};
+
+/*
+Glyph Source
+    Where TextRenderer gets glyph coverage from. Everything is in pixels at the size the
+    source was opened with.
+*/
+class GlyphSource {
+public:
+    virtual ~GlyphSource() = default;
+
+    virtual float lineHeight() const = 0;
+    virtual float ascent() const = 0;
+    virtual bool rasterize(uint32_t codepoint, GlyphBitmap& glyph) = 0;
+};
+
+//the platform's font rasterizer (GDI on Windows), nullptr when the face can't be opened or there is none
+std::unique_ptr<GlyphSource> createSystemGlyphSource(const char* face, int pixelHeight);
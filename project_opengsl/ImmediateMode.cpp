@@ -0,0 +1,189 @@
+#include "ImmediateMode.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+static const unsigned int VERTICES_PER_PRIMITIVE[] = { 1, 2, 3 };
+static const GLenum DRAW_MODES[] = { GL_POINTS, GL_LINES, GL_TRIANGLES };
+
+ImmediateMode::~ImmediateMode() {
+    glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+bool ImmediateMode::init(unsigned int program, size_t streamingBytes) {
+    m_program = program;
+    m_viewProjectionLocation = glGetUniformLocation(program, "u_ViewProjection");
+    if (m_viewProjectionLocation == -1) {
+        std::cout << "ImmediateMode needs u_ViewProjection in its program" << std::endl;
+        return false;
+    }
+
+    m_stream.init(streamingBytes);
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream.buffer());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ImmediateVertex), (const void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImmediateVertex), (const void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void ImmediateMode::begin(unsigned int mode) {
+    if (m_inside)
+        std::cout << "ImmediateMode::begin() called twice without end()" << std::endl;
+    m_mode = mode;
+    m_inside = true;
+    m_current.clear();
+}
+
+void ImmediateMode::color(float r, float g, float b, float a) {
+    m_color = packColor(r, g, b, a);
+}
+
+void ImmediateMode::vertex(float x, float y, float z) {
+    m_current.push_back({ x, y, z, m_color });
+}
+
+void ImmediateMode::end() {
+    if (!m_inside)
+        return;
+    m_inside = false;
+
+    const std::vector<ImmediateVertex>& v = m_current;
+    const size_t n = v.size();
+    size_t before = 0;
+    for (int depthTest = 0; depthTest < 2; depthTest++) {
+        for (int p = 0; p < PRIMITIVE_COUNT; p++)
+            before += m_batches[depthTest][p].size();
+    }
+
+    switch (m_mode) {
+    case GL_POINTS: {
+        std::vector<ImmediateVertex>& points = batch(POINTS);
+        points.insert(points.end(), v.begin(), v.end());
+        break;
+    }
+    case GL_LINES: {
+        std::vector<ImmediateVertex>& lines = batch(LINES);
+        lines.insert(lines.end(), v.begin(), v.begin() + n / 2 * 2);
+        break;
+    }
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP: {
+        std::vector<ImmediateVertex>& lines = batch(LINES);
+        for (size_t i = 0; i + 1 < n; i++) {
+            lines.push_back(v[i]);
+            lines.push_back(v[i + 1]);
+        }
+        if (m_mode == GL_LINE_LOOP && n > 2) {
+            lines.push_back(v[n - 1]);
+            lines.push_back(v[0]);
+        }
+        break;
+    }
+    case GL_TRIANGLES: {
+        std::vector<ImmediateVertex>& triangles = batch(TRIANGLES);
+        triangles.insert(triangles.end(), v.begin(), v.begin() + n / 3 * 3);
+        break;
+    }
+    case GL_TRIANGLE_STRIP: {
+        //every other triangle swaps its first two vertices to keep the winding
+        std::vector<ImmediateVertex>& triangles = batch(TRIANGLES);
+        for (size_t i = 0; i + 2 < n; i++) {
+            triangles.push_back(v[i % 2 == 0 ? i : i + 1]);
+            triangles.push_back(v[i % 2 == 0 ? i + 1 : i]);
+            triangles.push_back(v[i + 2]);
+        }
+        break;
+    }
+    case GL_TRIANGLE_FAN:
+    case GL_POLYGON: {
+        std::vector<ImmediateVertex>& triangles = batch(TRIANGLES);
+        for (size_t i = 1; i + 1 < n; i++) {
+            triangles.push_back(v[0]);
+            triangles.push_back(v[i]);
+            triangles.push_back(v[i + 1]);
+        }
+        break;
+    }
+    case GL_QUADS: {
+        std::vector<ImmediateVertex>& triangles = batch(TRIANGLES);
+        for (size_t i = 0; i + 3 < n; i += 4) {
+            const size_t corners[6] = { i, i + 1, i + 2, i + 2, i + 3, i };
+            for (size_t corner : corners)
+                triangles.push_back(v[corner]);
+        }
+        break;
+    }
+    default:
+        std::cout << "ImmediateMode doesn't support primitive mode " << m_mode << std::endl;
+        return;
+    }
+
+    size_t after = 0;
+    for (int depthTest = 0; depthTest < 2; depthTest++) {
+        for (int p = 0; p < PRIMITIVE_COUNT; p++)
+            after += m_batches[depthTest][p].size();
+    }
+    m_frame.primitives++;
+    m_frame.vertices += (unsigned int)(after - before);
+}
+
+void ImmediateMode::lines(const ImmediateVertex* vertices, size_t count) {
+    std::vector<ImmediateVertex>& lines = batch(LINES);
+    count = count / 2 * 2;
+    lines.insert(lines.end(), vertices, vertices + count);
+    m_frame.primitives += (unsigned int)(count / 2);
+    m_frame.vertices += (unsigned int)count;
+}
+
+void ImmediateMode::flush(const float* viewProjection) {
+    m_stats = m_frame;
+    m_frame = ImmediateModeStats();
+    m_stream.resetStats();
+
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_viewProjectionLocation, 1, GL_FALSE, viewProjection);
+    glBindVertexArray(m_vertexArray);
+
+    const size_t vertexBytes = sizeof(ImmediateVertex);
+    for (int tested = 0; tested < 2; tested++) {
+        if (tested == 0)
+            glEnable(GL_DEPTH_TEST);
+        else
+            glDisable(GL_DEPTH_TEST);
+
+        //triangles first, lines and points on top of them read better
+        for (int p = PRIMITIVE_COUNT - 1; p >= 0; p--) {
+            std::vector<ImmediateVertex>& vertices = m_batches[tested][p];
+
+            //batches bigger than the streaming buffer go in several pieces of whole primitives
+            const size_t perDraw = m_stream.capacity() / vertexBytes / VERTICES_PER_PRIMITIVE[p] * VERTICES_PER_PRIMITIVE[p];
+            for (size_t first = 0; first < vertices.size() && perDraw > 0; first += perDraw) {
+                size_t count = std::min(perDraw, vertices.size() - first);
+                auto uploadStart = std::chrono::high_resolution_clock::now();
+                size_t offset = m_stream.upload(&vertices[first], count * vertexBytes, vertexBytes);
+                m_stats.uploadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+                glDrawArrays(DRAW_MODES[p], (GLint)(offset / vertexBytes), (GLsizei)count);
+                m_stats.drawCalls++;
+            }
+            vertices.clear();
+        }
+    }
+
+    glBindVertexArray(0);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    else
+        glDisable(GL_DEPTH_TEST);
+    if (!blend)
+        glDisable(GL_BLEND);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "StreamingBuffer.h"
+
+struct ImmediateVertex {
+    float x, y, z;
+    uint32_t color;     //RGBA8, red in the lowest byte
+};
+
+inline uint32_t packColor(float r, float g, float b, float a = 1.0f) {
+    auto channel = [](float value) { return (uint32_t)(std::fmin(std::fmax(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+struct ImmediateModeStats {
+    unsigned int primitives = 0;    //begin()/end() pairs
+    unsigned int vertices = 0;      //after strips, loops, fans and quads became lists
+    unsigned int drawCalls = 0;
+    double uploadMilliseconds = 0.0;    //copying the batches into the streaming buffer
+};
+
+/*
+Immediate Mode
+    glBegin/glColor/glVertex/glEnd for core profiles. end() turns whatever was drawn into
+    point, line or triangle lists and appends them to a CPU batch for that primitive and depth
+    test state. flush() uploads each batch to a streaming buffer and draws it with one
+    glDrawArrays, so thousands of begin/end pairs still cost at most 6 draws. Batches are
+    drawn triangles, lines, points, depth tested before overlay, not in submission order.
+*/
+class ImmediateMode {
+public:
+    ImmediateMode() = default;
+    ImmediateMode(const ImmediateMode&) = delete;
+    ImmediateMode& operator=(const ImmediateMode&) = delete;
+    ~ImmediateMode();
+
+    //program is VertexColor.shader
+    bool init(unsigned int program, size_t streamingBytes = 4 * 1024 * 1024);
+
+    void setDepthTest(bool enabled) { m_depthTest = enabled; }     //for begin/end pairs that follow
+    bool depthTest() const { return m_depthTest; }
+
+    //GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_QUADS or GL_POLYGON
+    void begin(unsigned int mode);
+    void color(float r, float g, float b, float a = 1.0f);
+    void vertex(float x, float y, float z = 0.0f);
+    void end();
+
+    //count vertices as a ready-made line list, each pair counts as one primitive
+    void lines(const ImmediateVertex* vertices, size_t count);
+
+    //draws everything since the last flush, viewProjection is column major
+    void flush(const float* viewProjection);
+
+    const ImmediateModeStats& stats() const { return m_stats; }     //what the last flush() drew
+
+private:
+    enum { POINTS, LINES, TRIANGLES, PRIMITIVE_COUNT };
+
+    std::vector<ImmediateVertex>& batch(int primitive) { return m_batches[m_depthTest ? 0 : 1][primitive]; }
+
+    unsigned int m_program = 0;
+    int m_viewProjectionLocation = -1;
+    unsigned int m_vertexArray = 0;
+    StreamingBuffer m_stream;
+
+    std::vector<ImmediateVertex> m_batches[2][PRIMITIVE_COUNT];    //depth tested, overlay
+    std::vector<ImmediateVertex> m_current;                         //between begin() and end()
+    unsigned int m_mode = 0;
+    bool m_inside = false;
+    bool m_depthTest = true;
+    uint32_t m_color = 0xFFFFFFFF;
+    ImmediateModeStats m_frame;     //since the last flush
+    ImmediateModeStats m_stats;     //of the last flush
+};
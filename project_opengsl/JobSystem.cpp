@@ -0,0 +1,287 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <string>
+#include "Profiler.h"
+
+struct Job {
+    std::function<void()> function;
+    JobCounter* counter;
+    bool glThread;
+};
+
+static std::atomic<uint64_t> s_nextId{ 1 };
+
+struct CachedDeque {
+    uint64_t owner;
+    WorkStealingDeque<Job>* deque;
+};
+static thread_local CachedDeque s_cachedDeque = { 0, nullptr };
+
+//xorshift, only picks which deque to steal from first
+static uint32_t randomIndex() {
+    thread_local uint32_t state = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+JobSystem::JobSystem()
+    : m_id(s_nextId++) {
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+void JobSystem::init(unsigned int workerThreads) {
+    shutdown();
+    m_id = s_nextId++;
+
+    m_deques.clear();
+    for (unsigned int i = 0; i < workerThreads + MAX_SUBMITTERS; i++)
+        m_deques.emplace_back(new JobDeque(DEQUE_CAPACITY));
+    m_dequeOwners.assign(m_deques.size(), std::thread::id());
+    m_dequeCount.store(workerThreads, std::memory_order_release);
+
+    m_running.store(true, std::memory_order_release);
+    for (unsigned int i = 0; i < workerThreads; i++)
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+void JobSystem::shutdown() {
+    if (!m_running.exchange(false))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+
+    //whatever is still queued never runs
+    for (const std::unique_ptr<JobDeque>& deque : m_deques) {
+        while (Job* job = deque->steal())
+            delete job;
+    }
+    m_queued.store(0);
+    std::lock_guard<std::mutex> lock(m_glMutex);
+    for (Job* job : m_glJobs)
+        delete job;
+    m_glJobs.clear();
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter* counter, JobCounter* after) {
+    if (counter)
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    submit(new Job{ std::move(job), counter, false }, after);
+}
+
+void JobSystem::runOnGlThread(std::function<void()> job, JobCounter* counter, JobCounter* after) {
+    if (counter)
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    submit(new Job{ std::move(job), counter, true }, after);
+}
+
+void JobSystem::submit(Job* job, JobCounter* after) {
+    if (after) {
+        //checked under the lock the last job of after releases dependents with, so it can't slip between
+        std::lock_guard<std::mutex> lock(after->m_mutex);
+        if (!after->done()) {
+            after->m_dependents.push_back(job);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void JobSystem::schedule(Job* job) {
+    if (job->glThread) {
+        std::lock_guard<std::mutex> lock(m_glMutex);
+        m_glJobs.push_back(job);
+        return;
+    }
+
+    JobDeque* deque = m_workers.empty() ? nullptr : threadDeque();
+    if (deque) {
+        m_queued.fetch_add(1);  //before the push, a worker deciding to sleep must see it
+        if (deque->push(job)) {
+            if (m_sleeping.load() > 0) {
+                {
+                    std::lock_guard<std::mutex> lock(m_sleepMutex);
+                }
+                m_wake.notify_one();
+            }
+            return;
+        }
+        m_queued.fetch_sub(1);
+    }
+    m_inlined.fetch_add(1, std::memory_order_relaxed);
+    execute(job);
+}
+
+void JobSystem::execute(Job* job) {
+    {
+        PROFILE_SCOPE("Job");
+        job->function();
+    }
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+    JobCounter* counter = job->counter;
+    delete job;
+    if (!counter)
+        return;
+
+    std::vector<Job*> dependents;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            dependents.swap(counter->m_dependents);
+    }
+    for (Job* dependent : dependents)
+        schedule(dependent);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    const bool glThread = onGlThread();
+    JobDeque* own = glThread || m_workers.empty() ? nullptr : threadDeque();
+    while (!counter.done()) {
+        Job* job = glThread ? popGlJob() : findJob(own);
+        if (job)
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+    //the job that finished the counter may still be inside its lock
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+uint32_t JobSystem::chunkSize(uint32_t count, uint32_t grain) const {
+    if (workerCount() == 0)
+        return std::max(count, 1u);
+    //4 chunks per thread, so one that is slow or starts late doesn't hold everyone up
+    const uint32_t chunks = threadCount() * 4;
+    return std::max(std::max((count + chunks - 1) / chunks, grain), 1u);
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body) {
+    if (count == 0)
+        return;
+    const uint32_t chunk = chunkSize(count, grain);
+    JobCounter counter;
+    for (uint32_t begin = chunk; begin < count; begin += chunk) {
+        const uint32_t end = std::min(count, begin + chunk);
+        run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    body(0, std::min(count, chunk));
+    wait(counter);
+}
+
+void JobSystem::pinGlThread(std::thread::id thread) {
+    m_glThread.store(thread, std::memory_order_relaxed);
+}
+
+void JobSystem::runGlJobs() {
+    //only what is queued now, jobs that queue more GL jobs don't keep the frame here
+    std::deque<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_glMutex);
+        jobs.swap(m_glJobs);
+    }
+    for (Job* job : jobs)
+        execute(job);
+}
+
+Job* JobSystem::popGlJob() {
+    std::lock_guard<std::mutex> lock(m_glMutex);
+    if (m_glJobs.empty())
+        return nullptr;
+    Job* job = m_glJobs.front();
+    m_glJobs.pop_front();
+    return job;
+}
+
+Job* JobSystem::findJob(JobDeque* own) {
+    if (own) {
+        if (Job* job = own->pop()) {
+            m_queued.fetch_sub(1);
+            return job;
+        }
+    }
+    if (m_queued.load(std::memory_order_relaxed) <= 0)
+        return nullptr;
+
+    const unsigned int count = m_dequeCount.load(std::memory_order_acquire);
+    if (count == 0)
+        return nullptr;
+    const unsigned int first = randomIndex() % count;
+    for (unsigned int i = 0; i < count; i++) {
+        JobDeque* victim = m_deques[(first + i) % count].get();
+        if (victim == own)
+            continue;
+        if (Job* job = victim->steal()) {
+            m_queued.fetch_sub(1);
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+JobSystem::JobDeque* JobSystem::threadDeque() {
+    if (s_cachedDeque.owner == m_id)
+        return s_cachedDeque.deque;
+
+    //first submission from this thread, or it last submitted to another JobSystem
+    std::lock_guard<std::mutex> lock(m_registerMutex);
+    const std::thread::id self = std::this_thread::get_id();
+    const unsigned int count = m_dequeCount.load(std::memory_order_relaxed);
+    unsigned int index = count;
+    for (unsigned int i = workerCount(); i < count; i++) {
+        if (m_dequeOwners[i] == self)
+            index = i;
+    }
+    if (index == count) {
+        if (count == m_deques.size())
+            return nullptr;     //out of submitter deques, the caller runs the job inline
+        m_dequeOwners[index] = self;
+        m_dequeCount.store(count + 1, std::memory_order_release);
+    }
+    s_cachedDeque = { m_id, m_deques[index].get() };
+    return s_cachedDeque.deque;
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+    JobDeque* own = m_deques[index].get();
+    s_cachedDeque = { m_id, own };
+    PROFILE_THREAD(("Worker " + std::to_string(index + 1)).c_str());
+
+    unsigned int idle = 0;
+    while (m_running.load(std::memory_order_acquire)) {
+        if (Job* job = findJob(own)) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+        //spin a little first, work often comes in bursts a frame apart
+        if (++idle < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping.fetch_add(1);
+        m_sleeps.fetch_add(1, std::memory_order_relaxed);
+        m_wake.wait(lock, [this]() { return m_queued.load() > 0 || !m_running.load(); });
+        m_sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+JobSystemStats JobSystem::stats() const {
+    JobSystemStats stats;
+    stats.executed = m_executed.load(std::memory_order_relaxed);
+    stats.stolen = m_stolen.load(std::memory_order_relaxed);
+    stats.inlined = m_inlined.load(std::memory_order_relaxed);
+    stats.sleeps = m_sleeps.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "WorkStealingDeque.h"
+
+struct Job;
+
+/*
+Job Counter
+    Counts a group's unfinished jobs. wait() on it to join the group, or pass it as another
+    job's dependency to run that job once the group is done. A counter may be reused as soon
+    as it is done.
+*/
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    //wait() rather than poll this before destroying the counter, the last job may still be releasing dependents
+    bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<unsigned int> m_pending{ 0 };
+    std::mutex m_mutex;             //guards m_dependents
+    std::vector<Job*> m_dependents; //run when m_pending drops to 0
+};
+
+struct JobSystemStats {
+    uint64_t executed = 0;
+    uint64_t stolen = 0;        //taken from another thread's deque
+    uint64_t inlined = 0;       //run right away by the submitting thread, no workers or its deque was full
+    uint64_t sleeps = 0;        //workers going idle on the condition variable
+};
+
+/*
+Job System
+    Work stealing scheduler. Every worker, and every other thread that submits jobs, has its
+    own WorkStealingDeque: run() pushes onto the caller's deque, a thread works its own deque
+    newest first and steals the oldest job of a random other one when it runs dry. Idle
+    workers spin briefly, then sleep until something is submitted.
+
+    Waiting never blocks: wait() runs other jobs until the counter is done, so a job may
+    split its work into more jobs and wait for them.
+
+    The GL thread can be pinned. It never takes general jobs, the workers have those, and
+    instead is the only thread to run jobs submitted with runOnGlThread(), the ones that
+    need the context. It runs them from runGlJobs() once a frame and while it wait()s.
+
+    With no worker threads every general job simply runs inline in run(), in submission order.
+*/
+class JobSystem {
+public:
+    JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem();
+
+    //workers usually hardware_concurrency() - 1, the submitting thread counts as one
+    void init(unsigned int workerThreads);
+    void shutdown();
+
+    //job starts once after is done, and counter is done once job has finished. both optional
+    void run(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+    void runOnGlThread(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* after = nullptr);
+    void wait(JobCounter& counter);
+
+    //splits [0, count) into chunks of at least grain items, a few per thread to even out the
+    //load, calls body(begin, end) for each and waits for all of them. the caller does the first
+    void parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body);
+    uint32_t chunkSize(uint32_t count, uint32_t grain) const;   //what parallelFor will use
+
+    void pinGlThread(std::thread::id thread);
+    void runGlJobs();   //GL thread only
+
+    unsigned int workerCount() const { return (unsigned int)m_workers.size(); }
+    unsigned int threadCount() const { return workerCount() + 1; }
+    JobSystemStats stats() const;
+
+private:
+    typedef WorkStealingDeque<Job> JobDeque;
+
+    static const uint32_t DEQUE_CAPACITY = 4096;
+    static const unsigned int MAX_SUBMITTERS = 8;   //deques for threads other than the workers
+
+    void submit(Job* job, JobCounter* after);
+    void schedule(Job* job);
+    void execute(Job* job);
+    Job* findJob(JobDeque* own);
+    Job* popGlJob();
+    JobDeque* threadDeque();
+    void workerLoop(unsigned int index);
+    bool onGlThread() const { return m_glThread.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+    uint64_t m_id;      //tells this instance's deques apart in the thread_local cache, new every init()
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<JobDeque>> m_deques;    //workers first, then submitters, never resized while running
+    std::vector<std::thread::id> m_dequeOwners;
+    std::atomic<unsigned int> m_dequeCount{ 0 };
+    std::mutex m_registerMutex;     //guards claiming a submitter deque
+
+    std::atomic<bool> m_running{ false };
+    std::atomic<int> m_queued{ 0 };         //general jobs sitting in deques
+    std::atomic<int> m_sleeping{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+
+    std::atomic<std::thread::id> m_glThread{ std::thread::id() };
+    std::mutex m_glMutex;           //guards m_glJobs
+    std::deque<Job*> m_glJobs;
+
+    std::atomic<uint64_t> m_executed{ 0 };
+    std::atomic<uint64_t> m_stolen{ 0 };
+    std::atomic<uint64_t> m_inlined{ 0 };
+    std::atomic<uint64_t> m_sleeps{ 0 };
+};
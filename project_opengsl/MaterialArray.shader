@@ -0,0 +1,38 @@
+#shader vertex
+#version 450 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in uint materialId; //per instance, picked by the draw's baseInstance
+
+out vec2 v_TexCoord;
+flat out uint v_MaterialId;
+
+void main() {
+   gl_Position = position;
+   v_TexCoord = texCoord;
+   v_MaterialId = materialId;
+};
+
+#shader fragment
+#version 450 core
+
+struct Material {
+   uvec2 texture; //unused without bindless textures
+   uint layer;
+   uint pad;
+};
+
+layout(std430, binding = 0) readonly buffer Materials {
+   Material materials[];
+};
+
+layout(binding = 0) uniform sampler2DArray u_Textures;
+
+in vec2 v_TexCoord;
+flat in uint v_MaterialId;
+
+layout(location = 0) out vec4 color;
+void main() {
+   color = texture(u_Textures, vec3(v_TexCoord, float(materials[v_MaterialId].layer)));
+};
@@ -0,0 +1,38 @@
+#shader vertex
+#version 450 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in uint materialId; //per instance, picked by the draw's baseInstance
+
+out vec2 v_TexCoord;
+flat out uint v_MaterialId;
+
+void main() {
+   gl_Position = position;
+   v_TexCoord = texCoord;
+   v_MaterialId = materialId;
+};
+
+#shader fragment
+#version 450 core
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require //the handle differs between draws, so it isn't dynamically uniform
+
+struct Material {
+   uvec2 texture; //resident bindless handle
+   uint layer;
+   uint pad;
+};
+
+layout(std430, binding = 0) readonly buffer Materials {
+   Material materials[];
+};
+
+in vec2 v_TexCoord;
+flat in uint v_MaterialId;
+
+layout(location = 0) out vec4 color;
+void main() {
+   color = texture(sampler2D(materials[v_MaterialId].texture), v_TexCoord);
+};
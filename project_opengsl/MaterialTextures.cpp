@@ -0,0 +1,133 @@
+#include "MaterialTextures.h"
+#include <GL/glew.h>
+#include <iostream>
+
+static int mipLevels(int width, int height) {
+    int levels = 1;
+    while ((width | height) >> levels)
+        levels++;
+    return levels;
+}
+
+MaterialTextures::~MaterialTextures() {
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        glMakeTextureHandleNonResidentARB(m_materials[i].handle);
+        glDeleteTextures(1, &m_textures[i]);
+    }
+    glDeleteTextures(1, &m_textureArray);
+    glDeleteBuffers(1, &m_materialBuffer);
+    glDeleteBuffers(1, &m_materialIdBuffer);
+}
+
+bool MaterialTextures::init(int width, int height, unsigned int maxMaterials, bool preferBindless) {
+    m_width = width;
+    m_height = height;
+    m_maxMaterials = maxMaterials;
+    const bool bindless = GLEW_ARB_bindless_texture && GLEW_NV_gpu_shader5;
+    m_mode = (preferBindless && bindless) ? MaterialTextureMode::Bindless : MaterialTextureMode::TextureArray;
+
+    if (m_mode == MaterialTextureMode::TextureArray) {
+        int maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        if (maxMaterials > (unsigned int)maxLayers) {
+            std::cout << "Texture arrays are limited to " << maxLayers << " layers, asked for " << maxMaterials << std::endl;
+            m_maxMaterials = maxMaterials = (unsigned int)maxLayers;
+        }
+
+        glGenTextures(1, &m_textureArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevels(width, height), GL_RGBA8, width, height, maxMaterials);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    glGenBuffers(1, &m_materialBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxMaterials * sizeof(Material), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    std::vector<unsigned int> ids(maxMaterials);
+    for (unsigned int i = 0; i < maxMaterials; i++)
+        ids[i] = i;
+    glGenBuffers(1, &m_materialIdBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_materialIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(unsigned int), ids.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::cout << "Material textures: " << (m_mode == MaterialTextureMode::Bindless ? "bindless" : "texture array") << std::endl;
+    return true;
+}
+
+unsigned int MaterialTextures::addMaterial(const unsigned char* rgba, int width, int height) {
+    if (m_materials.size() >= m_maxMaterials)
+        return INVALID_MATERIAL;
+
+    Material material = {};
+    material.layer = (uint32_t)m_materials.size();
+
+    if (m_mode == MaterialTextureMode::Bindless) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, mipLevels(width, height), GL_RGBA8, width, height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        //sampler state is baked into the handle, so it has to be set before this
+        material.handle = glGetTextureHandleARB(texture);
+        glMakeTextureHandleResidentARB(material.handle);
+        m_textures.push_back(texture);
+    }
+    else {
+        if (width != m_width || height != m_height) {
+            std::cout << "Material texture is " << width << "x" << height << ", the texture array needs " << m_width << "x" << m_height << std::endl;
+            return INVALID_MATERIAL;
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, material.layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        m_mipsDirty = true;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_materials.size() * sizeof(Material), sizeof(Material), &material);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_materials.push_back(material);
+    return material.layer;
+}
+
+void MaterialTextures::finalize() {
+    //glGenerateMipmap on an array rebuilds every layer, so once per batch rather than per material
+    if (!m_mipsDirty)
+        return;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    m_mipsDirty = false;
+}
+
+void MaterialTextures::attachMaterialIds(unsigned int vertexArray) const {
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, m_materialIdBuffer);
+    glEnableVertexAttribArray(MATERIAL_ID_ATTRIBUTE);
+    glVertexAttribIPointer(MATERIAL_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(unsigned int), 0);
+    glVertexAttribDivisor(MATERIAL_ID_ATTRIBUTE, 1); //one id per instance, offset by baseInstance
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MaterialTextures::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, m_materialBuffer);
+    if (m_mode == MaterialTextureMode::TextureArray) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+    }
+}
+
+const char* MaterialTextures::shaderPath() const {
+    return m_mode == MaterialTextureMode::Bindless ? "MaterialBindless.shader" : "MaterialArray.shader";
+}
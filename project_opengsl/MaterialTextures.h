@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+Material Textures
+    Every material gets an entry in a shader storage buffer. Shaders index it with the
+    material id (a per-instance attribute, fed by baseInstance), so draws that only differ
+    in texture no longer need a glBindTexture between them and can go into one multi-draw.
+
+    Bindless (ARB_bindless_texture): each material keeps its own texture, its handle is
+        made resident once and stored in the buffer. ARB_bindless_texture alone only allows
+        sampling through a dynamically uniform handle, and the fragments of one wave can
+        belong to different draws of a multi-draw, so this mode also needs NV_gpu_shader5,
+        which lifts that restriction.
+    TextureArray (fallback): every material is a layer of one GL_TEXTURE_2D_ARRAY, so all
+        material textures must have the size passed to init(). Layers are uploaded without
+        their mips, finalize() builds those for the whole array at once.
+*/
+
+enum class MaterialTextureMode {
+    Bindless,
+    TextureArray
+};
+
+static const unsigned int MATERIAL_BUFFER_BINDING = 0;    //layout(std430, binding = 0) in the material shaders
+static const unsigned int MATERIAL_ID_ATTRIBUTE = 2;      //layout(location = 2) in uint materialId
+static const unsigned int INVALID_MATERIAL = 0xFFFFFFFF;
+
+class MaterialTextures {
+public:
+    MaterialTextures() = default;
+    MaterialTextures(const MaterialTextures&) = delete;
+    MaterialTextures& operator=(const MaterialTextures&) = delete;
+    ~MaterialTextures();
+
+    bool init(int width, int height, unsigned int maxMaterials, bool preferBindless = true);
+
+    //rgba: width * height * 4 bytes. Returns INVALID_MATERIAL when full or the size doesn't fit the array
+    unsigned int addMaterial(const unsigned char* rgba, int width, int height);
+    //after a batch of addMaterial(), before drawing with them
+    void finalize();
+
+    //per-instance material ids 0..maxMaterials-1, so a draw's baseInstance picks its material
+    void attachMaterialIds(unsigned int vertexArray) const;
+
+    void bind() const;                                  //material buffer, plus the array texture in fallback mode
+    const char* shaderPath() const;                     //the shader variant matching mode()
+
+    MaterialTextureMode mode() const { return m_mode; }
+    unsigned int materialCount() const { return (unsigned int)m_materials.size(); }
+
+private:
+    struct Material { //std430, 16 bytes
+        uint64_t handle;
+        uint32_t layer;
+        uint32_t pad;
+    };
+
+    MaterialTextureMode m_mode = MaterialTextureMode::TextureArray;
+    int m_width = 0;
+    int m_height = 0;
+    unsigned int m_maxMaterials = 0;
+    unsigned int m_materialBuffer = 0;
+    unsigned int m_materialIdBuffer = 0;
+    unsigned int m_textureArray = 0;
+    std::vector<unsigned int> m_textures; //bindless mode only
+    std::vector<Material> m_materials;
+    bool m_mipsDirty = false; //texture array mode, layers added since the last finalize()
+};
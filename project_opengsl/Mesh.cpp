@@ -0,0 +1,67 @@
+#include "Mesh.h"
+#include <GL/glew.h>
+#include <iostream>
+
+Mesh::~Mesh() {
+    glDeleteVertexArrays(1, &m_vertexArray);
+    glDeleteVertexArrays(1, &m_positionVertexArray);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_positionBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+bool Mesh::create(const float* vertices, unsigned int vertexCount, const std::vector<VertexAttribute>& layout,
+                  const unsigned int* indices, unsigned int indexCount, bool positionStream) {
+    unsigned int stride = 0;
+    unsigned int positionOffset = 0;
+    unsigned int positionComponents = 0;
+    for (const VertexAttribute& attribute : layout) {
+        if (attribute.location == 0) {
+            positionOffset = stride;
+            positionComponents = attribute.components;
+        }
+        stride += attribute.components;
+    }
+    if (positionComponents == 0) {
+        std::cout << "Mesh layout has no position at location 0" << std::endl;
+        return false;
+    }
+
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * stride * sizeof(float), vertices, GL_STATIC_DRAW);
+    unsigned int offset = 0;
+    for (const VertexAttribute& attribute : layout) {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, stride * sizeof(float), (const void*)(offset * sizeof(float)));
+        offset += attribute.components;
+    }
+    glGenBuffers(1, &m_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+    m_indexCount = indexCount;
+
+    //nothing to gain when the position is all there is
+    if (positionStream && positionComponents != stride) {
+        std::vector<float> positions(vertexCount * positionComponents);
+        for (unsigned int v = 0; v < vertexCount; v++) {
+            for (unsigned int c = 0; c < positionComponents; c++)
+                positions[v * positionComponents + c] = vertices[v * stride + positionOffset + c];
+        }
+
+        glGenVertexArrays(1, &m_positionVertexArray);
+        glBindVertexArray(m_positionVertexArray);
+        glGenBuffers(1, &m_positionBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, positionComponents, GL_FLOAT, GL_FALSE, positionComponents * sizeof(float), 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+
+struct VertexAttribute {
+    unsigned int location;
+    unsigned int components;    //floats
+};
+
+/*
+Mesh
+    Interleaved float vertices and 32-bit indices behind one vertex array, with the attributes
+    in layout order. Location 0 is the position. With a position stream the positions are also
+    copied into their own tightly packed buffer, behind a second vertex array that shares the
+    index buffer, so depth-only passes fetch 12 or 16 bytes per vertex instead of the full vertex.
+*/
+class Mesh {
+public:
+    Mesh() = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    ~Mesh();
+
+    bool create(const float* vertices, unsigned int vertexCount, const std::vector<VertexAttribute>& layout,
+                const unsigned int* indices, unsigned int indexCount, bool positionStream = true);
+
+    unsigned int vertexArray() const { return m_vertexArray; }
+    unsigned int positionVertexArray() const { return m_positionVertexArray ? m_positionVertexArray : m_vertexArray; }
+    unsigned int indexCount() const { return m_indexCount; }
+
+private:
+    unsigned int m_vertexArray = 0;
+    unsigned int m_positionVertexArray = 0;
+    unsigned int m_vertexBuffer = 0;
+    unsigned int m_positionBuffer = 0;
+    unsigned int m_indexBuffer = 0;
+    unsigned int m_indexCount = 0;
+};
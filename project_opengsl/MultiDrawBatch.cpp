@@ -0,0 +1,30 @@
+#include "MultiDrawBatch.h"
+#include <GL/glew.h>
+
+MultiDrawBatch::~MultiDrawBatch() {
+    glDeleteBuffers(1, &m_indirectBuffer);
+}
+
+void MultiDrawBatch::add(unsigned int indexCount, unsigned int firstIndex, int baseVertex, unsigned int baseInstance) {
+    m_commands.push_back({ indexCount, 1, firstIndex, baseVertex, baseInstance });
+}
+
+void MultiDrawBatch::flush() {
+    m_stats.submitted = (unsigned int)m_commands.size();
+    m_stats.drawCalls = 0;
+    if (m_commands.empty())
+        return;
+
+    if (m_indirectBuffer == 0)
+        glGenBuffers(1, &m_indirectBuffer);
+
+    //orphan the previous frame's commands instead of waiting for the GPU to finish with them
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)m_commands.size(), 0);
+    m_stats.drawCalls = 1;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_commands.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance; //material id when used with MaterialTextures
+};
+
+struct MultiDrawStats {
+    unsigned int submitted = 0; //draws added since the last flush
+    unsigned int drawCalls = 0; //GL calls that took to issue
+};
+
+/*
+Multi Draw Batch
+    Collects indexed draws that share a program and vertex array and issues them with one
+    glMultiDrawElementsIndirect. Per-draw differences (material, transform) have to come
+    from baseInstance or gl_DrawID, not from state changes.
+*/
+class MultiDrawBatch {
+public:
+    MultiDrawBatch() = default;
+    MultiDrawBatch(const MultiDrawBatch&) = delete;
+    MultiDrawBatch& operator=(const MultiDrawBatch&) = delete;
+    ~MultiDrawBatch();
+
+    void add(unsigned int indexCount, unsigned int firstIndex, int baseVertex, unsigned int baseInstance);
+    void flush(); //the program and vertex array must already be bound
+
+    const MultiDrawStats& stats() const { return m_stats; }
+
+private:
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    unsigned int m_indirectBuffer = 0;
+    MultiDrawStats m_stats;
+};
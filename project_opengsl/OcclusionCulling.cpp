@@ -0,0 +1,337 @@
+#include "OcclusionCulling.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define OCCLUSION_SSE 1
+    #include <emmintrin.h>
+#else
+    #define OCCLUSION_SSE 0
+#endif
+
+//outward faces, counter-clockwise from outside. Corner i has max x if (i & 1), max y if (i & 2), max z if (i & 4)
+static const uint32_t BOX_QUADS[24] = {
+    0, 4, 6, 2,     //-x
+    1, 3, 7, 5,     //+x
+    0, 1, 5, 4,     //-y
+    2, 6, 7, 3,     //+y
+    0, 2, 3, 1,     //-z
+    4, 5, 7, 6      //+z
+};
+
+static void transformPoint(const float* m, float x, float y, float z, float* clip) {
+    clip[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+    clip[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+    clip[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+    clip[3] = m[3] * x + m[7] * y + m[11] * z + m[15];
+}
+
+static Vec3 boxCorner(const Aabb& box, int i) {
+    return { (i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z };
+}
+
+bool OcclusionRasterizer::init(unsigned int width, unsigned int height) {
+    if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0) {
+        std::cout << "OcclusionRasterizer needs a size in multiples of " << TILE_WIDTH << "x" << TILE_HEIGHT << ", got " << width << "x" << height << std::endl;
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_tilesX = width / TILE_WIDTH;
+    m_tilesY = height / TILE_HEIGHT;
+    m_depth.assign(width * height, 1.0f);
+    m_bins.resize(m_tilesX * m_tilesY);
+    return true;
+}
+
+void OcclusionRasterizer::setJobSystem(JobSystem* jobs) {
+    m_jobs = jobs;
+}
+
+void OcclusionRasterizer::beginFrame(const float* viewProjection) {
+    std::copy(viewProjection, viewProjection + 16, m_viewProjection);
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    m_polygons.clear();
+    for (std::vector<uint32_t>& bin : m_bins)
+        bin.clear();
+    m_stats = OcclusionStats();
+}
+
+void OcclusionRasterizer::addOccluder(const Vec3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_clipVertices.resize(vertexCount * 4);
+    for (uint32_t i = 0; i < vertexCount; i++)
+        transformPoint(m_viewProjection, vertices[i].x, vertices[i].y, vertices[i].z, &m_clipVertices[i * 4]);
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+        const float* triangle[3] = { &m_clipVertices[indices[i] * 4], &m_clipVertices[indices[i + 1] * 4], &m_clipVertices[indices[i + 2] * 4] };
+        addPolygon(triangle, 3);
+    }
+    m_stats.occluderTriangles += indexCount / 3;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void OcclusionRasterizer::addOccluderBox(const Aabb& box) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_clipVertices.resize(8 * 4);
+    for (int i = 0; i < 8; i++) {
+        Vec3 corner = boxCorner(box, i);
+        transformPoint(m_viewProjection, corner.x, corner.y, corner.z, &m_clipVertices[i * 4]);
+    }
+    for (int face = 0; face < 6; face++) {
+        const uint32_t* quad = &BOX_QUADS[face * 4];
+        const float* vertices[4] = { &m_clipVertices[quad[0] * 4], &m_clipVertices[quad[1] * 4], &m_clipVertices[quad[2] * 4], &m_clipVertices[quad[3] * 4] };
+        addPolygon(vertices, 4);
+    }
+    m_stats.occluderTriangles += 12;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+//clips against the near plane (z >= -w), the other planes are left to the tile bounds
+void OcclusionRasterizer::addPolygon(const float* const* vertices, int count) {
+    float distance[4];
+    int inside = 0;
+    for (int i = 0; i < count; i++) {
+        distance[i] = vertices[i][2] + vertices[i][3];
+        inside += distance[i] >= 0.0f ? 1 : 0;
+    }
+    if (inside == count) {
+        setupPolygon(vertices, count);
+        return;
+    }
+    if (inside == 0)
+        return;
+
+    //cutting a corner off a quad leaves 5 vertices, split into a quad and a triangle
+    float clipped[5][4];
+    int clippedCount = 0;
+    for (int i = 0; i < count; i++) {
+        int j = (i + 1) % count;
+        if (distance[i] >= 0.0f) {
+            std::copy(vertices[i], vertices[i] + 4, clipped[clippedCount++]);
+        }
+        if ((distance[i] >= 0.0f) != (distance[j] >= 0.0f)) {
+            float t = distance[i] / (distance[i] - distance[j]);
+            for (int k = 0; k < 4; k++)
+                clipped[clippedCount][k] = vertices[i][k] + t * (vertices[j][k] - vertices[i][k]);
+            clippedCount++;
+        }
+    }
+    const float* polygon[4] = { clipped[0], clipped[1], clipped[2], clipped[3] };
+    setupPolygon(polygon, std::min(clippedCount, 4));
+    if (clippedCount == 5) {
+        const float* rest[3] = { clipped[0], clipped[3], clipped[4] };
+        setupPolygon(rest, 3);
+    }
+}
+
+void OcclusionRasterizer::setupPolygon(const float* const* vertices, int count) {
+    ScreenPolygon polygon;
+    for (int i = 0; i < 4; i++) {
+        const float* clip = vertices[i < count ? i : 0];
+        float inverseW = 1.0f / clip[3];
+        polygon.x[i] = (clip[0] * inverseW * 0.5f + 0.5f) * m_width;
+        polygon.y[i] = (clip[1] * inverseW * 0.5f + 0.5f) * m_height;
+        polygon.z[i] = clip[2] * inverseW;
+    }
+
+    //back facing or degenerate, twice the signed area
+    float area = 0.0f;
+    for (int i = 0; i < 4; i++)
+        area += polygon.x[i] * polygon.y[(i + 1) % 4] - polygon.x[(i + 1) % 4] * polygon.y[i];
+    if (!(area > 0.0f))
+        return;
+
+    float minX = polygon.x[0], maxX = polygon.x[0], minY = polygon.y[0], maxY = polygon.y[0];
+    for (int i = 1; i < 4; i++) {
+        minX = std::min(minX, polygon.x[i]); maxX = std::max(maxX, polygon.x[i]);
+        minY = std::min(minY, polygon.y[i]); maxY = std::max(maxY, polygon.y[i]);
+    }
+    if (maxX <= 0.0f || maxY <= 0.0f || minX >= m_width || minY >= m_height)
+        return;
+
+    const uint32_t index = (uint32_t)m_polygons.size();
+    m_polygons.push_back(polygon);
+    m_stats.rasterizedTriangles += count - 2;
+
+    int tileX0 = std::max(0, (int)minX / (int)TILE_WIDTH);
+    int tileX1 = std::min((int)m_tilesX - 1, (int)maxX / (int)TILE_WIDTH);
+    int tileY0 = std::max(0, (int)minY / (int)TILE_HEIGHT);
+    int tileY1 = std::min((int)m_tilesY - 1, (int)maxY / (int)TILE_HEIGHT);
+    for (int ty = tileY0; ty <= tileY1; ty++) {
+        for (int tx = tileX0; tx <= tileX1; tx++)
+            m_bins[ty * m_tilesX + tx].push_back(index);
+    }
+}
+
+void OcclusionRasterizer::rasterize() {
+    PROFILE_SCOPE("Occlusion raster");
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const unsigned int tiles = m_tilesX * m_tilesY;
+    if (!m_jobs) {
+        for (unsigned int tile = 0; tile < tiles; tile++)
+            rasterizeTile(tile);
+    }
+    else {
+        //tiles don't share pixels, so no synchronization beyond the wait. one tile per job at
+        //least, how many triangles land in a tile varies too much to batch them blindly
+        m_jobs->parallelFor(tiles, 1, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t tile = begin; tile < end; tile++)
+                rasterizeTile(tile);
+        });
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void OcclusionRasterizer::rasterizeTile(unsigned int tile) {
+    const int tileX0 = (tile % m_tilesX) * TILE_WIDTH;
+    const int tileY0 = (tile / m_tilesX) * TILE_HEIGHT;
+
+    for (uint32_t index : m_bins[tile]) {
+        const ScreenPolygon& p = m_polygons[index];
+
+        //edge i runs from vertex i to i + 1 and is >= 0 on the inside, a triangle's repeated vertex
+        //makes a 4th edge that is 0 everywhere. Pushing each edge in by half a pixel's extent only
+        //accepts pixels the polygon covers completely
+        float edgeA[4], edgeB[4], edgeC[4];
+        for (int i = 0; i < 4; i++) {
+            int j = (i + 1) % 4;
+            edgeA[i] = p.y[i] - p.y[j];
+            edgeB[i] = p.x[j] - p.x[i];
+            edgeC[i] = -(edgeA[i] * p.x[i] + edgeB[i] * p.y[i]) - 0.5f * (std::fabs(edgeA[i]) + std::fabs(edgeB[i]));
+        }
+
+        //depth plane through the larger half of the quad, plus the most it can rise within half a
+        //pixel so every write is the pixel's farthest depth
+        const float area012 = (p.x[1] - p.x[0]) * (p.y[2] - p.y[0]) - (p.x[2] - p.x[0]) * (p.y[1] - p.y[0]);
+        const float area023 = (p.x[2] - p.x[0]) * (p.y[3] - p.y[0]) - (p.x[3] - p.x[0]) * (p.y[2] - p.y[0]);
+        const int b = area012 >= area023 ? 1 : 2;
+        const int c = b + 1;
+        const float area = std::max(area012, area023);
+        const float dzdx = ((p.z[b] - p.z[0]) * (p.y[c] - p.y[0]) - (p.z[c] - p.z[0]) * (p.y[b] - p.y[0])) / area;
+        const float dzdy = ((p.x[b] - p.x[0]) * (p.z[c] - p.z[0]) - (p.x[c] - p.x[0]) * (p.z[b] - p.z[0])) / area;
+        const float zC = p.z[0] - dzdx * p.x[0] - dzdy * p.y[0] + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+        const float minX = std::min(std::min(p.x[0], p.x[1]), std::min(p.x[2], p.x[3]));
+        const float maxX = std::max(std::max(p.x[0], p.x[1]), std::max(p.x[2], p.x[3]));
+        const float minY = std::min(std::min(p.y[0], p.y[1]), std::min(p.y[2], p.y[3]));
+        const float maxY = std::max(std::max(p.y[0], p.y[1]), std::max(p.y[2], p.y[3]));
+        //x starts on a multiple of 4, tiles are multiples of 4 wide so the last group stays inside
+        const int x0 = std::max(tileX0, (int)std::floor(minX)) & ~3;
+        const int x1 = std::min(tileX0 + (int)TILE_WIDTH, (int)std::ceil(maxX));
+        const int y0 = std::max(tileY0, (int)std::floor(minY));
+        const int y1 = std::min(tileY0 + (int)TILE_HEIGHT, (int)std::ceil(maxY));
+
+        for (int y = y0; y < y1; y++) {
+            const float py = y + 0.5f;
+            float* row = &m_depth[y * m_width];
+#if OCCLUSION_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+            const __m128 rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+            const __m128 rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+            const __m128 rowE3 = _mm_set1_ps(edgeB[3] * py + edgeC[3]);
+            const __m128 rowZ = _mm_set1_ps(dzdy * py + zC);
+            for (int x = x0; x < x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), rowE0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), rowE1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), rowE2);
+                __m128 e3 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[3]), px), rowE3);
+                __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                         _mm_and_ps(_mm_cmpge_ps(e2, zero), _mm_cmpge_ps(e3, zero)));
+                if (_mm_movemask_ps(mask) == 0)
+                    continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), rowZ);
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearer), _mm_andnot_ps(mask, old)));
+            }
+#else
+            for (int x = x0; x < x1; x++) {
+                const float px = x + 0.5f;
+                bool covered = true;
+                for (int i = 0; i < 4; i++)
+                    covered = covered && edgeA[i] * px + edgeB[i] * py + edgeC[i] >= 0.0f;
+                if (covered)
+                    row[x] = std::min(row[x], dzdx * px + dzdy * py + zC);
+            }
+#endif
+        }
+    }
+}
+
+bool OcclusionRasterizer::isVisible(const Aabb& box, uint32_t triangles) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_stats.occludeesTested++;
+    m_stats.trianglesTested += triangles;
+
+    float minX = (float)m_width, maxX = 0.0f, minY = (float)m_height, maxY = 0.0f, minZ = 1.0f;
+    bool visible = false;
+    bool crossesNear = false;
+    for (int i = 0; i < 8; i++) {
+        Vec3 corner = boxCorner(box, i);
+        float clip[4];
+        transformPoint(m_viewProjection, corner.x, corner.y, corner.z, clip);
+        //a corner in front of the near plane can't be projected, assume the worst
+        if (clip[2] < -clip[3] || clip[3] <= 0.0f) {
+            crossesNear = true;
+            break;
+        }
+        float inverseW = 1.0f / clip[3];
+        float x = (clip[0] * inverseW * 0.5f + 0.5f) * m_width;
+        float y = (clip[1] * inverseW * 0.5f + 0.5f) * m_height;
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip[2] * inverseW);
+    }
+
+    if (crossesNear) {
+        visible = true;
+    }
+    else {
+        //every pixel the box touches, even partially
+        const int x0 = std::max(0, (int)std::floor(minX));
+        const int x1 = std::min((int)m_width, (int)std::ceil(maxX));
+        const int y0 = std::max(0, (int)std::floor(minY));
+        const int y1 = std::min((int)m_height, (int)std::ceil(maxY));
+        for (int y = y0; y < y1 && !visible; y++) {
+            const float* row = &m_depth[y * m_width];
+            int x = x0;
+#if OCCLUSION_SSE
+            const __m128 nearest = _mm_set1_ps(minZ);
+            for (; x + 4 <= x1; x += 4) {
+                if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearest)) != 0) {
+                    visible = true;
+                    break;
+                }
+            }
+#endif
+            for (; x < x1 && !visible; x++)
+                visible = row[x] >= minZ;
+        }
+    }
+
+    if (!visible) {
+        m_stats.occludeesCulled++;
+        m_stats.trianglesCulled += triangles;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.testMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    return visible;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Geometry.h"
+
+class JobSystem;
+
+struct OcclusionStats {
+    uint32_t occluderTriangles = 0;     //submitted with addOccluder()
+    uint32_t rasterizedTriangles = 0;   //left after near clipping and back-face culling
+    uint32_t occludeesTested = 0;
+    uint32_t occludeesCulled = 0;
+    uint32_t trianglesTested = 0;       //what isVisible()'s callers would have drawn without occlusion culling
+    uint32_t trianglesCulled = 0;
+    double rasterMilliseconds = 0.0;
+    double testMilliseconds = 0.0;
+};
+
+/*
+Occlusion Rasterizer
+    A small CPU depth buffer (256x128 by default) that big occluders are rasterized into, so
+    objects hidden behind them are rejected before they reach GL. Triangles are binned into
+    64x32 tiles that jobs rasterize independently, 4 pixels at a time with SSE.
+
+    Everything errs on the side of visible: occluders only write pixels they cover completely,
+    with the farthest depth inside each pixel, and occludees are tested with their nearest depth
+    over every pixel their projected box touches. A pixel split between two triangles is covered
+    by neither, so addOccluderBox() rasterizes each face as one quad and leaves no crack along
+    its diagonal; meshes from addOccluder() keep theirs.
+*/
+class OcclusionRasterizer {
+public:
+    static const unsigned int TILE_WIDTH = 64;
+    static const unsigned int TILE_HEIGHT = 32;
+
+    //width must be a multiple of TILE_WIDTH and height of TILE_HEIGHT
+    bool init(unsigned int width = 256, unsigned int height = 128);
+    void setJobSystem(JobSystem* jobs);     //nullptr rasterizes on the calling thread only
+
+    //clears the depth buffer, viewProjection is column major
+    void beginFrame(const float* viewProjection);
+
+    //world-space triangles, counter-clockwise in front like GL's default
+    void addOccluder(const Vec3* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+    void addOccluderBox(const Aabb& box);
+
+    void rasterize();
+
+    //false only when the box is certainly hidden. triangles is just counted in stats()
+    bool isVisible(const Aabb& box, uint32_t triangles = 0);
+
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+    const float* depth() const { return m_depth.data(); }   //NDC z, bottom row first
+    const OcclusionStats& stats() const { return m_stats; }
+
+private:
+    //a convex quad, a triangle repeats its first vertex
+    struct ScreenPolygon {
+        float x[4], y[4], z[4];
+    };
+
+    //clip-space vertices, 4 floats each
+    void addPolygon(const float* const* vertices, int count);
+    void setupPolygon(const float* const* vertices, int count);
+    void rasterizeTile(unsigned int tile);
+
+    unsigned int m_width = 0;
+    unsigned int m_height = 0;
+    unsigned int m_tilesX = 0;
+    unsigned int m_tilesY = 0;
+    JobSystem* m_jobs = nullptr;
+    float m_viewProjection[16];
+    std::vector<float> m_depth;
+    std::vector<float> m_clipVertices;      //scratch, 4 floats per vertex
+    std::vector<ScreenPolygon> m_polygons;
+    std::vector<std::vector<uint32_t>> m_bins;
+    OcclusionStats m_stats;
+};
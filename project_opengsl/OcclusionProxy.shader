@@ -0,0 +1,19 @@
+#shader vertex
+#version 420 core
+
+layout(location = 0) in vec4 position; //unit cube corner
+
+uniform vec3 u_BoxMin;
+uniform vec3 u_BoxMax;
+
+void main() {
+   gl_Position = viewProjection * vec4(mix(u_BoxMin, u_BoxMax, position.xyz), 1.0);
+};
+
+#shader fragment
+#version 420 core
+
+layout(location = 0) out vec4 color; //masked off, only the depth test matters
+void main() {
+   color = vec4(1.0);
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "OcclusionQueries.h"
+#include <GL/glew.h>
+#include <iostream>
+
+//corner i has x = 1 if (i & 1), y = 1 if (i & 2), z = 1 if (i & 4)
+static const float CUBE_CORNERS[8 * 3] = {
+    0, 0, 0,  1, 0, 0,  0, 1, 0,  1, 1, 0,
+    0, 0, 1,  1, 0, 1,  0, 1, 1,  1, 1, 1
+};
+
+static const unsigned int CUBE_INDICES[36] = {
+    0, 4, 6, 0, 6, 2,
+    1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,
+    2, 6, 7, 2, 7, 3,
+    0, 2, 3, 0, 3, 1,
+    4, 5, 7, 4, 7, 6
+};
+
+OcclusionQueries::~OcclusionQueries() {
+    for (const PendingQuery& pending : m_pending)
+        m_freeQueries.push_back(pending.query);
+    if (!m_freeQueries.empty())
+        glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+    glDeleteBuffers(2, m_buffers);
+    glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+bool OcclusionQueries::init(unsigned int proxyProgram) {
+    m_program = proxyProgram;
+    m_boxMinLocation = glGetUniformLocation(proxyProgram, "u_BoxMin");
+    m_boxMaxLocation = glGetUniformLocation(proxyProgram, "u_BoxMax");
+    if (m_boxMinLocation == -1 || m_boxMaxLocation == -1) {
+        std::cout << "OcclusionQueries needs u_BoxMin and u_BoxMax in the proxy program" << std::endl;
+        return false;
+    }
+
+    //the conservative target lets the GPU answer from coarse depth, it may say visible when it isn't
+    m_target = (GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility) ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+    glGenBuffers(2, m_buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_CORNERS), CUBE_CORNERS, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(CUBE_INDICES), CUBE_INDICES, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    return true;
+}
+
+uint32_t OcclusionQueries::addObject(const Aabb& bounds) {
+    m_bounds.push_back(bounds);
+    m_visible.push_back(1); //draw it until a query says otherwise
+    return (uint32_t)m_bounds.size() - 1;
+}
+
+void OcclusionQueries::setBounds(uint32_t object, const Aabb& bounds) {
+    m_bounds[object] = bounds;
+}
+
+unsigned int OcclusionQueries::acquireQuery() {
+    if (m_freeQueries.empty()) {
+        unsigned int query;
+        glGenQueries(1, &query);
+        m_stats.pooledQueries++;
+        return query;
+    }
+    unsigned int query = m_freeQueries.back();
+    m_freeQueries.pop_back();
+    return query;
+}
+
+void OcclusionQueries::beginFrame() {
+    const uint32_t pooled = m_stats.pooledQueries;
+    m_stats = OcclusionQueryStats();
+    m_stats.pooledQueries = pooled;
+
+    //results arrive in submission order, so stop at the first one that isn't ready
+    while (!m_pending.empty()) {
+        const PendingQuery& pending = m_pending.front();
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint passed = 0;
+        glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT, &passed);
+        m_visible[pending.object] = passed ? 1 : 0;
+        m_freeQueries.push_back(pending.query);
+        m_pending.pop_front();
+        m_stats.resultsRead++;
+    }
+    m_stats.stallsAvoided = (uint32_t)m_pending.size();
+
+    for (uint8_t visible : m_visible)
+        m_stats.occluded += visible ? 0 : 1;
+}
+
+void OcclusionQueries::draw(uint32_t object, const std::function<void()>& drawObject) {
+    const unsigned int query = acquireQuery();
+    m_pending.push_back({ query, object });
+    m_stats.queries++;
+
+    if (m_visible[object]) {
+        //still visible? the real draw answers that for free
+        glBeginQuery(m_target, query);
+        drawObject();
+        glEndQuery(m_target);
+        return;
+    }
+
+    const Aabb& box = m_bounds[object];
+    glUseProgram(m_program);
+    glUniform3f(m_boxMinLocation, box.min.x, box.min.y, box.min.z);
+    glUniform3f(m_boxMaxLocation, box.max.x, box.max.y, box.max.z);
+    glBindVertexArray(m_vertexArray);
+
+    //with the camera inside the box only its back faces are left
+    const GLboolean culling = glIsEnabled(GL_CULL_FACE);
+    if (culling)
+        glDisable(GL_CULL_FACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glBeginQuery(m_target, query);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+    glEndQuery(m_target);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    if (culling)
+        glEnable(GL_CULL_FACE);
+    m_stats.proxies++;
+
+    glBeginConditionalRender(query, GL_QUERY_NO_WAIT);
+    drawObject();
+    glEndConditionalRender();
+}
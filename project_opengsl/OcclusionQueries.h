@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "Geometry.h"
+
+struct OcclusionQueryStats {
+    uint32_t queries = 0;           //issued this frame
+    uint32_t proxies = 0;           //bounding boxes drawn for objects hidden last time we knew
+    uint32_t resultsRead = 0;
+    uint32_t stallsAvoided = 0;     //results still in flight that GL_QUERY_RESULT would have waited for
+    uint32_t occluded = 0;          //objects whose last result said hidden
+    uint32_t pooledQueries = 0;     //query objects ever created, they're recycled after that
+};
+
+/*
+Occlusion Queries
+    Hardware occlusion culling that never waits on the GPU. Every drawn object gets a
+    GL_ANY_SAMPLES_PASSED_CONSERVATIVE query and its result is picked up a frame or two later,
+    whenever GL says it's available. Objects visible last time are drawn inside their query.
+    Hidden ones draw their bounding box instead (no color or depth writes) and the real draw
+    goes through glBeginConditionalRender(GL_QUERY_NO_WAIT): the GPU skips it if the box
+    turned out hidden, and draws it anyway if the query isn't done yet.
+*/
+class OcclusionQueries {
+public:
+    OcclusionQueries() = default;
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+    ~OcclusionQueries();
+
+    //proxyProgram is OcclusionProxy.shader with the PerFrame block
+    bool init(unsigned int proxyProgram);
+
+    uint32_t addObject(const Aabb& bounds);
+    void setBounds(uint32_t object, const Aabb& bounds);
+
+    void beginFrame();      //collects whatever results are ready
+
+    //drawObject binds its own program and vertex array, proxies leave theirs bound.
+    //Expects color and depth writes to be on, like they are by default
+    void draw(uint32_t object, const std::function<void()>& drawObject);
+
+    bool visible(uint32_t object) const { return m_visible[object] != 0; }
+    const OcclusionQueryStats& stats() const { return m_stats; }
+
+private:
+    struct PendingQuery {
+        unsigned int query;
+        uint32_t object;
+    };
+
+    unsigned int acquireQuery();
+
+    unsigned int m_target = 0;      //GL_ANY_SAMPLES_PASSED_CONSERVATIVE, or GL_ANY_SAMPLES_PASSED before GL 4.3
+    unsigned int m_program = 0;
+    int m_boxMinLocation = -1;
+    int m_boxMaxLocation = -1;
+    unsigned int m_vertexArray = 0;
+    unsigned int m_buffers[2] = {};
+    std::deque<PendingQuery> m_pending;     //oldest first, GL finishes them in that order
+    std::vector<unsigned int> m_freeQueries;
+    std::vector<Aabb> m_bounds;
+    std::vector<uint8_t> m_visible;
+    OcclusionQueryStats m_stats;
+};
@@ -0,0 +1,71 @@
+#include "PipelineStatistics.h"
+#include <GL/glew.h>
+#include <iostream>
+
+PipelineStatistics::~PipelineStatistics() {
+    if (!m_supported)
+        return;
+    for (Slot& slot : m_slots)
+        glDeleteQueries(2, slot.queries);
+}
+
+bool PipelineStatistics::init() {
+    m_supported = GLEW_ARB_pipeline_statistics_query != 0;
+    if (!m_supported) {
+        std::cout << "ARB_pipeline_statistics_query isn't supported, no shader invocation counts" << std::endl;
+        return false;
+    }
+    for (Slot& slot : m_slots)
+        glGenQueries(2, slot.queries);
+    return true;
+}
+
+void PipelineStatistics::begin(uint32_t tag) {
+    if (!m_supported)
+        return;
+
+    Slot& slot = m_slots[m_write];
+    if (slot.pending) {
+        //the GPU is SLOTS frames behind, drop that frame rather than wait for it
+        m_skipped++;
+        slot.pending = false;
+        m_read = (m_write + 1) % SLOTS;
+    }
+    slot.tag = tag;
+    glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, slot.queries[0]);
+    glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, slot.queries[1]);
+    m_active = true;
+}
+
+void PipelineStatistics::end() {
+    if (!m_active)
+        return;
+
+    glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    m_slots[m_write].pending = true;
+    m_write = (m_write + 1) % SLOTS;
+    m_active = false;
+}
+
+bool PipelineStatistics::read(PipelineSample& sample) {
+    Slot& slot = m_slots[m_read];
+    if (!m_supported || !slot.pending)
+        return false;
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    GLuint64 vertices = 0, fragments = 0;
+    glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &vertices);
+    glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &fragments);
+    sample.tag = slot.tag;
+    sample.vertexInvocations = vertices;
+    sample.fragmentInvocations = fragments;
+
+    slot.pending = false;
+    m_read = (m_read + 1) % SLOTS;
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+struct PipelineSample {
+    uint32_t tag = 0;                   //whatever begin() was given, e.g. which mode the frame ran in
+    uint64_t vertexInvocations = 0;
+    uint64_t fragmentInvocations = 0;
+};
+
+/*
+Pipeline Statistics
+    Counts vertex and fragment shader invocations between begin() and end() with
+    ARB_pipeline_statistics_query. Results are read a few frames later without waiting;
+    a frame whose slot is still busy when its turn comes around again is skipped.
+*/
+class PipelineStatistics {
+public:
+    PipelineStatistics() = default;
+    PipelineStatistics(const PipelineStatistics&) = delete;
+    PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+    ~PipelineStatistics();
+
+    bool init();    //false without ARB_pipeline_statistics_query, begin()/end() then do nothing
+
+    void begin(uint32_t tag = 0);
+    void end();
+
+    //oldest finished frame first, false when none is ready
+    bool read(PipelineSample& sample);
+
+    uint32_t skippedFrames() const { return m_skipped; }
+
+private:
+    static const unsigned int SLOTS = 4;
+
+    struct Slot {
+        unsigned int queries[2] = {};   //vertex, fragment
+        uint32_t tag = 0;
+        bool pending = false;
+    };
+
+    Slot m_slots[SLOTS];
+    unsigned int m_write = 0;   //slot begin() uses next
+    unsigned int m_read = 0;    //oldest slot that may be pending
+    bool m_supported = false;
+    bool m_active = false;
+    uint32_t m_skipped = 0;
+};
@@ -0,0 +1,259 @@
+#include "Profiler.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+static const uint32_t GPU_THREAD = 0;      //trace track of the GPU zones, CPU threads count from 1
+static const unsigned int NO_ZONE = ~0u;    //endGpu() of a beginGpu() that wasn't recorded
+
+static void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : m_epoch(now()) {
+}
+
+uint64_t Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadRing& Profiler::threadRing() {
+    thread_local ThreadRing* ring = nullptr;
+    if (ring)
+        return *ring;
+
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    m_rings.emplace_back(new ThreadRing());
+    ring = m_rings.back().get();
+    ring->id = (uint32_t)m_rings.size();
+    ring->name = "Thread " + std::to_string(ring->id);
+    return *ring;
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    ring.name = name;
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    if (!threadRing().events.push({ name, start, end }))
+        m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::capture(unsigned int frames, const std::string& path) {
+    m_captureRequested = frames;
+    m_capturePath = path;
+}
+
+void Profiler::calibrateGpuClock() {
+    GLint64 gpu = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    m_gpuOffset = (int64_t)now() - gpu;
+}
+
+void Profiler::beginFrame() {
+    m_frameStart = now();
+    if (!m_gpuChecked) {
+        m_gpuChecked = true;
+        m_gpuSupported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+        if (m_gpuSupported)
+            calibrateGpuClock();
+    }
+
+    if (m_captureRequested > 0 && m_writeAtFrame == 0) {
+        m_captureFramesLeft = m_captureRequested;
+        m_captureRequested = 0;
+        m_captureFirstFrame = m_frame;
+        m_captureStart = m_frameStart;
+        m_captureEnd = 0;
+        m_captured.clear();
+        if (m_gpuSupported)
+            calibrateGpuClock(); //the two clocks drift apart over a long run
+    }
+
+    if (!m_gpuSupported)
+        return;
+    //every slot still waiting on the GPU, give up on the oldest rather than wait for it
+    if (m_gpuInFlight == GPU_LATENCY) {
+        if (m_gpuFrames[m_gpuRead].pending)
+            m_stats.skippedGpuFrames++;
+        m_gpuFrames[m_gpuRead].pending = false;
+        m_gpuRead = (m_gpuRead + 1) % GPU_LATENCY;
+        m_gpuInFlight--;
+    }
+    GpuFrame& frame = m_gpuFrames[m_gpuWrite];
+    frame.zones.clear();
+    frame.frame = m_frame;
+    m_gpuStack.clear();
+    m_gpuFrameOpen = true;
+}
+
+void Profiler::beginGpu(const char* name) {
+    GpuFrame& frame = m_gpuFrames[m_gpuWrite];
+    if (!m_gpuFrameOpen || frame.zones.size() >= MAX_GPU_ZONES) {
+        m_gpuStack.push_back(NO_ZONE);
+        return;
+    }
+    const unsigned int zone = (unsigned int)frame.zones.size();
+    if (frame.queries.size() < (zone + 1) * 2) {
+        frame.queries.resize((zone + 1) * 2);
+        glGenQueries(2, &frame.queries[zone * 2]);
+    }
+    glQueryCounter(frame.queries[zone * 2], GL_TIMESTAMP);
+    frame.lastQuery = frame.queries[zone * 2];
+    frame.zones.push_back(name);
+    m_gpuStack.push_back(zone);
+}
+
+void Profiler::endGpu() {
+    if (m_gpuStack.empty())
+        return;
+    const unsigned int zone = m_gpuStack.back();
+    m_gpuStack.pop_back();
+    if (zone != NO_ZONE) {
+        GpuFrame& frame = m_gpuFrames[m_gpuWrite];
+        glQueryCounter(frame.queries[zone * 2 + 1], GL_TIMESTAMP);
+        frame.lastQuery = frame.queries[zone * 2 + 1];
+    }
+}
+
+void Profiler::readGpuFrames() {
+    m_stats.gpuZones = 0;
+    while (m_gpuInFlight > 0) {
+        GpuFrame& frame = m_gpuFrames[m_gpuRead];
+        if (frame.pending) {
+            //timestamps land in the order they were issued, the last one being ready means the whole frame is
+            GLint available = 0;
+            glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+
+            const bool captured = m_captureStart != 0 && frame.frame >= m_captureFirstFrame && (m_captureEnd == 0 || frame.frame <= m_captureLastFrame);
+            for (size_t zone = 0; zone < frame.zones.size(); zone++) {
+                GLuint64 start = 0, end = 0;
+                glGetQueryObjectui64v(frame.queries[zone * 2], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(frame.queries[zone * 2 + 1], GL_QUERY_RESULT, &end);
+                if (captured)
+                    m_captured.push_back({ frame.zones[zone], (uint64_t)(start + m_gpuOffset), (uint64_t)(end + m_gpuOffset), GPU_THREAD });
+            }
+            m_stats.gpuZones += (uint32_t)frame.zones.size();
+            frame.pending = false;
+        }
+        m_gpuRead = (m_gpuRead + 1) % GPU_LATENCY;
+        m_gpuInFlight--;
+    }
+}
+
+void Profiler::endFrame() {
+    const uint64_t start = now();
+    record("Frame", m_frameStart, start);
+
+    if (m_gpuFrameOpen) {
+        //a scope left open has no end timestamp, the frame can't be read then
+        GpuFrame& frame = m_gpuFrames[m_gpuWrite];
+        frame.pending = !frame.zones.empty() && m_gpuStack.empty();
+        m_gpuWrite = (m_gpuWrite + 1) % GPU_LATENCY;
+        m_gpuInFlight++;
+        m_gpuFrameOpen = false;
+    }
+    if (m_gpuSupported)
+        readGpuFrames();
+
+    uint32_t events = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (const std::unique_ptr<ThreadRing>& ring : m_rings) {
+            const uint32_t thread = ring->id;
+            events += ring->events.consume([&](const CpuEvent* cpuEvents, uint32_t count) {
+                if (m_captureStart == 0)
+                    return;
+                for (uint32_t i = 0; i < count; i++) {
+                    const CpuEvent& event = cpuEvents[i];
+                    if (event.start >= m_captureStart && (m_captureEnd == 0 || event.start < m_captureEnd))
+                        m_captured.push_back({ event.name, event.start, event.end, thread });
+                }
+            });
+        }
+    }
+
+    if (m_captureFramesLeft > 0 && --m_captureFramesLeft == 0) {
+        //other threads and the GPU may still be finishing the last frame, give them GPU_LATENCY frames
+        m_captureEnd = now();
+        m_captureLastFrame = m_frame;
+        m_writeAtFrame = m_frame + GPU_LATENCY;
+    }
+    if (m_writeAtFrame != 0 && m_frame >= m_writeAtFrame) {
+        writeTrace();
+        m_captured.clear();
+        m_captureStart = 0;
+        m_writeAtFrame = 0;
+    }
+    m_frame++;
+
+    m_stats.cpuEvents = events;
+    m_stats.droppedEvents = m_droppedEvents.load(std::memory_order_relaxed);
+    m_stats.capturing = m_captureStart != 0;
+    m_stats.endFrameMilliseconds = (now() - start) / 1e6;
+}
+
+void Profiler::writeTrace() {
+    std::ofstream out(m_capturePath);
+    if (!out) {
+        std::cout << "Can't write the trace to " << m_capturePath << std::endl;
+        return;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (const std::unique_ptr<ThreadRing>& ring : m_rings) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->id << ",\"args\":{\"name\":";
+            writeJsonString(out, ring->name.c_str());
+            out << "}}";
+        }
+    }
+
+    //complete events in microseconds, Chrome nests them by time on each track
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const TraceEvent& event : m_captured) {
+        out << ",\n{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << (double)((int64_t)(event.start - m_epoch)) / 1000.0
+            << ",\"dur\":" << (double)((int64_t)(event.end - event.start)) / 1000.0 << "}";
+    }
+    out << "\n]}\n";
+
+    std::cout << "Trace of " << m_captureLastFrame - m_captureFirstFrame + 1 << " frames, " << m_captured.size()
+        << " events written to " << m_capturePath << std::endl;
+}
+
+void Profiler::shutdown() {
+    for (GpuFrame& frame : m_gpuFrames) {
+        if (!frame.queries.empty())
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        frame.queries.clear();
+        frame.zones.clear();
+        frame.pending = false;
+    }
+    m_gpuInFlight = 0;
+    m_gpuRead = m_gpuWrite = 0;
+    m_gpuFrameOpen = false;
+    m_gpuChecked = false;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SpscQueue.h"
+
+//0 compiles every PROFILE_* marker out, the Profiler itself stays for the frame calls in main
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+struct ProfilerStats {
+    uint32_t cpuEvents = 0;             //scopes drained by the last endFrame(), every thread
+    uint32_t gpuZones = 0;              //GPU zones read back by the last endFrame()
+    uint32_t droppedEvents = 0;         //a thread's ring was full, since the start
+    uint32_t skippedGpuFrames = 0;      //timestamps still not ready when their slot came around again
+    double endFrameMilliseconds = 0.0;  //the profiler's own cost, draining and reading back
+    bool capturing = false;
+};
+
+/*
+Profiler
+    CPU scopes (PROFILE_SCOPE) go into a lock-free ring per thread and are drained once a frame
+    by endFrame(), on the thread that renders. GPU scopes (PROFILE_GPU_SCOPE, GL thread only)
+    are a pair of GL_TIMESTAMP queries; a frame's timestamps are read back GPU_LATENCY frames
+    later, or dropped if the GPU is still behind, so reading never stalls.
+
+    capture(frames, path) keeps the next frames' scopes from every thread and the GPU, and once
+    the GPU has caught up writes them as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+    Names must outlive the capture, string literals in practice.
+
+        PROFILE_THREAD("Render");
+        {
+            PROFILE_SCOPE("Cull");
+            PROFILE_GPU_SCOPE("Shading");
+            ...
+        }
+*/
+class Profiler {
+public:
+    static Profiler& get();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    static uint64_t now();      //nanoseconds
+
+    void setThreadName(const char* name);   //shown on the calling thread's trace track
+
+    //any thread
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    //GL thread
+    void beginFrame();
+    void endFrame();
+    void beginGpu(const char* name);
+    void endGpu();
+    void shutdown();    //deletes the queries, the context must still be current
+
+    void capture(unsigned int frames, const std::string& path);
+
+    const ProfilerStats& stats() const { return m_stats; }
+
+private:
+    Profiler();
+
+    static const unsigned int GPU_LATENCY = 4;     //frames of timestamps in flight
+    static const unsigned int MAX_GPU_ZONES = 64;  //per frame
+    static const uint32_t RING_CAPACITY = 16 * 1024;
+
+    struct CpuEvent {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    struct ThreadRing {
+        ThreadRing() : events(RING_CAPACITY) {}
+        SpscQueue<CpuEvent> events;
+        std::string name;
+        uint32_t id = 0;
+    };
+
+    struct GpuFrame {
+        std::vector<const char*> zones;     //names
+        std::vector<unsigned int> queries;  //2 per zone, begin and end
+        unsigned int lastQuery = 0;         //issued last, nested zones end after the last one opened
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    struct TraceEvent {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        uint32_t thread;
+    };
+
+    ThreadRing& threadRing();
+    void readGpuFrames();
+    void calibrateGpuClock();
+    void writeTrace();
+
+    std::mutex m_ringsMutex;    //guards m_rings, threads only take it to register
+    std::vector<std::unique_ptr<ThreadRing>> m_rings;
+    uint64_t m_epoch;
+    std::atomic<uint32_t> m_droppedEvents{ 0 };
+
+    uint64_t m_frame = 0;
+    uint64_t m_frameStart = 0;
+    bool m_gpuSupported = false;
+    bool m_gpuChecked = false;
+    int64_t m_gpuOffset = 0;    //CPU minus GPU nanoseconds
+    GpuFrame m_gpuFrames[GPU_LATENCY];
+    unsigned int m_gpuWrite = 0;
+    unsigned int m_gpuRead = 0;
+    unsigned int m_gpuInFlight = 0;     //frames from m_gpuRead on, ended but not read yet
+    std::vector<unsigned int> m_gpuStack;
+    bool m_gpuFrameOpen = false;
+
+    unsigned int m_captureRequested = 0;    //starts with the next beginFrame()
+    unsigned int m_captureFramesLeft = 0;
+    uint64_t m_captureFirstFrame = 0;
+    uint64_t m_captureLastFrame = 0;
+    uint64_t m_captureStart = 0;
+    uint64_t m_captureEnd = 0;
+    uint64_t m_writeAtFrame = 0;
+    std::string m_capturePath;
+    std::vector<TraceEvent> m_captured;
+
+    ProfilerStats m_stats;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : m_name(name), m_start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::get().record(m_name, m_start, Profiler::now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+class ProfileGpuScope {
+public:
+    explicit ProfileGpuScope(const char* name) { Profiler::get().beginGpu(name); }
+    ~ProfileGpuScope() { Profiler::get().endGpu(); }
+    ProfileGpuScope(const ProfileGpuScope&) = delete;
+    ProfileGpuScope& operator=(const ProfileGpuScope&) = delete;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ProfileGpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::get().setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) (void)0
+#define PROFILE_GPU_SCOPE(name) (void)0
+#define PROFILE_THREAD(name) (void)0
+#endif
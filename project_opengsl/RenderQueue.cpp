@@ -0,0 +1,213 @@
+#include "RenderQueue.h"
+#include "UniformBlocks.h"
+#include <GL/glew.h>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+static const uint64_t TRANSLUCENT_BIT = 1ull << 59;
+
+static uint64_t quantizeDepth(float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    return (uint64_t)(depth * (float)0xFFFFFF);
+}
+
+uint64_t RenderQueue::makeKey(unsigned int layer, bool translucent, unsigned int program, unsigned int material, unsigned int mesh, float depth) {
+    uint64_t key = (uint64_t)(layer & 0xF) << 60;
+    uint64_t p = program & 0x3FF;
+    uint64_t m = material & 0x3FFF;
+    uint64_t v = mesh & 0x7FF;
+    uint64_t d = quantizeDepth(depth);
+
+    if (translucent) {
+        //far first, so invert the depth and put it above the state bits
+        key |= TRANSLUCENT_BIT;
+        key |= (0xFFFFFF - d) << 35;
+        key |= p << 25;
+        key |= m << 11;
+        key |= v;
+    }
+    else {
+        //state first to minimize switches, then near first within the same state
+        key |= p << 49;
+        key |= m << 35;
+        key |= v << 24;
+        key |= d;
+    }
+    return key;
+}
+
+void RenderQueue::submit(uint64_t key, const DrawItem& item) {
+    m_keys.push_back(key);
+    m_order.push_back((uint32_t)m_items.size());
+    m_items.push_back(item);
+}
+
+void RenderQueue::submit(unsigned int layer, bool translucent, float depth, const DrawItem& item) {
+    submit(makeKey(layer, translucent, item.program, item.texture, item.vertexArray, depth), item);
+}
+
+void RenderQueue::sort() {
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t count = m_keys.size();
+
+    //the frame's stats start here, execute() called more than once adds up
+    m_stats = RenderQueueStats();
+
+    //count the switches submission order would have caused, for comparison
+    for (size_t i = 0; i < count; i++) {
+        if (i == 0 || m_items[i].program != m_items[i - 1].program)
+            m_stats.unsortedProgramSwitches++;
+        if (i == 0 || m_items[i].texture != m_items[i - 1].texture)
+            m_stats.unsortedTextureSwitches++;
+    }
+
+    //one pass to build all 8 byte histograms
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = m_keys[i];
+        for (int pass = 0; pass < 8; pass++)
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+
+    m_scratchKeys.resize(count);
+    m_scratchOrder.resize(count);
+    uint64_t* srcKeys = m_keys.data();
+    uint32_t* srcOrder = m_order.data();
+    uint64_t* dstKeys = m_scratchKeys.data();
+    uint32_t* dstOrder = m_scratchOrder.data();
+
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t* histogram = histograms[pass];
+        const int shift = pass * 8;
+
+        //every key has the same byte here (e.g. unused layers), nothing to do
+        if (count == 0 || histogram[(srcKeys[0] >> shift) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            uint32_t n = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t dst = histogram[(srcKeys[i] >> shift) & 0xFF]++;
+            dstKeys[dst] = srcKeys[i];
+            dstOrder[dst] = srcOrder[i];
+        }
+
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcOrder, dstOrder);
+    }
+
+    //an odd number of passes leaves the result in the scratch buffers
+    if (srcKeys != m_keys.data()) {
+        m_keys.swap(m_scratchKeys);
+        m_order.swap(m_scratchOrder);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.sortMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void RenderQueue::executeDepthOnly(unsigned int depthProgram) {
+    const unsigned int NONE = 0xFFFFFFFF;
+    unsigned int vertexArray = NONE;
+    UniformAllocation perDraw = { 0, 0, 0 };
+
+    glUseProgram(depthProgram);
+    glDisable(GL_BLEND);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+
+    for (size_t i = 0; i < m_order.size(); i++) {
+        if (m_keys[i] & TRANSLUCENT_BIT)
+            continue;
+        const DrawItem& item = m_items[m_order[i]];
+
+        unsigned int positions = item.positionVertexArray ? item.positionVertexArray : item.vertexArray;
+        if (positions != vertexArray) {
+            glBindVertexArray(positions);
+            vertexArray = positions;
+        }
+        if (item.perDraw.size != 0 && (item.perDraw.buffer != perDraw.buffer || item.perDraw.offset != perDraw.offset)) {
+            UniformRing::bind(PerDraw::binding, item.perDraw);
+            perDraw = item.perDraw;
+        }
+
+        glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (const void*)(item.firstIndex * sizeof(unsigned int)));
+        m_stats.depthDrawCalls++;
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void RenderQueue::execute(bool depthPrePass) {
+    const unsigned int NONE = 0xFFFFFFFF;
+    unsigned int program = NONE;
+    unsigned int texture = NONE;
+    unsigned int vertexArray = NONE;
+    int blending = -1;
+    UniformAllocation perDraw = { 0, 0, 0 };
+
+    glActiveTexture(GL_TEXTURE0);
+
+    for (size_t i = 0; i < m_order.size(); i++) {
+        const DrawItem& item = m_items[m_order[i]];
+
+        int translucent = (m_keys[i] & TRANSLUCENT_BIT) ? 1 : 0;
+        if (translucent != blending) {
+            if (translucent) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+            else {
+                glDisable(GL_BLEND);
+            }
+            //the pre-pass already wrote opaque depth, only the exact same fragments pass.
+            //Translucent items were left out of it, they test against it as usual but never
+            //write depth, pre-pass or not, or they would hide the translucent items behind them
+            if (depthPrePass)
+                glDepthFunc(translucent ? GL_LESS : GL_EQUAL);
+            glDepthMask(depthPrePass || translucent ? GL_FALSE : GL_TRUE);
+            blending = translucent;
+        }
+        if (item.program != program) {
+            glUseProgram(item.program);
+            program = item.program;
+            m_stats.programSwitches++;
+        }
+        if (item.texture != texture) {
+            glBindTexture(GL_TEXTURE_2D, item.texture);
+            texture = item.texture;
+            m_stats.textureSwitches++;
+        }
+        if (item.vertexArray != vertexArray) {
+            glBindVertexArray(item.vertexArray);
+            vertexArray = item.vertexArray;
+        }
+        if (item.perDraw.size != 0 && (item.perDraw.buffer != perDraw.buffer || item.perDraw.offset != perDraw.offset)) {
+            UniformRing::bind(PerDraw::binding, item.perDraw);
+            perDraw = item.perDraw;
+            m_stats.uniformBinds++;
+        }
+
+        glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, (const void*)(item.firstIndex * sizeof(unsigned int)));
+        m_stats.drawCalls++;
+    }
+
+    if (depthPrePass)
+        glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+void RenderQueue::clear() {
+    m_keys.clear();
+    m_order.clear();
+    m_items.clear();
+}
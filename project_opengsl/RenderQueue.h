@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "UniformRing.h"
+
+//Everything glDrawElements needs to draw one mesh with one material
+struct DrawItem {
+    unsigned int program;
+    unsigned int texture;       //bound to GL_TEXTURE0 as GL_TEXTURE_2D
+    unsigned int vertexArray;
+    unsigned int indexCount;
+    unsigned int firstIndex;    //in indices, not bytes
+    UniformAllocation perDraw;  //bound to PerDraw::binding, size 0 = leave as is
+    unsigned int positionVertexArray = 0;   //positions only, for executeDepthOnly(). 0 = vertexArray
+};
+
+struct RenderQueueStats {
+    unsigned int drawCalls = 0;
+    unsigned int depthDrawCalls = 0;            //in executeDepthOnly()
+    unsigned int programSwitches = 0;           //after sorting
+    unsigned int textureSwitches = 0;
+    unsigned int uniformBinds = 0;
+    unsigned int unsortedProgramSwitches = 0;   //what submission order would have cost
+    unsigned int unsortedTextureSwitches = 0;
+    double sortMilliseconds = 0.0;
+};
+
+/*
+Render Queue
+    Draws are submitted with a 64-bit sort key, sorted once per frame, then executed.
+    Key layout (most significant bit first):
+        layer        4 bits
+        translucent  1 bit
+        opaque:      program 10 | material 14 | mesh 11 | depth 24         (front-to-back)
+        translucent: ~depth 24  | program 10  | material 14 | mesh 11      (back-to-front)
+    Ids are masked into their fields, so two ids can share a bucket. That only costs
+    an extra switch - execute() compares the real ids, not the key bits.
+*/
+class RenderQueue {
+public:
+    //depth: view depth normalized to [0, 1], 0 = near plane
+    static uint64_t makeKey(unsigned int layer, bool translucent, unsigned int program, unsigned int material, unsigned int mesh, float depth);
+
+    void submit(uint64_t key, const DrawItem& item);
+    void submit(unsigned int layer, bool translucent, float depth, const DrawItem& item);
+
+    void sort();    //LSD radix sort on the keys
+
+    //depth pre-pass: opaque items only, drawn with depthProgram (DepthOnly.shader), color writes off and GL_LESS
+    void executeDepthOnly(unsigned int depthProgram);
+
+    //issues the draws, only changing state that differs from the previous item. After
+    //executeDepthOnly() pass depthPrePass, opaque items then test GL_EQUAL without writing depth.
+    //Translucent items never write depth. Leaves depth writes on
+    void execute(bool depthPrePass = false);
+    void clear();
+
+    size_t size() const { return m_items.size(); }
+    //after sort(): the submission index of the i-th item in draw order, and items by submission index
+    uint32_t sortedIndex(size_t i) const { return m_order[i]; }
+    const DrawItem& item(uint32_t submission) const { return m_items[submission]; }
+    const RenderQueueStats& stats() const { return m_stats; }   //since the last sort()
+
+private:
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_order;      //index into m_items, sorted along with m_keys
+    std::vector<DrawItem> m_items;
+    std::vector<uint64_t> m_scratchKeys;
+    std::vector<uint32_t> m_scratchOrder;
+    RenderQueueStats m_stats;
+};
@@ -0,0 +1,81 @@
+#include "RenderThread.h"
+#include <chrono>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "Profiler.h"
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+void RenderThread::start(GLFWwindow* window, std::function<void()> frame) {
+    m_window = window;
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+
+    //a context can only be current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+    m_running = true;
+    m_thread = std::thread([this, frame]() {
+        glfwMakeContextCurrent(m_window);
+        PROFILE_THREAD("Render");
+        while (m_running.load(std::memory_order_acquire))
+            frame();
+        glfwMakeContextCurrent(nullptr);
+    });
+}
+
+void RenderThread::stop() {
+    if (!m_thread.joinable())
+        return;
+    m_running.store(false, std::memory_order_release);
+    wake();
+    m_thread.join();
+
+    glfwSetKeyCallback(m_window, nullptr);
+    glfwSetFramebufferSizeCallback(m_window, nullptr);
+    glfwSetWindowRefreshCallback(m_window, nullptr);
+    glfwSetWindowUserPointer(m_window, nullptr);
+    glfwMakeContextCurrent(m_window);
+}
+
+void RenderThread::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_woken = true;
+    }
+    m_wakeCondition.notify_one();
+}
+
+void RenderThread::waitForWork(double seconds) {
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wakeCondition.wait_for(lock, std::chrono::duration<double>(seconds), [this]() {
+        return m_woken || !m_input.empty() || !m_running.load(std::memory_order_acquire);
+    });
+    m_woken = false;
+}
+
+void RenderThread::push(const InputEvent& event) {
+    if (!m_input.push(event))
+        m_droppedInput.fetch_add(1, std::memory_order_relaxed);
+    wake();
+}
+
+void RenderThread::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    (void)scancode;
+    (void)mods;
+    RenderThread* renderThread = (RenderThread*)glfwGetWindowUserPointer(window);
+    renderThread->push({ InputEventType::Key, key, action, 0, 0 });
+}
+
+void RenderThread::framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    RenderThread* renderThread = (RenderThread*)glfwGetWindowUserPointer(window);
+    renderThread->push({ InputEventType::FramebufferSize, 0, 0, width, height });
+}
+
+void RenderThread::refreshCallback(GLFWwindow* window) {
+    RenderThread* renderThread = (RenderThread*)glfwGetWindowUserPointer(window);
+    renderThread->push({ InputEventType::Refresh, 0, 0, 0, 0 });
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "SpscQueue.h"
+
+struct GLFWwindow;
+
+enum class InputEventType {
+    Key,
+    FramebufferSize,
+    Refresh         //the window was uncovered or exposed, its contents are gone
+};
+
+struct InputEvent {
+    InputEventType type;
+    int key;        //GLFW_KEY_*
+    int action;     //GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    int width;      //FramebufferSize
+    int height;
+};
+
+/*
+Render Thread
+    Moves a window's GL context to a thread of its own so GLFW's events, which must be handled
+    on the main thread, and GL never wait on each other. start() releases the context on the
+    calling thread and makes it current on the render thread, which calls frame() until stop();
+    stop() hands the context back.
+
+    Key, framebuffer size and refresh events reach the render thread through input(), a lock-free queue
+    filled by GLFW callbacks on the main thread. Everything else the render thread needs from
+    the main thread should come the same way or through a TripleBuffer.
+
+    A frame with nothing to draw can waitForWork() instead of spinning; input arriving, wake()
+    or stop() ends the wait.
+*/
+class RenderThread {
+public:
+    RenderThread() = default;
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+    ~RenderThread();
+
+    //main thread. installs the window's key, framebuffer size and refresh callbacks
+    void start(GLFWwindow* window, std::function<void()> frame);
+    void stop();
+    //any thread. ends a waitForWork(), or the next one if none is waiting
+    void wake();
+
+    //render thread
+    SpscQueue<InputEvent>& input() { return m_input; }
+    unsigned int droppedInput() const { return m_droppedInput.load(std::memory_order_relaxed); }
+    void waitForWork(double seconds);
+
+private:
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+    static void refreshCallback(GLFWwindow* window);
+    void push(const InputEvent& event);
+
+    GLFWwindow* m_window = nullptr;
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+    SpscQueue<InputEvent> m_input{ 256 };
+    std::atomic<unsigned int> m_droppedInput{ 0 };
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    bool m_woken = false;   //under m_wakeMutex
+};
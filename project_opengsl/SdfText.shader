@@ -0,0 +1,36 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 rect;      //x, y, width, height in pixels from the top-left
+layout(location = 1) in vec4 uvRect;    //u0, v0, u1, v1
+layout(location = 2) in vec4 color;
+
+uniform vec2 u_ScreenSize;
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+
+void main() {
+   vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+   vec2 pixel = rect.xy + corner * rect.zw;
+   gl_Position = vec4(pixel.x / u_ScreenSize.x * 2.0 - 1.0, 1.0 - pixel.y / u_ScreenSize.y * 2.0, 0.0, 1.0);
+   v_TexCoord = mix(uvRect.xy, uvRect.zw, corner);
+   v_Color = color;
+};
+
+#shader fragment
+#version 330 core
+
+in vec2 v_TexCoord;
+in vec4 v_Color;
+
+uniform sampler2D u_Atlas;
+
+layout(location = 0) out vec4 color;
+void main() {
+   //0.5 is the glyph's edge, fwidth keeps the antialiasing one pixel wide at any scale
+   float distance = texture(u_Atlas, v_TexCoord).r;
+   float width = fwidth(distance);
+   float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+   color = vec4(v_Color.rgb, v_Color.a * alpha);
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "Shader.h"
+#include <GL/glew.h>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <sstream>
+#include "UniformBlocks.h"
+
+ShaderProgramSource ParseShader(const std::string& filepath) {
+    
+    std::ifstream stream(filepath);
+
+    enum class ShaderType {
+        NONE = -1,
+        VERTEX = 0,
+        FRAGMENT = 1
+    };
+    ShaderType type = ShaderType::NONE;
+
+    std::string line;
+    std::stringstream ss[2];
+
+    while (getline(stream, line)) 
+    {
+        if (line.find("#shader") != std::string::npos) 
+        {
+            if (line.find("vertex") != std::string::npos) 
+                type = ShaderType::VERTEX;
+            else if (line.find("fragment") != std::string::npos)
+                type = ShaderType::FRAGMENT;
+        }
+        else 
+        {
+            ss[(int)type] << line << '\n';
+        }
+    }
+    return { ss[0].str(), ss[1].str() };
+}
+
+//uniform block declarations have to come after #version, which must be the first line
+static void insertAfterVersion(std::string& source, const char* declaration) {
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+        return;
+    source.insert(source.find('\n', version) + 1, declaration);
+}
+
+void injectUniformBlocks(ShaderProgramSource& source, bool plainPerDraw) {
+    for (std::string* stage : { &source.VertexSource, &source.FragmentSource }) {
+        insertAfterVersion(*stage, plainPerDraw ? PerDraw::plainGlsl() : PerDraw::glsl());
+        insertAfterVersion(*stage, PerFrame::glsl());
+    }
+}
+
+static unsigned int compileShader(unsigned int type, const std::string source) {
+    unsigned int id = glCreateShader(type);
+    const char* src = source.c_str();
+    glShaderSource(id, 1, &src, nullptr);
+    glCompileShader(id);
+
+    //Error Handling
+    int result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result) ;
+    if (result == GL_FALSE) { //error
+        int length;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+        char* message = (char*)alloca(length * sizeof(char)); //alloca() allocates memory within the current function's stack frame. Memory allocated using alloca() will be removed from the stack when the current function returns. alloca() is limited to small allocations.
+        glGetShaderInfoLog(id, length, &length, message);
+
+        std::cout << "Failed to compile shader!" << std::endl;
+        std::cout << message << std::endl;
+        glDeleteShader(id);
+        return 0;
+    }
+
+    return id;
+
+}
+unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader) {
+    
+    unsigned int program_id = glCreateProgram();
+    unsigned int vs = compileShader(GL_VERTEX_SHADER, vertexShader);
+    unsigned int fs = compileShader(GL_FRAGMENT_SHADER, fragmentShader);
+
+    glAttachShader(program_id, vs);
+    glAttachShader(program_id, fs);
+    glLinkProgram(program_id);
+
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    
+    return program_id;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+struct ShaderProgramSource {
+    std::string VertexSource;
+    std::string FragmentSource;
+};
+
+//splits a .shader file at its "#shader vertex" and "#shader fragment" lines
+ShaderProgramSource ParseShader(const std::string& filepath);
+
+//prepends the PerFrame and PerDraw blocks from UniformBlocks.h to both stages. plainPerDraw
+//declares PerDraw's members as plain uniforms instead, to be set with glUniform* per draw
+void injectUniformBlocks(ShaderProgramSource& source, bool plainPerDraw = false);
+
+//compile errors go to std::cout, the program is returned either way
+unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader);
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+SPSC Queue
+    A fixed size ring for exactly one producer thread and one consumer thread, neither ever
+    waits or takes a lock. The producer only writes m_head and the consumer only writes m_tail,
+    each publishes with a release store that the other side picks up with an acquire load.
+    Pushes that don't fit fail instead of blocking, what to do then is up to the caller.
+*/
+template <typename T>
+class SpscQueue {
+public:
+    //capacity is rounded up to a power of 2
+    explicit SpscQueue(uint32_t capacity) {
+        uint32_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    //producer. all or nothing
+    bool push(const T* items, uint32_t count) {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+        const uint32_t tail = m_tail.load(std::memory_order_acquire);
+        if (capacity() - (head - tail) < count)
+            return false;
+        for (uint32_t i = 0; i < count; i++)
+            m_items[(head + i) & m_mask] = items[i];
+        m_head.store(head + count, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& item) { return push(&item, 1); }
+
+    //consumer
+    bool pop(T& item) {
+        const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+        item = m_items[tail & m_mask];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //consumer. hands everything queued so far to function(const T* items, uint32_t count) as at most two contiguous runs
+    template <typename Function>
+    uint32_t consume(Function&& function) {
+        const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        const uint32_t head = m_head.load(std::memory_order_acquire);
+        const uint32_t count = head - tail;
+        if (count == 0)
+            return 0;
+
+        const uint32_t first = tail & m_mask;
+        const uint32_t run = std::min(count, capacity() - first);
+        function(&m_items[first], run);
+        if (run < count)
+            function(&m_items[0], count - run);
+        m_tail.store(head, std::memory_order_release);
+        return count;
+    }
+
+    uint32_t capacity() const { return m_mask + 1; }
+    //either side, only a snapshot
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+private:
+    std::vector<T> m_items;
+    uint32_t m_mask = 0;
+    std::atomic<uint32_t> m_head{ 0 };
+    char m_padding[60];     //head and tail on separate cache lines, new doesn't honour alignas(64) before C++17
+    std::atomic<uint32_t> m_tail{ 0 };
+};
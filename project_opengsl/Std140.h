@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+std140 / std430 blocks
+    GLSL lays uniform/storage blocks out by its own alignment rules, C++ by the compiler's.
+    Declare a block once as a field list and UNIFORM_BLOCK / STORAGE_BLOCK generate
+     - the C++ struct
+     - static_asserts that every member sits at the offset GLSL will read it from
+     - the GLSL declaration, so the shader can't drift from the struct
+     - the same members as plain uniforms, for code that sets them with glUniform* instead
+
+    #define PER_DRAW_FIELDS(FIELD) \
+        FIELD(mat4, model)         \
+        FIELD(vec4, color)
+    UNIFORM_BLOCK(PerDraw, 1, PER_DRAW_FIELDS)
+
+    PerDraw::glsl() ->  layout(std140, binding = 1) uniform PerDraw {
+                            mat4 model;
+                            vec4 color;
+                        };
+    PerDraw::plainGlsl() -> uniform mat4 model;
+                            uniform vec4 color;
+
+    Supported types are float, int, uint, vec2, vec3, vec4, ivec4, uvec4 and mat4. For these
+    std140 and std430 agree (they only differ for arrays and nested structs). GLSL packs a
+    scalar into the last 4 bytes of a vec3, C++ can't, so a vec3 has to be followed by a
+    16 byte aligned member (or be last) to pass the check.
+*/
+
+struct alignas(8) Std140Vec2 { float x, y; };
+struct alignas(16) Std140Vec3 { float x, y, z; };
+struct alignas(16) Std140Vec4 { float x, y, z, w; };
+struct alignas(16) Std140IVec4 { int32_t x, y, z, w; };
+struct alignas(16) Std140UVec4 { uint32_t x, y, z, w; };
+struct alignas(16) Std140Mat4 { float m[16]; }; //column major
+
+typedef float       Std140Type_float;
+typedef int32_t     Std140Type_int;
+typedef uint32_t    Std140Type_uint;
+typedef Std140Vec2  Std140Type_vec2;
+typedef Std140Vec3  Std140Type_vec3;
+typedef Std140Vec4  Std140Type_vec4;
+typedef Std140IVec4 Std140Type_ivec4;
+typedef Std140UVec4 Std140Type_uvec4;
+typedef Std140Mat4  Std140Type_mat4;
+
+//GLSL size and base alignment
+template <typename T> struct Std140Traits;
+template <> struct Std140Traits<float>       { static const size_t size = 4;  static const size_t alignment = 4; };
+template <> struct Std140Traits<int32_t>     { static const size_t size = 4;  static const size_t alignment = 4; };
+template <> struct Std140Traits<uint32_t>    { static const size_t size = 4;  static const size_t alignment = 4; };
+template <> struct Std140Traits<Std140Vec2>  { static const size_t size = 8;  static const size_t alignment = 8; };
+template <> struct Std140Traits<Std140Vec3>  { static const size_t size = 12; static const size_t alignment = 16; };
+template <> struct Std140Traits<Std140Vec4>  { static const size_t size = 16; static const size_t alignment = 16; };
+template <> struct Std140Traits<Std140IVec4> { static const size_t size = 16; static const size_t alignment = 16; };
+template <> struct Std140Traits<Std140UVec4> { static const size_t size = 16; static const size_t alignment = 16; };
+template <> struct Std140Traits<Std140Mat4>  { static const size_t size = 64; static const size_t alignment = 16; };
+
+constexpr size_t std140AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//where GLSL puts member `index`, given the sizes and alignments of all members
+template <size_t N>
+constexpr size_t std140Offset(const size_t (&sizes)[N], const size_t (&alignments)[N], size_t index) {
+    size_t offset = 0;
+    for (size_t i = 0; i < index; i++)
+        offset = std140AlignUp(offset, alignments[i]) + sizes[i];
+    return std140AlignUp(offset, alignments[index]);
+}
+
+#define STD140_DECLARE_FIELD(type, name) Std140Type_##type name;
+#define STD140_FIELD_INDEX(type, name) index_##name,
+#define STD140_FIELD_SIZE(type, name) Std140Traits<Std140Type_##type>::size,
+#define STD140_FIELD_ALIGNMENT(type, name) Std140Traits<Std140Type_##type>::alignment,
+#define STD140_FIELD_GLSL(type, name) "    " #type " " #name ";\n"
+#define STD140_FIELD_PLAIN_GLSL(type, name) "uniform " #type " " #name ";\n"
+#define STD140_CHECK_FIELD(type, name) \
+    static_assert(offsetof(Self, name) == std140Offset(Layout::sizes, Layout::alignments, Layout::index_##name), \
+        "C++ offset of " #name " doesn't match the GLSL block layout");
+
+#define STD140_BLOCK(Name, Binding, FIELDS, Qualifier, Keyword)                                 \
+    struct Name {                                                                               \
+        FIELDS(STD140_DECLARE_FIELD)                                                            \
+                                                                                                \
+        static const unsigned int binding = Binding;                                           \
+        static const char* glsl() {                                                             \
+            return "layout(" Qualifier ", binding = " #Binding ") " Keyword " " #Name " {\n"   \
+                FIELDS(STD140_FIELD_GLSL) "};\n";                                               \
+        }                                                                                       \
+        static const char* plainGlsl() { return FIELDS(STD140_FIELD_PLAIN_GLSL); }             \
+                                                                                                \
+    private:                                                                                    \
+        typedef Name Self;                                                                      \
+        struct Layout {                                                                         \
+            enum { FIELDS(STD140_FIELD_INDEX) count };                                          \
+            static constexpr size_t sizes[] = { FIELDS(STD140_FIELD_SIZE) };                    \
+            static constexpr size_t alignments[] = { FIELDS(STD140_FIELD_ALIGNMENT) };          \
+        };                                                                                      \
+        static void checkLayout() {                                                             \
+            FIELDS(STD140_CHECK_FIELD)                                                          \
+        }                                                                                       \
+    }
+
+#define UNIFORM_BLOCK(Name, Binding, FIELDS) STD140_BLOCK(Name, Binding, FIELDS, "std140", "uniform")
+#define STORAGE_BLOCK(Name, Binding, FIELDS) STD140_BLOCK(Name, Binding, FIELDS, "std430", "buffer")
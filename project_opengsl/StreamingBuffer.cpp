@@ -0,0 +1,48 @@
+#include "StreamingBuffer.h"
+#include <GL/glew.h>
+#include <cstring>
+#include <iostream>
+
+StreamingBuffer::~StreamingBuffer() {
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamingBuffer::init(size_t capacity) {
+    m_capacity = capacity;
+    m_head = 0;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+size_t StreamingBuffer::upload(const void* data, size_t bytes, size_t alignment) {
+    if (bytes > m_capacity) {
+        std::cout << "StreamingBuffer can't take " << bytes << " bytes at once, it holds " << m_capacity << std::endl;
+        return 0;
+    }
+
+    size_t offset = (m_head + alignment - 1) / alignment * alignment;
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    if (offset + bytes > m_capacity) {
+        glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+        offset = 0;
+        m_stats.orphans++;
+    }
+
+    //nothing in flight touches [offset, offset + bytes), so there's no need to wait
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (mapped) {
+        std::memcpy(mapped, data, bytes);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else {
+        glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_head = offset + bytes;
+    m_stats.bytes += bytes;
+    m_stats.uploads++;
+    return offset;
+}
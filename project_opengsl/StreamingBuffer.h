@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+
+struct StreamingBufferStats {
+    size_t bytes = 0;           //uploaded since the last resetStats()
+    unsigned int uploads = 0;
+    unsigned int orphans = 0;   //times the buffer wrapped and got fresh storage
+};
+
+/*
+Streaming Buffer
+    A GL_ARRAY_BUFFER written front to back with unsynchronized maps. The GPU may still be
+    reading what was written before, so nothing is ever overwritten: when the buffer is full
+    it is orphaned with glBufferData(nullptr), the driver hands over new storage and frees the
+    old one once the GPU is done with it.
+*/
+class StreamingBuffer {
+public:
+    StreamingBuffer() = default;
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+    ~StreamingBuffer();
+
+    void init(size_t capacity);
+
+    //returns the byte offset the data landed at. bytes must not exceed capacity()
+    size_t upload(const void* data, size_t bytes, size_t alignment = 16);
+
+    unsigned int buffer() const { return m_buffer; }
+    size_t capacity() const { return m_capacity; }
+
+    const StreamingBufferStats& stats() const { return m_stats; }
+    void resetStats() { m_stats = StreamingBufferStats(); }
+
+private:
+    unsigned int m_buffer = 0;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    StreamingBufferStats m_stats;
+};
@@ -0,0 +1,344 @@
+#include "TextRenderer.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+static const float DISTANCE_INFINITY = 1e20f;
+static const uint32_t LAYOUT_MAX_AGE = 120;    //frames a cached layout survives without being drawn
+
+//next codepoint of a utf8 string, malformed bytes come out as U+FFFD
+static uint32_t decodeUtf8(const std::string& text, size_t& i) {
+    const unsigned char lead = (unsigned char)text[i++];
+    int continuation = lead < 0x80 ? 0 : (lead >> 5) == 0x6 ? 1 : (lead >> 4) == 0xE ? 2 : (lead >> 3) == 0x1E ? 3 : -1;
+    if (continuation < 0)
+        return 0xFFFD;
+    uint32_t codepoint = continuation == 0 ? lead : lead & (0x3F >> continuation);
+    for (int c = 0; c < continuation; c++) {
+        if (i >= text.size() || ((unsigned char)text[i] & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = codepoint << 6 | ((unsigned char)text[i++] & 0x3F);
+    }
+    return codepoint;
+}
+
+//squared distance to the nearest zero of f along one line (Felzenszwalb & Huttenlocher), in place.
+//v and z are scratch of n and n + 1 elements
+static void distanceTransform(float* f, int n, int stride, int* v, float* z, float* d) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -DISTANCE_INFINITY;
+    z[1] = DISTANCE_INFINITY;
+    for (int q = 1; q < n; q++) {
+        //drop the parabolas the new one hides, z[0] = -infinity stops this at the first
+        float s;
+        while (true) {
+            const int p = v[k];
+            s = ((f[q * stride] + q * q) - (f[p * stride] + p * p)) / (2.0f * (q - p));
+            if (s > z[k])
+                break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = DISTANCE_INFINITY;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q)
+            k++;
+        const int p = v[k];
+        d[q] = (q - p) * (q - p) + f[p * stride];
+    }
+    for (int q = 0; q < n; q++)
+        f[q * stride] = d[q];
+}
+
+static void distanceTransform2D(float* grid, int width, int height) {
+    const int n = std::max(width, height);
+    std::vector<int> v(n);
+    std::vector<float> z(n + 1);
+    std::vector<float> d(n);
+    for (int x = 0; x < width; x++)
+        distanceTransform(grid + x, height, width, v.data(), z.data(), d.data());
+    for (int y = 0; y < height; y++)
+        distanceTransform(grid + y * width, width, 1, v.data(), z.data(), d.data());
+}
+
+TextRenderer::~TextRenderer() {
+    glDeleteTextures(1, &m_texture);
+    glDeleteVertexArrays(1, &m_vertexArray);
+}
+
+bool TextRenderer::init(unsigned int program, GlyphSource* source, int pageSize, int cellSize, int spread) {
+    m_program = program;
+    m_screenSizeLocation = glGetUniformLocation(program, "u_ScreenSize");
+    if (m_screenSizeLocation == -1 || !source) {
+        std::cout << "TextRenderer needs a glyph source and u_ScreenSize in its program" << std::endl;
+        return false;
+    }
+    m_source = source;
+    m_pageSize = pageSize;
+    m_cellSize = cellSize;
+    m_spread = spread;
+    m_cellsPerRow = pageSize / cellSize;
+    m_cells.assign((size_t)m_cellsPerRow * m_cellsPerRow, Cell{ 0, 0, 0, 0, 0, 0 });
+    m_usedCells = 0;
+    m_cellPixels.resize((size_t)cellSize * cellSize);
+    m_distanceField.resize((size_t)cellSize * cellSize * 2);
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, pageSize, pageSize, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //one instance per glyph, the 4 corners come from gl_VertexID
+    m_stream.init(2 * 1024 * 1024);
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+    for (unsigned int attribute = 0; attribute < 3; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    glBindVertexArray(0);
+    return true;
+}
+
+TextRenderer::Glyph* TextRenderer::glyph(uint32_t codepoint) {
+    auto found = m_glyphs.find(codepoint);
+    if (found != m_glyphs.end())
+        return &found->second;
+
+    const auto rasterStart = std::chrono::high_resolution_clock::now();
+    const bool rasterized = m_source->rasterize(codepoint, m_bitmap);
+    m_frameStats.rasterMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - rasterStart).count();
+    if (!rasterized)
+        return nullptr;
+
+    Glyph glyph;
+    glyph.advance = m_bitmap.advance;
+    glyph.blank = m_bitmap.width == 0 || m_bitmap.height == 0;
+    const int width = std::min(m_bitmap.width + 2 * m_spread, m_cellSize);
+    const int height = std::min(m_bitmap.height + 2 * m_spread, m_cellSize);
+    glyph.x0 = (float)(m_bitmap.bearingX - m_spread);
+    glyph.y0 = (float)(-m_bitmap.bearingY - m_spread);
+    glyph.x1 = glyph.x0 + width;
+    glyph.y1 = glyph.y0 + height;
+    glyph.cell = NO_CELL;
+    Glyph& inserted = m_glyphs.emplace(codepoint, glyph).first->second;
+    if (!inserted.blank)
+        makeResident(codepoint, inserted, true);
+    return &inserted;
+}
+
+uint32_t TextRenderer::makeResident(uint32_t codepoint, Glyph& glyph, bool rasterized) {
+    if (glyph.cell != NO_CELL && m_cells[glyph.cell].codepoint == codepoint) {
+        m_cells[glyph.cell].lastUsed = m_frame;
+        return glyph.cell;
+    }
+
+    //a free cell, or else the least recently used one
+    uint32_t cell = m_usedCells;
+    if (m_usedCells < m_cells.size()) {
+        m_usedCells++;
+    }
+    else {
+        cell = 0;
+        for (uint32_t c = 1; c < m_cells.size(); c++) {
+            if (m_cells[c].lastUsed < m_cells[cell].lastUsed)
+                cell = c;
+        }
+        if (m_cells[cell].lastUsed == m_frame) {
+            m_frameStats.droppedGlyphs++;
+            return NO_CELL;
+        }
+        auto evicted = m_glyphs.find(m_cells[cell].codepoint);
+        if (evicted != m_glyphs.end())
+            evicted->second.cell = NO_CELL;
+        m_frameStats.evictions++;
+    }
+
+    //glyph() hands over a fresh bitmap, a glyph coming back after an eviction is rasterized again
+    const auto rasterStart = std::chrono::high_resolution_clock::now();
+    if (!rasterized)
+        m_source->rasterize(codepoint, m_bitmap);
+    glyph.cell = cell;
+
+    //the distance field covers the bitmap plus spread pixels on each side
+    const int width = (int)(glyph.x1 - glyph.x0);
+    const int height = (int)(glyph.y1 - glyph.y0);
+    float* outside = m_distanceField.data();                     //squared distance to the nearest covered pixel
+    float* inside = m_distanceField.data() + width * height;     //and to the nearest uncovered one
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int bx = x - m_spread;
+            const int by = y - m_spread;
+            const bool covered = bx >= 0 && by >= 0 && bx < m_bitmap.width && by < m_bitmap.height
+                && m_bitmap.coverage[by * m_bitmap.width + bx] >= 128;
+            outside[y * width + x] = covered ? 0.0f : DISTANCE_INFINITY;
+            inside[y * width + x] = covered ? DISTANCE_INFINITY : 0.0f;
+        }
+    }
+    distanceTransform2D(outside, width, height);
+    distanceTransform2D(inside, width, height);
+
+    //0.5 is the edge, which lies half a pixel between a covered and an uncovered pixel. The rest of
+    //the cell is 0, far outside, in place of whatever glyph had it before
+    const float scale = 0.5f / m_spread;
+    std::fill(m_cellPixels.begin(), m_cellPixels.end(), (unsigned char)0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int i = y * width + x;
+            const float distance = inside[i] > 0.0f ? std::sqrt(inside[i]) - 0.5f : 0.5f - std::sqrt(outside[i]);
+            const float value = std::min(std::max(0.5f + distance * scale, 0.0f), 1.0f);
+            m_cellPixels[y * m_cellSize + x] = (unsigned char)(value * 255.0f + 0.5f);
+        }
+    }
+    const auto uploadStart = std::chrono::high_resolution_clock::now();
+
+    const int cellX = (int)(cell % m_cellsPerRow) * m_cellSize;
+    const int cellY = (int)(cell / m_cellsPerRow) * m_cellSize;
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, cellX, cellY, m_cellSize, m_cellSize, GL_RED, GL_UNSIGNED_BYTE, m_cellPixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    const auto uploadEnd = std::chrono::high_resolution_clock::now();
+    m_frameStats.rasterMilliseconds += std::chrono::duration<double, std::milli>(uploadStart - rasterStart).count();
+    m_frameStats.uploadMilliseconds += std::chrono::duration<double, std::milli>(uploadEnd - uploadStart).count();
+
+    auto toUnorm16 = [this](int texel) { return (uint16_t)((uint32_t)texel * 65535u / (uint32_t)m_pageSize); };
+    m_cells[cell] = { codepoint, m_frame, toUnorm16(cellX), toUnorm16(cellY), toUnorm16(cellX + width), toUnorm16(cellY + height) };
+    m_frameStats.rasterized++;
+    return cell;
+}
+
+TextRenderer::Layout& TextRenderer::layout(const std::string& text) {
+    auto found = m_layouts.find(text);
+    if (found != m_layouts.end()) {
+        m_frameStats.layoutHits++;
+        found->second.lastUsed = m_frame;
+        return found->second;
+    }
+    m_frameStats.layoutMisses++;
+
+    Layout& layout = m_layouts[text];
+    layout.width = 0.0f;
+    layout.lastUsed = m_frame;
+    float penX = 0.0f;
+    float baseline = m_source->ascent();
+    for (size_t i = 0; i < text.size();) {
+        const uint32_t codepoint = decodeUtf8(text, i);
+        if (codepoint == '\n') {
+            penX = 0.0f;
+            baseline += m_source->lineHeight();
+            continue;
+        }
+        const Glyph* found = glyph(codepoint);
+        if (!found)
+            continue;
+        if (!found->blank)
+            layout.glyphs.push_back({ codepoint, found->cell, penX + found->x0, baseline + found->y0, penX + found->x1, baseline + found->y1 });
+        penX += found->advance;
+        layout.width = std::max(layout.width, penX);
+    }
+    return layout;
+}
+
+void TextRenderer::draw(const std::string& text, float x, float y, float size, uint32_t color) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_frameStats.labels++;
+
+    Layout& cached = layout(text);
+    const float scale = size / m_source->lineHeight();
+    const size_t first = m_instances.size();
+    m_instances.resize(first + cached.glyphs.size());
+    Instance* instance = m_instances.data() + first;
+    for (LayoutGlyph& placed : cached.glyphs) {
+        //the cell may have gone to another glyph since the layout was made
+        if (placed.cell == NO_CELL || m_cells[placed.cell].codepoint != placed.codepoint) {
+            placed.cell = makeResident(placed.codepoint, m_glyphs[placed.codepoint], false);
+            if (placed.cell == NO_CELL)
+                continue;
+        }
+        Cell& cell = m_cells[placed.cell];
+        cell.lastUsed = m_frame;
+        *instance++ = {
+            x + placed.x0 * scale, y + placed.y0 * scale, (placed.x1 - placed.x0) * scale, (placed.y1 - placed.y0) * scale,
+            cell.u0, cell.v0, cell.u1, cell.v1, color
+        };
+    }
+    m_instances.resize(instance - m_instances.data());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_frameStats.cpuMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+float TextRenderer::measure(const std::string& text, float size) {
+    return layout(text).width * size / m_source->lineHeight();
+}
+
+void TextRenderer::flush(int screenWidth, int screenHeight) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (!m_instances.empty()) {
+        const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        const GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glUseProgram(m_program);
+        glUniform2f(m_screenSizeLocation, (float)screenWidth, (float)screenHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glBindVertexArray(m_vertexArray);
+
+        //more text than the streaming buffer holds goes out in several draws
+        const size_t perDraw = m_stream.capacity() / sizeof(Instance);
+        for (size_t first = 0; first < m_instances.size(); first += perDraw) {
+            const size_t count = std::min(perDraw, m_instances.size() - first);
+            const size_t offset = m_stream.upload(&m_instances[first], count * sizeof(Instance), sizeof(Instance));
+            glBindBuffer(GL_ARRAY_BUFFER, m_stream.buffer());
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*)offset);
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Instance), (const void*)(offset + 4 * sizeof(float)));
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), (const void*)(offset + 4 * sizeof(float) + 4 * sizeof(uint16_t)));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+            m_frameStats.drawCalls++;
+        }
+
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        if (!blend)
+            glDisable(GL_BLEND);
+    }
+    m_frameStats.glyphs = (unsigned int)m_instances.size();
+    m_instances.clear();
+
+    //labels that changed leave their old layouts behind
+    if (m_frame % LAYOUT_MAX_AGE == 0) {
+        for (auto layout = m_layouts.begin(); layout != m_layouts.end();) {
+            if (m_frame - layout->second.lastUsed >= LAYOUT_MAX_AGE)
+                layout = m_layouts.erase(layout);
+            else
+                ++layout;
+        }
+    }
+    m_frame++;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_frameStats.cpuMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    m_frameStats.layouts = (unsigned int)m_layouts.size();
+    m_stats = m_frameStats;
+    m_frameStats = TextStats();
+}
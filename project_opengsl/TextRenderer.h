@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GlyphSource.h"
+#include "StreamingBuffer.h"
+
+struct TextStats {
+    unsigned int labels = 0;            //draw() calls since the last flush()
+    unsigned int glyphs = 0;            //instances in the last flush()
+    unsigned int drawCalls = 0;
+    unsigned int layoutHits = 0;
+    unsigned int layoutMisses = 0;
+    unsigned int layouts = 0;           //cached
+    unsigned int rasterized = 0;        //glyphs turned into distance fields
+    unsigned int evictions = 0;
+    unsigned int droppedGlyphs = 0;     //every cell was already in use this frame
+    double cpuMilliseconds = 0.0;       //draw() calls and flush() together
+    double rasterMilliseconds = 0.0;    //rasterizing and distance fields, part of cpuMilliseconds
+    double uploadMilliseconds = 0.0;    //cells written to the page, part of cpuMilliseconds
+};
+
+/*
+Text Renderer
+    Signed distance field text that stays sharp at any size. Glyphs are rasterized on first use,
+    turned into a distance field and stored in a cell of a single-channel atlas page; once every
+    cell is taken, the least recently used glyph gives its cell up. A glyph already drawn this
+    frame is never evicted, if the page can't hold a frame's worth of glyphs the rest are dropped.
+    A cell is written whole, the glyph and zeros around it, so a smaller glyph moving in leaves
+    nothing of the last one for linear filtering to pick up.
+
+    Each distinct string is laid out once and cached, so drawing the same label again only
+    scales and offsets its quads. Everything drawn between two flush() calls goes out as one
+    instanced draw of 4-vertex strips. scenes/text_labels.scene in project_benchmark measures it.
+*/
+class TextRenderer {
+public:
+    TextRenderer() = default;
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+    ~TextRenderer();
+
+    //program is SdfText.shader. the source's glyphs must fit in cellSize minus spread on each side
+    bool init(unsigned int program, GlyphSource* source, int pageSize = 1024, int cellSize = 64, int spread = 8);
+
+    //utf8 text with '\n' line breaks. x, y is the top-left corner in pixels from the window's top-left,
+    //size is the line height in pixels
+    void draw(const std::string& text, float x, float y, float size, uint32_t color);
+    float measure(const std::string& text, float size);
+
+    void flush(int screenWidth, int screenHeight);
+
+    const TextStats& stats() const { return m_stats; }
+
+private:
+    static const uint32_t NO_CELL = 0xFFFFFFFF;
+
+    struct Glyph {
+        float advance;
+        float x0, y0, x1, y1;   //quad around the pen position on the baseline, y down, at the source's size
+        bool blank;
+        uint32_t cell;
+    };
+
+    struct Cell {
+        uint32_t codepoint;
+        uint32_t lastUsed;      //frame
+        uint16_t u0, v0, u1, v1;
+    };
+
+    struct LayoutGlyph {
+        uint32_t codepoint;
+        uint32_t cell;          //may be stale, checked against Cell::codepoint before use
+        float x0, y0, x1, y1;   //relative to the text's top-left, at the source's size
+    };
+
+    struct Layout {
+        std::vector<LayoutGlyph> glyphs;
+        float width;
+        uint32_t lastUsed;
+    };
+
+    struct Instance {
+        float x, y, width, height;
+        uint16_t u0, v0, u1, v1;
+        uint32_t color;
+    };
+
+    Glyph* glyph(uint32_t codepoint);
+    uint32_t makeResident(uint32_t codepoint, Glyph& glyph, bool rasterized);  //rasterized: m_bitmap already holds it
+    Layout& layout(const std::string& text);
+
+    GlyphSource* m_source = nullptr;
+    unsigned int m_program = 0;
+    int m_screenSizeLocation = -1;
+    unsigned int m_texture = 0;
+    unsigned int m_vertexArray = 0;
+    StreamingBuffer m_stream;
+
+    int m_pageSize = 0;
+    int m_cellSize = 0;
+    int m_spread = 0;
+    int m_cellsPerRow = 0;
+    std::vector<Cell> m_cells;
+    uint32_t m_usedCells = 0;
+    uint32_t m_frame = 1;
+
+    std::unordered_map<uint32_t, Glyph> m_glyphs;
+    std::unordered_map<std::string, Layout> m_layouts;
+    std::vector<Instance> m_instances;
+
+    GlyphBitmap m_bitmap;               //scratch
+    std::vector<float> m_distanceField; //scratch
+    std::vector<unsigned char> m_cellPixels;
+    TextStats m_frameStats;
+    TextStats m_stats;
+};
@@ -0,0 +1,397 @@
+#include "TextureAtlas.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+static bool intersects(const AtlasRect& a, const AtlasRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static bool contains(const AtlasRect& outer, const AtlasRect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+        inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
+
+void MaxRectsPacker::init(int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_usedArea = 0;
+    m_freeRects.clear();
+    m_freeRects.push_back({ 0, 0, width, height });
+}
+
+bool MaxRectsPacker::insert(int width, int height, AtlasRect& placed) {
+    int bestShortSide = INT32_MAX;
+    int bestLongSide = INT32_MAX;
+    const AtlasRect* best = nullptr;
+
+    for (const AtlasRect& free : m_freeRects) {
+        if (free.width < width || free.height < height)
+            continue;
+        int leftoverX = free.width - width;
+        int leftoverY = free.height - height;
+        int shortSide = std::min(leftoverX, leftoverY);
+        int longSide = std::max(leftoverX, leftoverY);
+        if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide)) {
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+            best = &free;
+        }
+    }
+    if (!best)
+        return false;
+
+    placed = { best->x, best->y, width, height };
+    splitFreeRects(placed);
+    m_usedArea += (int64_t)width * height;
+    return true;
+}
+
+void MaxRectsPacker::splitFreeRects(const AtlasRect& used) {
+    std::vector<AtlasRect> split;
+
+    for (size_t i = 0; i < m_freeRects.size();) {
+        const AtlasRect free = m_freeRects[i];
+        if (!intersects(free, used)) {
+            i++;
+            continue;
+        }
+
+        //whatever is left of the free rect on each side of the used one
+        if (used.x > free.x)
+            split.push_back({ free.x, free.y, used.x - free.x, free.height });
+        if (used.x + used.width < free.x + free.width)
+            split.push_back({ used.x + used.width, free.y, free.x + free.width - (used.x + used.width), free.height });
+        if (used.y > free.y)
+            split.push_back({ free.x, free.y, free.width, used.y - free.y });
+        if (used.y + used.height < free.y + free.height)
+            split.push_back({ free.x, used.y + used.height, free.width, free.y + free.height - (used.y + used.height) });
+
+        m_freeRects[i] = m_freeRects.back();
+        m_freeRects.pop_back();
+    }
+
+    //the untouched rects are still maximal, so only the new ones can be redundant
+    const size_t untouched = m_freeRects.size();
+    for (size_t i = 0; i < split.size(); i++) {
+        bool redundant = false;
+        for (size_t j = 0; j < untouched && !redundant; j++)
+            redundant = contains(m_freeRects[j], split[i]);
+        for (size_t j = 0; j < split.size() && !redundant; j++) {
+            //identical rects: keep the first one
+            if (i != j && contains(split[j], split[i]) && (!contains(split[i], split[j]) || j < i))
+                redundant = true;
+        }
+        if (!redundant)
+            m_freeRects.push_back(split[i]);
+    }
+}
+
+void MaxRectsPacker::remove(const AtlasRect& rect) {
+    m_usedArea -= (int64_t)rect.width * rect.height;
+
+    //grow the hole across free neighbours that share a whole edge with it
+    AtlasRect hole = rect;
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (const AtlasRect& free : m_freeRects) {
+            if (free.x == hole.x && free.width == hole.width) {
+                if (free.y + free.height == hole.y || hole.y + hole.height == free.y) {
+                    hole.y = std::min(hole.y, free.y);
+                    hole.height += free.height;
+                    merged = true;
+                }
+            }
+            else if (free.y == hole.y && free.height == hole.height) {
+                if (free.x + free.width == hole.x || hole.x + hole.width == free.x) {
+                    hole.x = std::min(hole.x, free.x);
+                    hole.width += free.width;
+                    merged = true;
+                }
+            }
+            if (merged)
+                break;
+        }
+    }
+
+    addFreeRect(hole);
+}
+
+//the rects already in the list don't contain one another, so only the new one needs checking
+//against them: a pass over the list instead of a pass per rect
+void MaxRectsPacker::addFreeRect(const AtlasRect& rect) {
+    for (size_t i = 0; i < m_freeRects.size();) {
+        if (contains(m_freeRects[i], rect))
+            return;
+        if (contains(rect, m_freeRects[i])) {
+            m_freeRects[i] = m_freeRects.back();
+            m_freeRects.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+    m_freeRects.push_back(rect);
+}
+
+float MaxRectsPacker::occupancy() const {
+    return (float)((double)m_usedArea / ((double)m_width * m_height));
+}
+
+float MaxRectsPacker::fragmentation() const {
+    int64_t freeArea = (int64_t)m_width * m_height - m_usedArea;
+    if (freeArea <= 0)
+        return 0.0f;
+
+    int64_t largest = 0;
+    for (const AtlasRect& free : m_freeRects)
+        largest = std::max(largest, (int64_t)free.width * free.height);
+    return (float)((double)(freeArea - largest) / ((double)m_width * m_height));
+}
+
+TextureAtlas::~TextureAtlas() {
+    if (m_repack.valid())
+        m_repack.wait();
+    glDeleteTextures(1, &m_texture);
+}
+
+unsigned int TextureAtlas::createArrayTexture() const {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, m_pageSize, m_pageSize, m_maxPages);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+bool TextureAtlas::init(int pageSize, unsigned int maxPages, int padding, float repackThreshold, float repackHysteresis) {
+    int maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (maxPages > (unsigned int)maxLayers) {
+        std::cout << "Texture atlas can have at most " << maxLayers << " pages" << std::endl;
+        return false;
+    }
+
+    m_pageSize = pageSize;
+    m_maxPages = maxPages;
+    m_padding = padding;
+    m_repackThreshold = repackThreshold;
+    m_repackHysteresis = repackHysteresis;
+    m_texture = createArrayTexture();
+
+    m_pages.resize(1);
+    m_pages[0].init(pageSize, pageSize);
+    return true;
+}
+
+AtlasHandle TextureAtlas::insert(int width, int height, const unsigned char* rgba) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int paddedWidth = width + 2 * m_padding;
+    int paddedHeight = height + 2 * m_padding;
+    if (paddedWidth > m_pageSize || paddedHeight > m_pageSize)
+        return INVALID_ATLAS_HANDLE;
+
+    Entry entry = {};
+    entry.alive = true;
+    bool placed = false;
+    for (size_t page = 0; page < m_pages.size() && !placed; page++) {
+        placed = m_pages[page].insert(paddedWidth, paddedHeight, entry.rect);
+        entry.page = (unsigned int)page;
+    }
+    if (!placed && m_pages.size() < m_maxPages) {
+        m_pages.emplace_back();
+        m_pages.back().init(m_pageSize, m_pageSize);
+        placed = m_pages.back().insert(paddedWidth, paddedHeight, entry.rect);
+        entry.page = (unsigned int)(m_pages.size() - 1);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_stats.insertMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (!placed)
+        return INVALID_ATLAS_HANDLE;
+
+    AtlasHandle handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+        m_entries[handle] = entry;
+    }
+    else {
+        handle = (AtlasHandle)m_entries.size();
+        m_entries.push_back(entry);
+    }
+
+    //the edge texels repeated into the padding, so linear filtering at the edge of the region
+    //blends the image with itself instead of whatever the rect held before
+    m_padded.resize((size_t)paddedWidth * paddedHeight * 4);
+    for (int y = 0; y < paddedHeight; y++) {
+        const int sourceY = std::min(std::max(y - m_padding, 0), height - 1);
+        for (int x = 0; x < paddedWidth; x++) {
+            const int sourceX = std::min(std::max(x - m_padding, 0), width - 1);
+            std::memcpy(&m_padded[((size_t)y * paddedWidth + x) * 4], rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, entry.rect.x, entry.rect.y, entry.page, paddedWidth, paddedHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_padded.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_generation++;
+    return handle;
+}
+
+void TextureAtlas::remove(AtlasHandle handle) {
+    if (handle >= m_entries.size() || !m_entries[handle].alive)
+        return;
+
+    Entry& entry = m_entries[handle];
+    m_pages[entry.page].remove(entry.rect);
+    if (m_removedPages >= 0.0f)
+        m_removedPages += (float)((double)entry.rect.width * entry.rect.height / ((double)m_pageSize * m_pageSize));
+    entry.alive = false;
+    m_freeHandles.push_back(handle);
+    m_generation++;
+}
+
+bool TextureAtlas::region(AtlasHandle handle, AtlasRegion& region) const {
+    if (handle >= m_entries.size() || !m_entries[handle].alive)
+        return false;
+
+    const Entry& entry = m_entries[handle];
+    const float scale = 1.0f / (float)m_pageSize;
+    region.layer = entry.page;
+    region.u0 = (entry.rect.x + m_padding) * scale;
+    region.v0 = (entry.rect.y + m_padding) * scale;
+    region.u1 = (entry.rect.x + entry.rect.width - m_padding) * scale;
+    region.v1 = (entry.rect.y + entry.rect.height - m_padding) * scale;
+    return true;
+}
+
+TextureAtlas::RepackResult TextureAtlas::computeRepack(std::vector<Entry> entries, unsigned int generation, int pageSize, unsigned int maxPages) {
+    RepackResult result;
+    result.ok = true;
+    result.generation = generation;
+
+    //tallest first packs much tighter than arrival order
+    std::vector<size_t> order;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].alive)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const AtlasRect& ra = entries[a].rect;
+        const AtlasRect& rb = entries[b].rect;
+        return ra.height != rb.height ? ra.height > rb.height : ra.width > rb.width;
+    });
+
+    for (size_t i : order) {
+        Entry& entry = entries[i];
+        AtlasRect placed = {};
+        bool done = false;
+        for (size_t page = 0; page < result.pages.size() && !done; page++) {
+            done = result.pages[page].insert(entry.rect.width, entry.rect.height, placed);
+            entry.page = (unsigned int)page;
+        }
+        if (!done) {
+            if (result.pages.size() == maxPages) {
+                result.ok = false;
+                return result;
+            }
+            result.pages.emplace_back();
+            result.pages.back().init(pageSize, pageSize);
+            result.pages.back().insert(entry.rect.width, entry.rect.height, placed);
+            entry.page = (unsigned int)(result.pages.size() - 1);
+        }
+        entry.rect = placed;
+    }
+    if (result.pages.empty()) {
+        result.pages.emplace_back();
+        result.pages.back().init(pageSize, pageSize);
+    }
+
+    result.entries = std::move(entries);
+    return result;
+}
+
+void TextureAtlas::applyRepack(RepackResult& result) {
+    unsigned int texture = createArrayTexture();
+
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const Entry& from = m_entries[i];
+        const Entry& to = result.entries[i];
+        if (!from.alive)
+            continue;
+        glCopyImageSubData(m_texture, GL_TEXTURE_2D_ARRAY, 0, from.rect.x, from.rect.y, from.page,
+            texture, GL_TEXTURE_2D_ARRAY, 0, to.rect.x, to.rect.y, to.page,
+            from.rect.width, from.rect.height, 1);
+    }
+
+    glDeleteTextures(1, &m_texture);
+    m_texture = texture;
+    m_entries = std::move(result.entries);
+    m_pages = std::move(result.pages);
+    m_version++;
+    m_stats.repacks++;
+}
+
+void TextureAtlas::collectRepack() {
+    RepackResult result = m_repack.get();
+    if (result.ok && result.generation == m_generation) {
+        applyRepack(result);
+    }
+    else if (result.ok) {
+        //anything inserted or removed meanwhile isn't in the new layout. The holes that called
+        //for it are still there, so the next update() starts over from the current contents
+        m_stats.staleRepacks++;
+        m_repackGeneration = 0xFFFFFFFF;
+        m_removedPages = m_repackRemovedPages < 0.0f ? -1.0f : m_removedPages + m_repackRemovedPages;
+    }
+}
+
+void TextureAtlas::finishRepack() {
+    if (m_repack.valid())
+        collectRepack();
+}
+
+void TextureAtlas::update() {
+    if (m_repack.valid()) {
+        if (m_repack.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            collectRepack();
+        return;
+    }
+
+    float fragmentation = 0.0f;
+    for (const MaxRectsPacker& page : m_pages)
+        fragmentation = std::max(fragmentation, page.fragmentation());
+
+    //a repack of the same contents won't come out any better, and neither will one that only
+    //has more images to place than the last. Removals count even when as much is inserted
+    //again, that churn is what leaves the holes
+    const bool freedEnough = m_removedPages < 0.0f || m_removedPages >= m_repackHysteresis;
+    if (fragmentation > m_repackThreshold && m_generation != m_repackGeneration && freedEnough) {
+        m_repackGeneration = m_generation;
+        m_repackRemovedPages = m_removedPages;
+        m_removedPages = 0.0f;
+        m_repack = std::async(std::launch::async, computeRepack, m_entries, m_generation, m_pageSize, m_maxPages);
+    }
+}
+
+const TextureAtlasStats& TextureAtlas::stats() {
+    m_stats.images = (unsigned int)(m_entries.size() - m_freeHandles.size());
+    m_stats.pages = (unsigned int)m_pages.size();
+    m_stats.occupancy.resize(m_pages.size());
+    m_stats.fragmentation = 0.0f;
+    for (size_t i = 0; i < m_pages.size(); i++) {
+        m_stats.occupancy[i] = m_pages[i].occupancy();
+        m_stats.fragmentation = std::max(m_stats.fragmentation, m_pages[i].fragmentation());
+    }
+    return m_stats;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <vector>
+
+struct AtlasRect {
+    int x, y, width, height;
+};
+
+/*
+MaxRects Packer
+    Keeps the list of maximal free rectangles of one page. Inserting picks the free
+    rectangle with the best short side fit, then splits every free rectangle the new
+    one overlaps. Freed rectangles go back into the list as they are, so removing
+    a lot leaves the free space chopped up - TextureAtlas repacks when that happens.
+*/
+class MaxRectsPacker {
+public:
+    void init(int width, int height);
+    bool insert(int width, int height, AtlasRect& placed);
+    void remove(const AtlasRect& rect);
+
+    float occupancy() const;        //used area / page area
+    float fragmentation() const;    //free area outside the largest free rect / page area, 0 = one big hole
+
+private:
+    void splitFreeRects(const AtlasRect& used);
+    void addFreeRect(const AtlasRect& rect);
+
+    int m_width = 0;
+    int m_height = 0;
+    int64_t m_usedArea = 0;
+    std::vector<AtlasRect> m_freeRects;
+};
+
+typedef unsigned int AtlasHandle;
+static const AtlasHandle INVALID_ATLAS_HANDLE = 0xFFFFFFFF;
+
+struct AtlasRegion {
+    unsigned int layer;         //array layer of texture()
+    float u0, v0, u1, v1;
+};
+
+struct TextureAtlasStats {
+    unsigned int images = 0;
+    unsigned int pages = 0;
+    unsigned int repacks = 0;
+    unsigned int staleRepacks = 0;      //dropped because the atlas changed while they ran, then started again
+    double insertMilliseconds = 0.0;    //total time spent packing, excluding the upload
+    std::vector<float> occupancy;       //per page
+    float fragmentation = 0.0f;         //worst page
+};
+
+/*
+Texture Atlas
+    RGBA8 images packed into the layers of one GL_TEXTURE_2D_ARRAY. Handles stay valid
+    across repacks, but their UVs don't: look regions up again when version() changes.
+    Every image is surrounded by padding texels repeating its edge, so linear filtering
+    at the border of a region doesn't pick up the neighbours.
+    All calls are GL thread only; the repack layout itself is computed on a worker thread.
+    After a repack the next one waits until removals have freed repackHysteresis pages worth
+    of area, so an atlas that is filling up, which fragments as it goes, isn't repacked over
+    and over.
+*/
+class TextureAtlas {
+public:
+    TextureAtlas() = default;
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+    ~TextureAtlas();
+
+    bool init(int pageSize, unsigned int maxPages, int padding = 1, float repackThreshold = 0.35f, float repackHysteresis = 0.1f);
+
+    AtlasHandle insert(int width, int height, const unsigned char* rgba);
+    void remove(AtlasHandle handle);
+    bool region(AtlasHandle handle, AtlasRegion& region) const;
+
+    //once per frame: starts a background repack when fragmentation passes the threshold and
+    //enough has been removed since the last one, and applies a finished one
+    void update();
+    //waits for a running repack and applies it, for callers that need to know when that happens
+    void finishRepack();
+
+    unsigned int texture() const { return m_texture; }
+    unsigned int version() const { return m_version; }
+    //a running repack is dropped and started over by any insert or remove before it lands,
+    //so a caller streaming images in bulk can hold them back meanwhile
+    bool repacking() const { return m_repack.valid(); }
+    const TextureAtlasStats& stats();
+
+private:
+    struct Entry {
+        bool alive;
+        unsigned int page;
+        AtlasRect rect;     //including the padding on every side
+    };
+
+    struct RepackResult {
+        bool ok;
+        unsigned int generation;    //m_generation when the layout was started
+        std::vector<Entry> entries;
+        std::vector<MaxRectsPacker> pages;
+    };
+
+    static RepackResult computeRepack(std::vector<Entry> entries, unsigned int generation, int pageSize, unsigned int maxPages);
+    void collectRepack();   //m_repack is ready
+    void applyRepack(RepackResult& result);
+    unsigned int createArrayTexture() const;
+
+    int m_pageSize = 0;
+    unsigned int m_maxPages = 0;
+    int m_padding = 1;
+    float m_repackThreshold = 0.35f;
+    float m_repackHysteresis = 0.1f;
+    float m_removedPages = -1.0f;       //area removed since the last repack started, in pages, -1 = never
+    float m_repackRemovedPages = -1.0f; //m_removedPages when the running repack started
+    unsigned int m_texture = 0;
+    unsigned int m_version = 0;
+    unsigned int m_generation = 0;      //bumped by every insert/remove, stale repacks are dropped
+    unsigned int m_repackGeneration = 0xFFFFFFFF;
+    std::vector<MaxRectsPacker> m_pages;
+    std::vector<Entry> m_entries;
+    std::vector<AtlasHandle> m_freeHandles;
+    std::vector<unsigned char> m_padded;    //insert()'s image with its padding, kept to save the allocation
+    std::future<RepackResult> m_repack;
+    TextureAtlasStats m_stats;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+
+/*
+Triple Buffer
+    Hands the latest value from one writer thread to one reader thread without either ever
+    waiting. The writer fills back() and publish()es it, the reader takes the newest published
+    value with update() and reads front() for as long as it likes. Values published between two
+    update() calls are skipped, the reader only ever sees the latest one.
+
+    Three slots: the writer's, the reader's, and the one in the middle that publish() and
+    update() trade theirs for with a single atomic exchange.
+*/
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    //writer
+    T& back() { return m_slots[m_back]; }
+    void publish() { m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX; }
+    void write(const T& value) {
+        back() = value;
+        publish();
+    }
+
+    //reader. false when nothing was published since the last update()
+    bool update() {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return m_slots[m_front]; }
+
+private:
+    static const unsigned int INDEX = 3;
+    static const unsigned int FRESH = 4;    //set in m_middle when it holds a value the reader hasn't taken
+
+    T m_slots[3];
+    unsigned int m_back = 0;
+    unsigned int m_front = 1;
+    std::atomic<unsigned int> m_middle{ 2 };
+};
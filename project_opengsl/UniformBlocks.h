@@ -0,0 +1,16 @@
+#pragma once
+#include "Std140.h"
+
+//Uniform blocks shared by the C++ side and the shaders. The shader text comes from glsl(),
+//see insertAfterVersion() in Shader.cpp. Block members are globals in GLSL, so their names
+//can't clash with the shader's own inputs/outputs.
+
+#define PER_FRAME_FIELDS(FIELD)     \
+    FIELD(mat4, viewProjection)     \
+    FIELD(vec4, time)               //x = seconds since start
+UNIFORM_BLOCK(PerFrame, 0, PER_FRAME_FIELDS);
+
+#define PER_DRAW_FIELDS(FIELD)      \
+    FIELD(mat4, model)              \
+    FIELD(vec4, tint)
+UNIFORM_BLOCK(PerDraw, 1, PER_DRAW_FIELDS);
@@ -0,0 +1,153 @@
+#include "UniformRing.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <new>
+
+UniformRing::~UniformRing() {
+    destroy();
+}
+
+void UniformRing::destroy() {
+    for (unsigned int i = 0; i < m_frameCount; i++) {
+        if (m_fences[i])
+            glDeleteSync((GLsync)m_fences[i]);
+        m_fences[i] = nullptr;
+    }
+    if (m_buffer) {
+        if (m_persistent) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        else {
+            delete[] m_mapped;
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_persistent = false;
+}
+
+bool UniformRing::init(size_t bytesPerFrame, unsigned int frameCount) {
+    if (frameCount == 0 || frameCount > sizeof(m_fences) / sizeof(m_fences[0])) {
+        std::cout << "UniformRing supports 1 to 8 frames, asked for " << frameCount << std::endl;
+        return false;
+    }
+
+    int alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = (size_t)alignment;
+    m_frameCount = frameCount;
+    return create(bytesPerFrame);
+}
+
+bool UniformRing::create(size_t segmentSize) {
+    m_segmentSize = (segmentSize + m_alignment - 1) / m_alignment * m_alignment;
+    m_frame = 0;
+    const size_t total = m_segmentSize * m_frameCount;
+
+    //errors left from before aren't ours, a buffer that can't be allocated leaves GL_OUT_OF_MEMORY
+    for (int i = 0; i < 16 && glGetError() != GL_NO_ERROR; i++) {}
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, total, nullptr, flags);
+        m_mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, total, flags);
+        m_persistent = m_mapped != nullptr;
+        if (!m_persistent) {
+            //immutable storage can't take glBufferData, start over with a plain buffer
+            glDeleteBuffers(1, &m_buffer);
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glGetError();
+        }
+    }
+    if (!m_persistent) {
+        glBufferData(GL_UNIFORM_BUFFER, total, nullptr, GL_DYNAMIC_DRAW);
+        m_mapped = new (std::nothrow) unsigned char[total];
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR || !m_mapped) {
+        std::cout << "UniformRing can't allocate " << total << " bytes" << std::endl;
+        destroy();
+        m_segmentSize = 0;
+        return false;
+    }
+    return true;
+}
+
+void UniformRing::beginFrame() {
+    if (m_overflow > 0) {
+        //a new buffer, so no fences to wait for. GL keeps the old one alive until the GPU is done with it
+        const size_t previous = m_segmentSize;
+        const size_t grown = std::max(m_segmentSize * 2, m_segmentSize + m_overflow);
+        destroy();
+        if (create(grown))
+            std::cout << "UniformRing grown to " << m_segmentSize << " bytes per frame" << std::endl;
+        else if (!create(previous))
+            std::cout << "UniformRing has no buffer, every allocation fails until it can grow" << std::endl;
+        m_overflow = 0;
+    }
+    m_stats = UniformRingStats();
+    m_head = 0;
+    m_flushed = 0;
+
+    //the GPU may still be reading what we wrote frameCount frames ago
+    GLsync fence = (GLsync)m_fences[m_frame];
+    if (fence) {
+        auto start = std::chrono::high_resolution_clock::now();
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1 ms
+        auto end = std::chrono::high_resolution_clock::now();
+        m_stats.waitMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+        glDeleteSync(fence);
+        m_fences[m_frame] = nullptr;
+    }
+}
+
+UniformAllocation UniformRing::allocate(size_t size, void** data) {
+    size_t aligned = (size + m_alignment - 1) / m_alignment * m_alignment;
+    if (m_head + aligned > m_segmentSize) {
+        if (m_overflow == 0)
+            std::cout << "UniformRing out of space, " << m_segmentSize << " bytes per frame isn't enough. Draws are dropped this frame" << std::endl;
+        m_overflow += aligned;
+        m_stats.failedAllocations++;
+        *data = nullptr;
+        return { 0, 0, 0 };
+    }
+
+    size_t offset = m_frame * m_segmentSize + m_head;
+    m_head += aligned;
+    m_stats.allocations++;
+    m_stats.bytes += size;
+
+    *data = m_mapped + offset;
+    return { m_buffer, offset, size };
+}
+
+void UniformRing::flush() {
+    if (m_persistent || m_head == m_flushed)
+        return;
+
+    size_t offset = m_frame * m_segmentSize + m_flushed;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, m_head - m_flushed, m_mapped + offset);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_flushed = m_head;
+}
+
+void UniformRing::endFrame() {
+    flush();
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_frame = (m_frame + 1) % m_frameCount;
+}
+
+void UniformRing::bind(unsigned int binding, const UniformAllocation& allocation) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, allocation.buffer, allocation.offset, allocation.size);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+//size 0: the ring was out of space, there's nothing to bind. Drop the draw that needed it
+struct UniformAllocation {
+    unsigned int buffer;
+    size_t offset;
+    size_t size;
+};
+
+struct UniformRingStats {
+    unsigned int allocations = 0;
+    unsigned int failedAllocations = 0;    //didn't fit, the ring grows at the next beginFrame()
+    size_t bytes = 0;
+    double waitMilliseconds = 0.0; //time blocked on the GPU still reading the segment we want to reuse
+};
+
+/*
+Uniform Ring
+    One uniform buffer split into frameCount segments (triple buffered by default). Each
+    frame sub-allocates its per-frame and per-draw blocks from the current segment at
+    GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT and binds them with glBindBufferRange, instead of
+    a glUniform* call per value. A fence per segment makes sure the GPU is done with it
+    before it gets overwritten.
+    A frame that runs out of space gets size 0 allocations for the rest of it, and the
+    next beginFrame() reallocates the buffer with room for everything that was asked for, or
+    keeps the old size if that can't be had.
+    With ARB_buffer_storage the buffer is persistently mapped; without it, writes go to a
+    CPU copy and flush() uploads them, so call flush() after allocating and before drawing.
+*/
+class UniformRing {
+public:
+    UniformRing() = default;
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+    ~UniformRing();
+
+    //false when the buffer can't be allocated, every allocation fails then
+    bool init(size_t bytesPerFrame, unsigned int frameCount = 3);
+
+    void beginFrame();      //grows the ring first if the last frame ran out of space
+    UniformAllocation allocate(size_t size, void** data);
+    template <typename T>
+    UniformAllocation push(const T& block) {
+        void* data;
+        UniformAllocation allocation = allocate(sizeof(T), &data);
+        if (data)
+            memcpy(data, &block, sizeof(T));
+        return allocation;
+    }
+    void flush();
+    void endFrame();
+
+    //never a size 0 allocation, GL rejects the range and the binding keeps the last frame's block
+    static void bind(unsigned int binding, const UniformAllocation& allocation);
+
+    const UniformRingStats& stats() const { return m_stats; }
+    size_t bytesPerFrame() const { return m_segmentSize; }
+
+private:
+    bool create(size_t segmentSize);
+    void destroy();
+
+    unsigned int m_buffer = 0;
+    unsigned char* m_mapped = nullptr;  //persistent mapping, or the CPU copy
+    bool m_persistent = false;
+    size_t m_segmentSize = 0;
+    size_t m_alignment = 256;
+    unsigned int m_frameCount = 0;
+    unsigned int m_frame = 0;
+    size_t m_head = 0;                  //offset inside the current segment
+    size_t m_flushed = 0;
+    size_t m_overflow = 0;              //aligned bytes that didn't fit this frame
+    void* m_fences[8] = {};             //GLsync
+    UniformRingStats m_stats;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*
+Work Stealing Deque
+    Chase-Lev deque of pointers with a fixed capacity. The owner thread push()es and pop()s
+    at the bottom without locks, any other thread may steal() from the top; only the last
+    item, when the owner and a thief race for it, is settled with a compare-exchange.
+    The owner works newest first (the data it just touched is still in cache), thieves take
+    the oldest, which in a fork-join split is usually the biggest piece left.
+    Pushes that don't fit fail instead of growing the ring.
+*/
+template <typename T>
+class WorkStealingDeque {
+public:
+    //capacity is rounded up to a power of 2
+    explicit WorkStealingDeque(uint32_t capacity) {
+        uint32_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_items.reset(new std::atomic<T*>[size]);
+        m_mask = size - 1;
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    //owner
+    bool push(T* item) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top > (int64_t)m_mask)
+            return false;
+        m_items[bottom & m_mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    //owner. nullptr when empty
+    T* pop() {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = m_items[bottom & m_mask].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            //the last one, a thief may be after it too
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    //any thread. nullptr when empty or another thread got there first
+    T* steal() {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+        T* item = m_items[top & m_mask].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    bool empty() const { return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed); }
+    uint32_t capacity() const { return m_mask + 1; }
+
+private:
+    std::unique_ptr<std::atomic<T*>[]> m_items;
+    uint32_t m_mask = 0;
+    std::atomic<int64_t> m_top{ 0 };
+    char m_padding[56];     //thieves hammer m_top, keep it off the owner's line
+    std::atomic<int64_t> m_bottom{ 0 };
+};
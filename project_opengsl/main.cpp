@@ -1,97 +1,98 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <fstream> //file stream, 
 #include <string>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include "DamageTracker.h"
+#include "DebugDraw.h"
+#include "FixedTimestep.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "FrameStats.h"
+#include "FrustumCulling.h"
+#include "ImmediateMode.h"
+#include "JobSystem.h"
+#include "PipelineStatistics.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "RenderThread.h"
+#include "Shader.h"
+#include "TextRenderer.h"
+#include "TripleBuffer.h"
+#include "UniformBlocks.h"
+#include "UniformRing.h"
+
+
+
+static Std140Mat4 identityMatrix() {
+    Std140Mat4 matrix = {};
+    matrix.m[0] = matrix.m[5] = matrix.m[10] = matrix.m[15] = 1.0f;
+    return matrix;
+}
 
+static Std140Mat4 translationMatrix(float x, float y, float z) {
+    Std140Mat4 matrix = identityMatrix();
+    matrix.m[12] = x;
+    matrix.m[13] = y;
+    matrix.m[14] = z;
+    return matrix;
+}
 
-
-struct ShaderProgramSource {
-    std::string VertexSource;
-    std::string FragmentSource;
-};
-
-static struct ShaderProgramSource ParseShader(const std::string& filepath) {
-    
-    std::ifstream stream(filepath);
-
-    enum class ShaderType {
-        NONE = -1,
-        VERTEX = 0,
-        FRAGMENT = 1
-    };
-    ShaderType type = ShaderType::NONE;
-
-    std::string line;
-    std::stringstream ss[2];
-
-    while (getline(stream, line)) 
-    {
-        if (line.find("#shader") != std::string::npos) 
-        {
-            if (line.find("vertex") != std::string::npos) 
-                type = ShaderType::VERTEX;
-            else if (line.find("fragment") != std::string::npos)
-                type = ShaderType::FRAGMENT;
-        }
-        else 
-        {
-            ss[(int)type] << line << '\n';
-        }
+//A framebuffer of our own keeps its contents from frame to frame, unlike a back buffer of unknown age
+static void resizeCanvas(unsigned int& framebuffer, unsigned int (&renderbuffers)[2], int width, int height) {
+    if (!framebuffer) {
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
     }
-    return { ss[0].str(), ss[1].str() };
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-static void drawTriangle() {
-    //Draw a triangle using legacy opengl
-    //Place inside game loop
-    //typically, you want to use modern opengl
-    glBegin(GL_TRIANGLES);
-    glVertex2f(-0.5f, -0.5f);
-    glVertex2f( 0.0f,  0.5f);
-    glVertex2f( 0.5f, -0.5f);
-    glEnd();
-}
+//Everything the fixed-step update owns, rendering only sees it interpolated
+struct SimulationState {
+    float quadX = 0.0f;
+    float quadVelocity = 0.4f; //units per second
+};
 
-static unsigned int compileShader(unsigned int type, const std::string source) {
-    unsigned int id = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(id, 1, &src, nullptr);
-    glCompileShader(id);
-
-    //Error Handling
-    int result;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &result) ;
-    if (result == GL_FALSE) { //error
-        int length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-        char* message = (char*)alloca(length * sizeof(char)); //alloca() allocates memory within the current function's stack frame. Memory allocated using alloca() will be removed from the stack when the current function returns. alloca() is limited to small allocations.
-        glGetShaderInfoLog(id, length, &length, message);
-
-        std::cout << "Failed to compile shader!" << std::endl;
-        std::cout << message << std::endl;
-        glDeleteShader(id);
-        return 0;
+static SimulationState simulate(SimulationState state, double step) {
+    state.quadX += state.quadVelocity * (float)step;
+    if (state.quadX > 0.5f || state.quadX < -0.5f) { //bounce off the sides
+        state.quadX = state.quadX > 0.0f ? 0.5f : -0.5f;
+        state.quadVelocity = -state.quadVelocity;
     }
+    return state;
+}
 
-    return id;
+//What the main thread hands the render thread after each update, the last two states to interpolate between
+struct RenderSnapshot {
+    SimulationState previous;
+    SimulationState current;
+    float alpha = 0.0f;         //at publishing
+    double published = 0.0;     //glfwGetTime() at publishing
+    double step = 1.0 / 60.0;
+    FixedTimestepStats timestep;
+};
 
-}
-static unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader) {
-    
-    unsigned int program_id = glCreateProgram();
-    unsigned int vs = compileShader(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = compileShader(GL_FRAGMENT_SHADER, fragmentShader);
-
-    glAttachShader(program_id, vs);
-    glAttachShader(program_id, fs);
-    glLinkProgram(program_id);
-
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    
-    return program_id;
+static void drawTriangle(ImmediateMode& immediate) {
+    //Draw a triangle the legacy opengl way
+    //Place inside game loop, it shows up at the next immediate.flush()
+    //glBegin/glVertex2f/glEnd don't exist in core profiles, ImmediateMode batches them into a streaming buffer instead
+    immediate.begin(GL_TRIANGLES);
+    immediate.vertex(-0.5f, -0.5f);
+    immediate.vertex( 0.0f,  0.5f);
+    immediate.vertex( 0.5f, -0.5f);
+    immediate.end();
 }
 
 int main(void)
@@ -140,6 +141,10 @@ int main(void)
         0, 1, 2,
         2, 3, 0
     };
+    unsigned int vao;
+    glGenVertexArrays(1, &vao); //the vertex array remembers the buffer + layout below, so the render queue can rebind it per draw
+    glBindVertexArray(vao);
+
     unsigned int buffer;
     glGenBuffers(1, &buffer); //arg1: how many buffers would you like?
     glBindBuffer(GL_ARRAY_BUFFER, buffer); //arg1: defines the purpose, or how buffer will be used. The currently bound buffer is considered to be the "selected" buffer
@@ -165,28 +170,380 @@ int main(void)
 
 
     ShaderProgramSource source = ParseShader("Basic.shader");
+    injectUniformBlocks(source);
 
     unsigned int shader = createShader(source.VertexSource, source.FragmentSource);
     glUseProgram(shader);
 
+    ShaderProgramSource depthSource = ParseShader("DepthOnly.shader");
+    injectUniformBlocks(depthSource);
+    unsigned int depthShader = createShader(depthSource.VertexSource, depthSource.FragmentSource);
+
+    ShaderProgramSource vertexColorSource = ParseShader("VertexColor.shader");
+    unsigned int vertexColorShader = createShader(vertexColorSource.VertexSource, vertexColorSource.FragmentSource);
+    ImmediateMode immediate;
+    immediate.init(vertexColorShader);
+    DebugDraw debugDraw;
+    double lastTime = glfwGetTime();
+
+    ShaderProgramSource textSource = ParseShader("SdfText.shader");
+    unsigned int textShader = createShader(textSource.VertexSource, textSource.FragmentSource);
+    std::unique_ptr<GlyphSource> glyphSource = createSystemGlyphSource("Consolas", 40);
+    TextRenderer text;
+    bool showText = glyphSource && text.init(textShader, glyphSource.get());
+
+    glEnable(GL_DEPTH_TEST);
+    bool depthPrePass = true; //P toggles it
+    bool showBounds = false; //B toggles the culling bounds
+    PipelineStatistics pipelineStats;
+    pipelineStats.init();
+    uint64_t fragmentInvocations[2] = {}; //without, with the pre-pass
+    uint64_t measuredFrames[2] = {};
+
+    CullingBounds bounds;
+    bounds.add({ { -0.5f, -0.5f, 0.0f }, { 0.5f, 0.5f, 0.0f } }); //the quad
+    JobSystem jobs;
+    jobs.init(std::max(std::thread::hardware_concurrency(), 1u) - 1); //the render thread submits and helps with GL jobs
+    FrustumCuller culler;
+    culler.setJobSystem(&jobs);
+    std::cout << "Culling with " << simdLevelName(culler.simdLevel()) << " on " << jobs.threadCount() << " threads" << std::endl;
+    std::vector<uint32_t> visible;
+
+    RenderQueue renderQueue;
+    UniformRing uniformRing;
+    if (!uniformRing.init(64 * 1024)) { //per frame, triple buffered
+        glfwTerminate();
+        return -1;
+    }
+
 
-    //GAME LOOP
-    while (!glfwWindowShouldClose(window)) {
-        /* Render here */
-        glClear(GL_COLOR_BUFFER_BIT);
+    FixedTimestep timestep(1.0 / 60.0); //simulation runs at 60 Hz whatever the frame rate
+    SimulationState previousState;
+    SimulationState currentState;
+
+
+    FramePacer pacer;
+    pacer.init(2, SwapMode::VSync); //V cycles the swap mode, F the frames in flight
+    unsigned int framesInFlight = 2;
+    FrameStats frameStats; //S dumps it, so does closing the window
+    frameStats.init();
+    FrameCapture capture; //C takes a screenshot, R starts and stops recording
+    capture.init();
+    unsigned int screenshots = 0;
+
+    TripleBuffer<RenderSnapshot> snapshots;
+    snapshots.write(RenderSnapshot());
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height); //afterwards resizes come through the render thread's input
+
+    //Only what changed is redrawn, and nothing at all when nothing did. I switches to redrawing every frame,
+    //space pauses the simulation so there is nothing to redraw
+    DamageTracker damage;
+    damage.resize(width, height);
+    bool redrawOnDemand = true;
+    bool settled = false; //the last frame had nothing to draw, wait for something to happen before the next
+    bool timedDebugLines = false; //the last frame drew debug lines with a lifetime
+    std::atomic<bool> paused{ false };
+    float drawnQuadX = 0.0f;
+    const int overlayHeight = 8 + 5 * 16 + 4; //5 lines of 16 px, redrawn with every frame
+    unsigned int canvas = 0; //where windowBufferAge() doesn't know, everything is drawn here and blitted
+    unsigned int canvasBuffers[2] = {};
+    int canvasWidth = 0, canvasHeight = 0;
+
+
+    //RENDER LOOP, on its own thread so a blocking swap or fence wait never holds up events and updates
+    RenderThread renderThread;
+    bool pinned = false;
+    renderThread.start(window, [&]() {
+        if (!pinned) {
+            //from in here, so the first frame already runs its GL jobs rather than waiting on a pin from outside
+            jobs.pinGlThread(std::this_thread::get_id());
+            pinned = true;
+        }
+        if (settled)
+            renderThread.waitForWork(0.25); //input, a new snapshot or stop()
+
+        /* Wait for the GPU and the target frame rate, then take input as late as possible */
+        Profiler::get().beginFrame();
+        {
+            PROFILE_SCOPE("Pacing");
+            pacer.beginFrame();
+        }
+        jobs.runGlJobs();
+
+        InputEvent event;
+        while (renderThread.input().pop(event)) {
+            if (event.type == InputEventType::FramebufferSize) {
+                width = event.width;
+                height = event.height;
+                glViewport(0, 0, width, height);
+                damage.resize(width, height);
+                continue;
+            }
+            if (event.type == InputEventType::Refresh) {
+                damage.addAll(); //the system threw away what was on screen, idle or not
+                continue;
+            }
+            if (event.action != GLFW_PRESS)
+                continue;
+            damage.add({ 0, height - overlayHeight, width, overlayHeight }); //whatever the key did shows there
+            if (event.key == GLFW_KEY_P) {
+                depthPrePass = !depthPrePass;
+                std::cout << "depth pre-pass " << (depthPrePass ? "on" : "off") << std::endl;
+            }
+            else if (event.key == GLFW_KEY_B) {
+                showBounds = !showBounds;
+                damage.addNdc(drawnQuadX - 0.5f, -0.5f, drawnQuadX + 0.5f, 0.5f);
+            }
+            else if (event.key == GLFW_KEY_V)
+                pacer.setSwapMode(pacer.swapMode() == SwapMode::VSync ? SwapMode::Adaptive : pacer.swapMode() == SwapMode::Adaptive ? SwapMode::Off : SwapMode::VSync);
+            else if (event.key == GLFW_KEY_F) {
+                framesInFlight = framesInFlight % 3 + 1;
+                pacer.setMaxFramesInFlight(framesInFlight);
+            }
+            else if (event.key == GLFW_KEY_S) {
+                frameStats.writeCsv("frame_stats.csv");
+                frameStats.writeJson("frame_stats.json");
+            }
+            else if (event.key == GLFW_KEY_T) {
+                Profiler::get().capture(120, "trace.json");
+                std::cout << "capturing 120 frames to trace.json" << std::endl;
+            }
+            else if (event.key == GLFW_KEY_C) {
+                const std::string path = "screenshot_" + std::to_string(screenshots++) + ".png";
+                capture.screenshot(path);
+                std::cout << "screenshot " << path << std::endl;
+            }
+            else if (event.key == GLFW_KEY_R) {
+                if (capture.recording())
+                    capture.stopSequence();
+                else
+                    capture.startSequence("capture.y4m", CaptureFormat::Y4m, 60);
+                std::cout << (capture.recording() ? "recording to capture.y4m" : "recording stopped") << std::endl;
+            }
+            else if (event.key == GLFW_KEY_SPACE) {
+                paused = !paused;
+                glfwPostEmptyEvent(); //the main thread may be waiting for events, paused
+            }
+            else if (event.key == GLFW_KEY_I) {
+                redrawOnDemand = !redrawOnDemand;
+                std::cout << "redraw " << (redrawOnDemand ? "on demand" : "every frame") << std::endl;
+            }
+        }
+
+        snapshots.update();
+        const RenderSnapshot& snapshot = snapshots.front();
+        //the snapshot ages while it waits, carry alpha on by the time since it was published
+        const double time = glfwGetTime();
+        const float alpha = std::min(1.0f, snapshot.alpha + (float)((time - snapshot.published) / snapshot.step));
+        const float quadX = snapshot.previous.quadX + (snapshot.current.quadX - snapshot.previous.quadX) * alpha;
+        bounds.set(0, { { quadX - 0.5f, -0.5f, 0.0f }, { quadX + 0.5f, 0.5f, 0.0f } });
+
+        /* Skip the frame when nothing changed */
+        if (!redrawOnDemand)
+            damage.addAll();
+        if (quadX != drawnQuadX) { //where it was and where it is
+            damage.addNdc(drawnQuadX - 0.5f, -0.5f, drawnQuadX + 0.5f, 0.5f);
+            damage.addNdc(quadX - 0.5f, -0.5f, quadX + 0.5f, 0.5f);
+            drawnQuadX = quadX;
+        }
+        //debug lines with a lifetime only age in frames that draw them, so keep drawing until the last
+        //one has expired and been drawn over. They can be anywhere on screen
+        if (timedDebugLines)
+            damage.addAll();
+        settled = !damage.damaged() && !capture.wantsFrame();
+        if (settled) {
+            pacer.idle();
+            frameStats.idle();
+            lastTime = time;
+            Profiler::get().endFrame();
+            return;
+        }
+        if (showText)
+            damage.add({ 0, height - overlayHeight, width, overlayHeight });
+
+        /* Render here, only into the damaged rectangles */
+        frameStats.beginGpu();
+        const int bufferAge = windowBufferAge(window);
+        if (bufferAge == 0 && (canvasWidth != width || canvasHeight != height)) {
+            resizeCanvas(canvas, canvasBuffers, width, height);
+            canvasWidth = width;
+            canvasHeight = height;
+            damage.addAll();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, bufferAge == 0 ? canvas : 0);
+        damage.repaint(bufferAge == 0 ? 1 : bufferAge);
+        //everything goes out once, scissored to all the damage at once. Clearing and redrawing the
+        //gaps between the rects too is cheaper than drawing the whole queue again per rect
+        const DamageRect repaintBounds = damage.bounds();
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(repaintBounds.x, repaintBounds.y, repaintBounds.width, repaintBounds.height);
 
 
         //glDrawArrays(GL_TRIANGLES, 0, 6); //use this function when you DON'T have an index buffer. arg1: type. arg2: starting index. arg3: vertex count (2 coordinate = 1 vertex);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+        //glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+        uniformRing.beginFrame();
+        PerFrame perFrame = { identityMatrix(), { (float)time, 0.0f, 0.0f, 0.0f } };
+        const UniformAllocation frameBlock = uniformRing.push(perFrame);
+
+        visible.clear();
+        if (frameBlock.size > 0) { //no PerFrame, the ring is full: nothing is drawn rather than drawn with last frame's camera
+            UniformRing::bind(PerFrame::binding, frameBlock);
+            culler.cull(Frustum::fromMatrix(perFrame.viewProjection.m), bounds, visible);
+        }
+        for (uint32_t object : visible) {
+            if (showBounds)
+                debugDraw.box(bounds.box(object), packColor(1.0f, 1.0f, 0.0f), 0.0f, false);
+            PerDraw perDraw = { translationMatrix(quadX, 0.0f, 0.0f), { 0.0f, 1.0f, 0.0f, 1.0f } };
+            const UniformAllocation allocation = uniformRing.push(perDraw);
+            if (allocation.size == 0)
+                continue;   //the ring is full until next frame, better missing than drawn with someone else's data
+            renderQueue.submit(0, false, 0.0f, { shader, 0, vao, 6, 0, allocation });
+        }
+        uniformRing.flush();
+
+        {
+            PROFILE_SCOPE("Render queue");
+            renderQueue.sort();
+            {
+                PROFILE_GPU_SCOPE("Depth pre-pass");
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (depthPrePass)
+                    renderQueue.executeDepthOnly(depthShader);
+            }
+            PROFILE_GPU_SCOPE("Shading");
+            pipelineStats.begin(depthPrePass ? 1 : 0); //the shading pass only, that's the cost the pre-pass is meant to cut
+            renderQueue.execute(depthPrePass);
+            pipelineStats.end();
+            renderQueue.clear();
+        }
+        {
+            PROFILE_SCOPE("Immediate");
+            PROFILE_GPU_SCOPE("Immediate");
+            debugDraw.flush(immediate, (float)(time - lastTime));
+            timedDebugLines = debugDraw.stats().persistentLinesDrawn > 0;
+            immediate.flush(perFrame.viewProjection.m);
+        }
+
+        if (showText) {
+            PROFILE_SCOPE("Text");
+            PROFILE_GPU_SCOPE("Text");
+            const FrameMetricSummary present = frameStats.summary(FrameMetric::Present);
+            std::stringstream overlay;
+            overlay.precision(2);
+            overlay << std::fixed << (time - lastTime) * 1000.0 << " ms (update " << snapshot.timestep.updateMilliseconds
+                << " ms, render " << pacer.stats().cpuMilliseconds << " ms)\n"
+                << renderQueue.stats().drawCalls << " draws, depth pre-pass " << (depthPrePass ? "on" : "off")
+                << ", profiler " << Profiler::get().stats().endFrameMilliseconds << " ms\n"
+                << "swap " << swapModeName(pacer.swapMode()) << ", " << framesInFlight << " frames in flight, GPU latency "
+                << pacer.stats().gpuLatencyMilliseconds << " ms, " << pacer.stats().missedDeadlines << " missed\n"
+                << "present p50 " << present.p50 << " p99 " << present.p99 << " max " << present.max << " ms, "
+                << frameStats.stutters() << " stutters, GPU p50 " << frameStats.summary(FrameMetric::Gpu).p50 << " ms\n"
+                << "redraw " << (redrawOnDemand ? "on demand" : "every frame") << ", " << damage.stats().rects << " rects, "
+                << damage.stats().repaintedFraction * 100.0f << "% of the screen" << (paused ? ", paused" : "");
+            text.draw(overlay.str(), 8.0f, 8.0f, 16.0f, packColor(1.0f, 1.0f, 1.0f));
+            text.flush(width, height);
+        }
+        lastTime = time;
+        glDisable(GL_SCISSOR_TEST);
+        if (bufferAge == 0) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, canvas);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        {
+            PROFILE_SCOPE("Capture");
+            capture.frame(width, height); //the finished back buffer, overlay and all
+        }
+
+        PipelineSample sample;
+        while (pipelineStats.read(sample)) {
+            fragmentInvocations[sample.tag] += sample.fragmentInvocations;
+            measuredFrames[sample.tag]++;
+        }
+        uniformRing.endFrame();
+        frameStats.endGpu();
 
         /* Swap front and back buffers */
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("Swap");
+            pacer.endFrame(window);
+        }
+        frameStats.endFrame(pacer.stats().cpuMilliseconds);
+        Profiler::get().endFrame();
+    });
 
-        /* Poll for and process events */
-        glfwPollEvents();
+
+    //GAME LOOP, events and the fixed-step update; sleeps until the next step is due or an event arrives
+    PROFILE_THREAD("Main");
+    bool wasPaused = false;
+    while (!glfwWindowShouldClose(window)) {
+        if (paused) {
+            glfwWaitEvents(); //nothing moves, nothing to update until an event
+            wasPaused = true;
+            continue;
+        }
+        if (wasPaused) {
+            timestep.reset(); //rather than catch the pause up
+            wasPaused = false;
+        }
+        glfwWaitEventsTimeout((1.0 - timestep.alpha()) * timestep.step());
+
+        /* Update here */
+        const double now = glfwGetTime();
+        const unsigned int steps = timestep.advance(now);
+        if (steps == 0)
+            continue;
+        PROFILE_SCOPE("Update");
+        timestep.beginUpdate();
+        for (unsigned int step = 0; step < steps; step++) {
+            previousState = currentState;
+            currentState = simulate(currentState, timestep.step());
+        }
+        timestep.endUpdate();
+
+        RenderSnapshot& snapshot = snapshots.back();
+        snapshot.previous = previousState;
+        snapshot.current = currentState;
+        snapshot.alpha = timestep.alpha();
+        snapshot.published = now;
+        snapshot.step = timestep.step();
+        snapshot.timestep = timestep.stats();
+        snapshots.publish();
+        renderThread.wake();
+    }
+    renderThread.stop(); //the context is current here again for the cleanup below
+    capture.shutdown();
+    if (capture.stats().dropped > 0)
+        std::cout << "capture frames dropped: " << capture.stats().dropped << std::endl;
+    Profiler::get().shutdown();
+    frameStats.writeCsv("frame_stats.csv");
+    frameStats.writeJson("frame_stats.json");
+    if (renderThread.droppedInput() > 0)
+        std::cout << "input events dropped: " << renderThread.droppedInput() << std::endl;
+
+    const RenderQueueStats& stats = renderQueue.stats();
+    std::cout << "draws: " << stats.drawCalls
+        << " program switches: " << stats.unsortedProgramSwitches << " -> " << stats.programSwitches
+        << " texture switches: " << stats.unsortedTextureSwitches << " -> " << stats.textureSwitches
+        << " sort: " << stats.sortMilliseconds << " ms" << std::endl;
+    for (int prePass = 0; prePass < 2; prePass++) {
+        if (measuredFrames[prePass] == 0)
+            continue;
+        std::cout << "fragment invocations per frame " << (prePass ? "with" : "without") << " depth pre-pass: "
+            << fragmentInvocations[prePass] / measuredFrames[prePass] << std::endl;
     }
 
+    if (canvas) {
+        glDeleteFramebuffers(1, &canvas);
+        glDeleteRenderbuffers(2, canvasBuffers);
+    }
+    glDeleteVertexArrays(1, &vao);
     glDeleteProgram(shader);
+    glDeleteProgram(depthShader);
+    glDeleteProgram(vertexColorShader);
+    glDeleteProgram(textShader);
 
     glfwTerminate();
     return 0;
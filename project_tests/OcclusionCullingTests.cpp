@@ -0,0 +1,224 @@
+#include <cstring>
+#include <vector>
+#include "JobSystem.h"
+#include "OcclusionCulling.h"
+#include "Tests.h"
+
+//the default 256x128 buffer: 4x4 tiles with edges at x 64, 128, 192 and y 32, 64, 96
+static const unsigned int WIDTH = 256;
+static const unsigned int HEIGHT = 128;
+
+//the camera at the origin looking down -z: 90 degrees vertically, the buffer's aspect, near 1 and far 100
+static void cameraMatrix(float* m) {
+    const float nearZ = 1.0f, farZ = 100.0f;
+    std::memset(m, 0, 16 * sizeof(float));
+    m[0] = (float)HEIGHT / WIDTH;
+    m[5] = 1.0f;
+    m[10] = (farZ + nearZ) / (nearZ - farZ);
+    m[11] = -1.0f;
+    m[14] = 2.0f * farZ * nearZ / (nearZ - farZ);
+}
+
+//pixels like the rasterizer's, z in NDC
+static void project(const float* m, const Vec3& point, float& x, float& y, float& z) {
+    const float w = m[3] * point.x + m[7] * point.y + m[11] * point.z + m[15];
+    x = ((m[0] * point.x + m[4] * point.y + m[8] * point.z + m[12]) / w * 0.5f + 0.5f) * WIDTH;
+    y = ((m[1] * point.x + m[5] * point.y + m[9] * point.z + m[13]) / w * 0.5f + 0.5f) * HEIGHT;
+    z = (m[2] * point.x + m[6] * point.y + m[10] * point.z + m[14]) / w;
+}
+
+static float depthAt(const OcclusionRasterizer& rasterizer, unsigned int x, unsigned int y) {
+    return rasterizer.depth()[y * rasterizer.width() + x];
+}
+
+static Aabb box(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+    return { { minX, minY, minZ }, { maxX, maxY, maxZ } };
+}
+
+//a 4x4 face at z -10 spans pixels 115.2 to 140.8 and 51.2 to 76.8, so it covers 116..139 and
+//52..75 completely. The face is the only part facing the camera
+static void knownBoxDepth() {
+    float camera[16];
+    cameraMatrix(camera);
+    OcclusionRasterizer rasterizer;
+    CHECK(rasterizer.init(WIDTH, HEIGHT));
+    rasterizer.beginFrame(camera);
+    rasterizer.addOccluderBox(box(-2.0f, -2.0f, -11.0f, 2.0f, 2.0f, -10.0f));
+    rasterizer.rasterize();
+
+    CHECK(rasterizer.stats().occluderTriangles == 12);
+    CHECK(rasterizer.stats().rasterizedTriangles == 2);
+
+    float x, y, faceDepth;
+    project(camera, { 0.0f, 0.0f, -10.0f }, x, y, faceDepth);
+    CHECK_NEAR(faceDepth, 0.818182, 1e-5);
+
+    unsigned int written = 0;
+    bool exact = true;
+    bool inside = true;
+    for (unsigned int py = 0; py < HEIGHT; py++) {
+        for (unsigned int px = 0; px < WIDTH; px++) {
+            const float depth = depthAt(rasterizer, px, py);
+            if (depth == 1.0f)
+                continue;
+            written++;
+            exact = exact && std::fabs(depth - faceDepth) < 1e-5f;
+            inside = inside && px >= 116 && px <= 139 && py >= 52 && py <= 75;
+        }
+    }
+    CHECK(written == 24 * 24);
+    CHECK(exact);
+    CHECK(inside);
+    //partly covered pixels keep the clear depth
+    CHECK(depthAt(rasterizer, 115, 64) == 1.0f);
+    CHECK(depthAt(rasterizer, 140, 64) == 1.0f);
+    CHECK(depthAt(rasterizer, 128, 51) == 1.0f);
+    CHECK(depthAt(rasterizer, 128, 76) == 1.0f);
+}
+
+static void conservativeVisibility() {
+    float camera[16];
+    cameraMatrix(camera);
+    OcclusionRasterizer rasterizer;
+    CHECK(rasterizer.init(WIDTH, HEIGHT));
+
+    //everything on screen is behind a wall at z -10
+    rasterizer.beginFrame(camera);
+    rasterizer.addOccluderBox(box(-100.0f, -100.0f, -11.0f, 100.0f, 100.0f, -10.0f));
+    rasterizer.rasterize();
+    bool covered = true;
+    for (unsigned int i = 0; i < WIDTH * HEIGHT; i++)
+        covered = covered && rasterizer.depth()[i] < 1.0f;
+    CHECK(covered);
+
+    CHECK(!rasterizer.isVisible(box(-1.0f, -1.0f, -21.0f, 1.0f, 1.0f, -20.0f), 12));
+    CHECK(!rasterizer.isVisible(box(-30.0f, -10.0f, -50.0f, -20.0f, 10.0f, -40.0f), 12));
+    CHECK(rasterizer.isVisible(box(-1.0f, -1.0f, -6.0f, 1.0f, 1.0f, -5.0f), 12));
+    //reaches from behind the camera, then from closer than the near plane, to behind the wall
+    CHECK(rasterizer.isVisible(box(-1.0f, -1.0f, -30.0f, 1.0f, 1.0f, 0.5f), 12));
+    CHECK(rasterizer.isVisible(box(-1.0f, -1.0f, -30.0f, 1.0f, 1.0f, -0.5f), 12));
+    //pokes through the wall
+    CHECK(rasterizer.isVisible(box(-1.0f, -1.0f, -20.0f, 1.0f, 1.0f, -9.5f), 12));
+    CHECK(rasterizer.stats().occludeesTested == 6);
+    CHECK(rasterizer.stats().occludeesCulled == 2);
+    CHECK(rasterizer.stats().trianglesTested == 72);
+    CHECK(rasterizer.stats().trianglesCulled == 24);
+
+    //a 4x4 occluder hides what's right behind it, but not what sticks out past its edge
+    rasterizer.beginFrame(camera);
+    rasterizer.addOccluderBox(box(-2.0f, -2.0f, -11.0f, 2.0f, 2.0f, -10.0f));
+    rasterizer.rasterize();
+    CHECK(!rasterizer.isVisible(box(-1.0f, -1.0f, -21.0f, 1.0f, 1.0f, -20.0f)));
+    CHECK(rasterizer.isVisible(box(0.0f, -1.0f, -21.0f, 8.0f, 1.0f, -20.0f)));
+    //inside the occluder's outline, but one of its pixels is only partly covered
+    CHECK(rasterizer.isVisible(box(3.5f, -1.0f, -21.0f, 3.9f, 1.0f, -20.0f)));
+    CHECK(rasterizer.isVisible(box(-1.0f, -1.0f, -6.0f, 1.0f, 1.0f, -5.0f)));
+}
+
+//a tilted triangle over the tile edges at x 128 and y 64. Every pixel it covers completely is
+//written, whatever tile it's binned to, and the depth stays one plane across the edges
+static void tileEdges() {
+    float camera[16];
+    cameraMatrix(camera);
+    OcclusionRasterizer rasterizer;
+    CHECK(rasterizer.init(WIDTH, HEIGHT));
+    rasterizer.beginFrame(camera);
+    const Vec3 vertices[3] = { { -10.0f, -5.0f, -17.0f }, { 10.0f, -5.0f, -23.0f }, { 0.3f, 6.0f, -20.0f } };
+    const uint32_t indices[3] = { 0, 1, 2 };
+    rasterizer.addOccluder(vertices, 3, indices, 3);
+    rasterizer.rasterize();
+    CHECK(rasterizer.stats().rasterizedTriangles == 1);
+
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; i++)
+        project(camera, vertices[i], x[i], y[i], z[i]);
+    CHECK(x[0] < 128.0f && x[1] > 128.0f && y[0] < 64.0f && y[2] > 64.0f);
+
+    //covered completely when all 4 corners are inside, pixels with a corner right on an edge can go either way
+    auto inside = [&](float px, float py) {
+        float nearest = 1e9f;
+        for (int i = 0; i < 3; i++) {
+            const int j = (i + 1) % 3;
+            const float length = std::sqrt((x[j] - x[i]) * (x[j] - x[i]) + (y[j] - y[i]) * (y[j] - y[i]));
+            nearest = std::fmin(nearest, ((x[j] - x[i]) * (py - y[i]) - (y[j] - y[i]) * (px - x[i])) / length);
+        }
+        return nearest;
+    };
+    unsigned int mismatches = 0;
+    unsigned int written = 0;
+    for (unsigned int py = 0; py < HEIGHT; py++) {
+        for (unsigned int px = 0; px < WIDTH; px++) {
+            float nearest = 1e9f;
+            for (int corner = 0; corner < 4; corner++)
+                nearest = std::fmin(nearest, inside((float)(px + (corner & 1)), (float)(py + (corner >> 1))));
+            const bool write = depthAt(rasterizer, px, py) < 1.0f;
+            written += write ? 1 : 0;
+            if (std::fabs(nearest) > 1e-3f && write != (nearest > 0.0f))
+                mismatches++;
+        }
+    }
+    CHECK(written > 1000);
+    CHECK(mismatches == 0);
+
+    //the same step from pixel to pixel on both sides of each edge
+    const float stepX = depthAt(rasterizer, 121, 60) - depthAt(rasterizer, 120, 60);
+    CHECK_NEAR(depthAt(rasterizer, 128, 60) - depthAt(rasterizer, 127, 60), stepX, 1e-5);
+    CHECK_NEAR(depthAt(rasterizer, 128, 66) - depthAt(rasterizer, 127, 66), stepX, 1e-5);
+    const float stepY = depthAt(rasterizer, 124, 61) - depthAt(rasterizer, 124, 60);
+    CHECK_NEAR(depthAt(rasterizer, 124, 64) - depthAt(rasterizer, 124, 63), stepY, 1e-5);
+    CHECK_NEAR(depthAt(rasterizer, 132, 64) - depthAt(rasterizer, 132, 63), stepY, 1e-5);
+}
+
+//tiles don't share pixels, so the jobs must produce the very same buffer
+static void jobsMatchSingleThread() {
+    float camera[16];
+    cameraMatrix(camera);
+    std::vector<Aabb> occluders, occludees;
+    uint32_t state = 12345;
+    auto random = [&state](float low, float high) {
+        state = state * 1664525u + 1013904223u;
+        return low + (high - low) * (state >> 8) / 16777216.0f;
+    };
+    for (int i = 0; i < 60; i++) {
+        const float x = random(-30.0f, 30.0f), y = random(-15.0f, 15.0f), z = random(-60.0f, -3.0f);
+        occluders.push_back(box(x, y, z, x + random(1.0f, 8.0f), y + random(1.0f, 8.0f), z + random(0.5f, 4.0f)));
+    }
+    for (int i = 0; i < 500; i++) {
+        const float x = random(-40.0f, 40.0f), y = random(-20.0f, 20.0f), z = random(-80.0f, -2.0f);
+        occludees.push_back(box(x, y, z, x + random(0.2f, 2.0f), y + random(0.2f, 2.0f), z + random(0.2f, 2.0f)));
+    }
+
+    auto run = [&](JobSystem* jobs, std::vector<float>& depth, std::vector<bool>& visible) {
+        OcclusionRasterizer rasterizer;
+        CHECK(rasterizer.init(WIDTH, HEIGHT));
+        rasterizer.setJobSystem(jobs);
+        rasterizer.beginFrame(camera);
+        for (const Aabb& occluder : occluders)
+            rasterizer.addOccluderBox(occluder);
+        rasterizer.rasterize();
+        depth.assign(rasterizer.depth(), rasterizer.depth() + WIDTH * HEIGHT);
+        visible.clear();
+        for (const Aabb& occludee : occludees)
+            visible.push_back(rasterizer.isVisible(occludee));
+        return rasterizer.stats().occludeesCulled;
+    };
+
+    std::vector<float> singleDepth, jobDepth;
+    std::vector<bool> singleVisible, jobVisible;
+    const uint32_t culled = run(nullptr, singleDepth, singleVisible);
+    JobSystem jobs;
+    jobs.init(3);
+    run(&jobs, jobDepth, jobVisible);
+    jobs.shutdown();
+
+    CHECK(culled > 0 && culled < occludees.size());
+    CHECK(std::memcmp(singleDepth.data(), jobDepth.data(), singleDepth.size() * sizeof(float)) == 0);
+    CHECK(singleVisible == jobVisible);
+}
+
+void occlusionCullingTests() {
+    knownBoxDepth();
+    conservativeVisibility();
+    tileEdges();
+    jobsMatchSingleThread();
+}
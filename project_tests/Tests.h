@@ -0,0 +1,25 @@
+#pragma once
+#include <cmath>
+
+/*
+Tests
+    Checks of the engine code that runs without a GL context, so they build and run anywhere,
+    build machines included. project_tests compiles the tested .cpp files of project_opengsl
+    with PROFILER_ENABLED 0 and links nothing else; a test that needs GL belongs in the
+    benchmark, as a scene.
+
+    A group of tests is a function listed in tests.cpp. CHECK() reports a failed condition with
+    its file and line and carries on, the exit code is 1 when any failed:
+
+        void occlusionCullingTests() {
+            CHECK(rasterizer.init(256, 128));
+            CHECK_NEAR(rasterizer.depth()[0], 1.0f, 1e-6f);
+        }
+*/
+bool checkResult(bool passed, const char* condition, const char* file, int line);
+
+#define CHECK(condition) checkResult((condition), #condition, __FILE__, __LINE__)
+#define CHECK_NEAR(value, expected, tolerance) \
+    checkResult(std::fabs((double)(value) - (double)(expected)) <= (tolerance), #value " near " #expected, __FILE__, __LINE__)
+
+void occlusionCullingTests();
@@ -0,0 +1,33 @@
+#include <iostream>
+#include "Tests.h"
+
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+bool checkResult(bool passed, const char* condition, const char* file, int line) {
+    checks++;
+    if (!passed) {
+        failures++;
+        std::cout << file << "(" << line << "): failed " << condition << std::endl;
+    }
+    return passed;
+}
+
+int main()
+{
+    struct Group {
+        const char* name;
+        void (*run)();
+    };
+    const Group groups[] = {
+        { "occlusion culling", occlusionCullingTests },
+    };
+
+    for (const Group& group : groups) {
+        const unsigned int failedBefore = failures;
+        group.run();
+        std::cout << group.name << (failures == failedBefore ? ": passed" : ": FAILED") << std::endl;
+    }
+    std::cout << checks - failures << " of " << checks << " checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}